@@ -0,0 +1,183 @@
+// SPDX-FileCopyrightText: Steven Ward
+// SPDX-License-Identifier: MPL-2.0
+
+/// A monotonic (bump) memory resource whose memory is reused after a reset
+/**
+* \file
+* \author Steven Ward
+* Allocation bumps a pointer, and deallocation does nothing.
+* All the memory is freed at once with \c reset, but the blocks are kept, so later allocations do not call the upstream resource.
+* Unlike \c std::pmr::monotonic_buffer_resource, \c reset does not return the blocks to the upstream resource.
+* \sa https://en.cppreference.com/w/cpp/memory/monotonic_buffer_resource
+* \sa https://en.wikipedia.org/wiki/Region-based_memory_management
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <span>
+
+/// A monotonic (bump) memory resource whose memory is reused after a reset
+/**
+* Use it with \c std::pmr containers, e.g. \c std::pmr::string and \c std::pmr::vector.
+* It is not thread-safe.
+*/
+class arena final : public std::pmr::memory_resource
+{
+public:
+
+    static constexpr size_t default_block_size = 4096;
+
+    /// Allocate blocks from \a upstream, starting with \a block_size bytes
+    explicit arena(const size_t block_size = default_block_size,
+                   std::pmr::memory_resource* const upstream = std::pmr::get_default_resource()) noexcept :
+        upstream_{upstream},
+        next_block_size_{std::max(block_size, sizeof(block))}
+    {
+    }
+
+    /// Allocate from \a buffer first (e.g. an array on the stack), then from blocks from \a upstream
+    /**
+    * \a buffer is not owned.
+    */
+    explicit arena(const std::span<std::byte> buffer,
+                   std::pmr::memory_resource* const upstream = std::pmr::get_default_resource()) noexcept :
+        upstream_{upstream},
+        buffer_{buffer},
+        ptr_{std::data(buffer)},
+        end_{std::data(buffer) + std::size(buffer)},
+        next_block_size_{std::max(std::size(buffer) * 2, default_block_size)}
+    {
+    }
+
+    // Disallow copying
+    arena(const arena&) = delete;
+    arena& operator=(const arena&) = delete;
+
+    ~arena() override
+    {
+        release();
+    }
+
+    /// Free all the memory, but keep the blocks for later allocations
+    /**
+    * All the memory allocated from the arena must no longer be used.
+    */
+    void reset() noexcept
+    {
+        cur_block_ = nullptr;
+        ptr_ = std::data(buffer_);
+        end_ = std::data(buffer_) + std::size(buffer_);
+    }
+
+    /// Free all the memory, and return the blocks to the upstream resource
+    void release() noexcept
+    {
+        for (block* b = first_block_; b != nullptr;)
+        {
+            block* const next = b->next;
+            upstream_->deallocate(b, header_size + b->size, alignof(std::max_align_t));
+            b = next;
+        }
+
+        first_block_ = nullptr;
+        reset();
+    }
+
+    /// the number of bytes in the blocks from the upstream resource
+    [[nodiscard]] size_t capacity() const noexcept
+    {
+        size_t result = 0;
+        for (const block* b = first_block_; b != nullptr; b = b->next)
+            result += b->size;
+        return result;
+    }
+
+private:
+
+    struct block
+    {
+        block* next;
+        size_t size; // the number of bytes after the header
+    };
+
+    // The header is padded so the data is aligned like the block.
+    static constexpr size_t header_size =
+        (sizeof(block) + alignof(std::max_align_t) - 1) & ~(alignof(std::max_align_t) - 1);
+
+    [[nodiscard]] static std::byte* data(block* const b) noexcept
+    {
+        return reinterpret_cast<std::byte*>(b) + header_size;
+    }
+
+    std::pmr::memory_resource* upstream_;
+    std::span<std::byte> buffer_;
+    block* first_block_ = nullptr;
+    block* cur_block_ = nullptr; // null if allocating from buffer_
+    std::byte* ptr_ = nullptr;
+    std::byte* end_ = nullptr;
+    size_t next_block_size_;
+
+    void* do_allocate(const size_t bytes, const size_t alignment) override
+    {
+        while (true)
+        {
+            const auto addr = reinterpret_cast<uintptr_t>(ptr_);
+            const size_t padding = -addr & (alignment - 1);
+
+            if (ptr_ != nullptr && padding <= static_cast<size_t>(end_ - ptr_) &&
+                bytes <= static_cast<size_t>(end_ - ptr_) - padding)
+            {
+                std::byte* const result = ptr_ + padding;
+                ptr_ = result + bytes;
+                return result;
+            }
+
+            block* next = (cur_block_ != nullptr) ? cur_block_->next : first_block_;
+
+            if (next == nullptr)
+                next = add_block(bytes + alignment);
+
+            cur_block_ = next;
+            ptr_ = data(next);
+            end_ = data(next) + next->size;
+        }
+    }
+
+    void do_deallocate(void*, size_t, size_t) override
+    {
+    }
+
+    [[nodiscard]] bool do_is_equal(const std::pmr::memory_resource& that) const noexcept override
+    {
+        return this == &that;
+    }
+
+    /// Append a block with at least \a min_size bytes
+    block* add_block(const size_t min_size)
+    {
+        const size_t size = std::max(next_block_size_, min_size);
+        next_block_size_ = size * 2;
+
+        auto* const b = static_cast<block*>(upstream_->allocate(header_size + size, alignof(std::max_align_t)));
+        b->next = nullptr;
+        b->size = size;
+
+        if (first_block_ == nullptr)
+        {
+            first_block_ = b;
+        }
+        else
+        {
+            block* last = (cur_block_ != nullptr) ? cur_block_ : first_block_;
+            while (last->next != nullptr)
+                last = last->next;
+            last->next = b;
+        }
+
+        return b;
+    }
+};
@@ -5,6 +5,8 @@
 /**
 * \file
 * \author Steven Ward
+* A type derived from a standard associative container satisfies the concept,
+* as does a type with the same interface (e.g. \c flat_sorted_map).
 * \sa https://en.cppreference.com/w/cpp/named_req/AssociativeContainer
 * \sa https://eel.is/c++draft/associative.reqmts
 */
@@ -12,9 +14,43 @@
 #pragma once
 
 #include <concepts>
+#include <iterator>
 #include <map>
 #include <set>
 
+namespace associative_container_detail
+{
+
+/// the interface of an Associative Container (that is not derived from a standard one)
+template <typename Container>
+concept associative_interface =
+    std::bidirectional_iterator<typename Container::iterator> &&
+    std::bidirectional_iterator<typename Container::const_iterator> &&
+    requires (Container c, const Container cc, const typename Container::key_type& key,
+              const typename Container::value_type& value)
+    {
+        typename Container::key_compare;
+        typename Container::value_compare;
+        { cc.key_comp() } -> std::same_as<typename Container::key_compare>;
+        { cc.value_comp() } -> std::same_as<typename Container::value_compare>;
+        { c.insert(value) };
+        { c.erase(key) } -> std::same_as<typename Container::size_type>;
+        { c.find(key) } -> std::same_as<typename Container::iterator>;
+        { cc.find(key) } -> std::same_as<typename Container::const_iterator>;
+        { cc.count(key) } -> std::same_as<typename Container::size_type>;
+        { cc.contains(key) } -> std::same_as<bool>;
+        { cc.lower_bound(key) } -> std::same_as<typename Container::const_iterator>;
+        { cc.upper_bound(key) } -> std::same_as<typename Container::const_iterator>;
+        { c.equal_range(key) };
+        { c.clear() };
+        { cc.size() } -> std::same_as<typename Container::size_type>;
+        { cc.empty() } -> std::same_as<bool>;
+        { cc.cbegin() } -> std::same_as<typename Container::const_iterator>;
+        { cc.cend() } -> std::same_as<typename Container::const_iterator>;
+    };
+
+}
+
 template <typename Container>
 concept AssociativeContainer =
     std::derived_from<Container,
@@ -24,4 +60,5 @@ concept AssociativeContainer =
                       std::multimap<typename Container::key_type,
                                     typename Container::mapped_type>> ||
     std::derived_from<Container, std::set<typename Container::key_type>> ||
-    std::derived_from<Container, std::multiset<typename Container::key_type>>;
+    std::derived_from<Container, std::multiset<typename Container::key_type>> ||
+    associative_container_detail::associative_interface<Container>;
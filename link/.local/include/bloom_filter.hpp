@@ -0,0 +1,315 @@
+// SPDX-FileCopyrightText: Steven Ward
+// SPDX-License-Identifier: MPL-2.0
+
+/// A blocked Bloom filter (a "split block" Bloom filter)
+/**
+* \file
+* \author Steven Ward
+* Each key sets (or tests) 8 bits in one 256-bit block, one bit in each 32-bit word of the block.
+* The block is aligned, so each key touches one cache line, and with AVX2 the 8 bits are made and tested at once.
+* The key is hashed with \c wyhash64.
+* The block is chosen by the upper 32 bits of the hash, and the bits by the lower 32 bits.
+*
+* The filter can be written to a flat byte image (a header and the blocks),
+* and \c blocked_bloom_filter_view tests keys in an image without copying it (e.g. an image mapped with \c mmap).
+* The image is in the native byte order.
+*
+* \sa https://github.com/apache/parquet-format/blob/master/BloomFilter.md
+* \sa https://www.cs.amherst.edu/~ccmcgeoch/cs34/papers/cacheefficientbloomfilters-jea.pdf
+* \sa quotient_filter.hpp
+*/
+
+#pragma once
+
+#include "fnv.hpp"
+#include "wyhash.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <stdexcept>
+#include <string_view>
+#include <vector>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+namespace bloom_filter_detail
+{
+
+struct alignas(32) block
+{
+    std::array<uint32_t, 8> words;
+};
+
+/// the header of a filter image
+struct alignas(64) image_header
+{
+    std::array<char, 8> magic;
+    uint64_t seed;
+    uint64_t num_blocks;
+};
+
+inline constexpr std::array<char, 8> image_magic{'B', 'B', 'L', 'O', 'O', 'M', '0', '1'};
+
+// odd constants to multiply the hash by (one per word)
+inline constexpr std::array<uint32_t, 8> salt{
+    0x47b6137bU, 0x44974d91U, 0x8824ad5bU, 0xa2b7289dU,
+    0x705495c7U, 0x2df1424bU, 0x9efc4947U, 0x5c6bfb31U,
+};
+
+/// Get the index of the block for \a hash (with Lemire's multiply-shift range reduction)
+[[nodiscard]] inline size_t
+block_index(const uint64_t hash, const size_t num_blocks) noexcept
+{
+    return ((hash >> 32) * num_blocks) >> 32;
+}
+
+#if defined(__AVX2__)
+/// Get the 8 bits (one per word) for the lower 32 bits of \a hash
+[[nodiscard]] inline __m256i
+make_mask(const uint64_t hash) noexcept
+{
+    const __m256i salts = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(salt.data()));
+    const __m256i h = _mm256_set1_epi32(static_cast<int>(static_cast<uint32_t>(hash)));
+    const __m256i shifts = _mm256_srli_epi32(_mm256_mullo_epi32(h, salts), 27);
+    return _mm256_sllv_epi32(_mm256_set1_epi32(1), shifts);
+}
+#else
+/// Get the 8 bits (one per word) for the lower 32 bits of \a hash
+[[nodiscard]] inline block
+make_mask(const uint64_t hash) noexcept
+{
+    const auto h = static_cast<uint32_t>(hash);
+    block result;
+    for (size_t i = 0; i < std::size(salt); ++i)
+        result.words[i] = UINT32_C(1) << ((h * salt[i]) >> 27);
+    return result;
+}
+#endif
+
+inline void
+insert(block* const blocks, const size_t num_blocks, const uint64_t hash) noexcept
+{
+    block& b = blocks[block_index(hash, num_blocks)];
+#if defined(__AVX2__)
+    auto* const p = reinterpret_cast<__m256i*>(b.words.data());
+    _mm256_store_si256(p, _mm256_or_si256(_mm256_load_si256(p), make_mask(hash)));
+#else
+    const block mask = make_mask(hash);
+    for (size_t i = 0; i < std::size(b.words); ++i)
+        b.words[i] |= mask.words[i];
+#endif
+}
+
+[[nodiscard]] inline bool
+contains(const block* const blocks, const size_t num_blocks, const uint64_t hash) noexcept
+{
+    const block& b = blocks[block_index(hash, num_blocks)];
+#if defined(__AVX2__)
+    // (~b & mask) == 0
+    return _mm256_testc_si256(_mm256_load_si256(reinterpret_cast<const __m256i*>(b.words.data())),
+                              make_mask(hash)) != 0;
+#else
+    const block mask = make_mask(hash);
+    uint32_t missing = 0;
+    for (size_t i = 0; i < std::size(b.words); ++i)
+        missing |= mask.words[i] & ~b.words[i];
+    return missing == 0;
+#endif
+}
+
+/// Read and check the header of the image \a image (which need not be aligned)
+/**
+* The number of blocks must fit in the image, and must be at most \c UINT32_MAX (as \c block_index requires).
+* \throw std::invalid_argument if the image is not valid
+*/
+[[nodiscard]] inline image_header
+read_image_header(const std::span<const std::byte> image)
+{
+    image_header header{};
+    if (std::size(image) < sizeof(header))
+        throw std::invalid_argument("blocked_bloom_filter: invalid image");
+    (void)std::memcpy(&header, std::data(image), sizeof(header));
+
+    if (header.magic != image_magic || header.num_blocks == 0 || header.num_blocks > UINT32_MAX ||
+        header.num_blocks > (std::size(image) - sizeof(header)) / sizeof(block))
+        throw std::invalid_argument("blocked_bloom_filter: invalid image");
+
+    return header;
+}
+
+/// Check the header of the image \a image, and get the blocks
+/**
+* \throw std::invalid_argument if the image is not valid or not aligned
+*/
+[[nodiscard]] inline std::span<const block>
+image_blocks(const std::span<const std::byte> image, uint64_t& seed)
+{
+    const image_header header = read_image_header(image);
+
+    if (reinterpret_cast<uintptr_t>(std::data(image)) % alignof(image_header) != 0)
+        throw std::invalid_argument("blocked_bloom_filter: invalid image");
+
+    seed = header.seed;
+    return {reinterpret_cast<const block*>(std::data(image) + sizeof(header)), header.num_blocks};
+}
+
+[[nodiscard]] inline uint64_t
+hash_key(const uint64_t key, const uint64_t seed) noexcept
+{
+    return wyhash64(key, seed);
+}
+
+[[nodiscard]] inline uint64_t
+hash_key(const std::string_view key, const uint64_t seed) noexcept
+{
+    return wyhash64(fnv1a_64(key), seed);
+}
+
+}
+
+/// A blocked Bloom filter
+/**
+* There are no false negatives.
+* Keys can not be removed (see \c quotient_filter).
+*/
+class blocked_bloom_filter final
+{
+public:
+
+    /// Make a filter for about \a num_keys keys with \a bits_per_key bits per key
+    /**
+    * More bits per key give fewer false positives.
+    * \throw std::invalid_argument if \a bits_per_key is not positive
+    */
+    explicit blocked_bloom_filter(const size_t num_keys, const double bits_per_key = 12.0, const uint64_t seed = 0) :
+        seed_{seed}
+    {
+        if (!(bits_per_key > 0.0))
+            throw std::invalid_argument("blocked_bloom_filter");
+
+        const double num_bits = std::ceil(static_cast<double>(num_keys) * bits_per_key);
+        const auto num_blocks = static_cast<size_t>(std::ceil(num_bits / (8.0 * sizeof(block))));
+        blocks_.resize(std::clamp<size_t>(num_blocks, 1, UINT32_MAX));
+    }
+
+    /// Copy the filter in the image \a image (which need not be aligned)
+    /**
+    * \throw std::invalid_argument if the image is not valid
+    */
+    [[nodiscard]] static blocked_bloom_filter
+    from_image(const std::span<const std::byte> image)
+    {
+        const image_header header = bloom_filter_detail::read_image_header(image);
+
+        blocked_bloom_filter result(0, 1.0, header.seed);
+        result.blocks_.resize(header.num_blocks);
+        (void)std::memcpy(result.blocks_.data(), std::data(image) + sizeof(header), result.size_bytes());
+        return result;
+    }
+
+    void insert(const uint64_t key) noexcept
+    {
+        bloom_filter_detail::insert(blocks_.data(), blocks_.size(), bloom_filter_detail::hash_key(key, seed_));
+    }
+
+    void insert(const std::string_view key) noexcept
+    {
+        bloom_filter_detail::insert(blocks_.data(), blocks_.size(), bloom_filter_detail::hash_key(key, seed_));
+    }
+
+    /// Is \a key possibly in the filter?
+    [[nodiscard]] bool contains(const uint64_t key) const noexcept
+    {
+        return bloom_filter_detail::contains(blocks_.data(), blocks_.size(), bloom_filter_detail::hash_key(key, seed_));
+    }
+
+    [[nodiscard]] bool contains(const std::string_view key) const noexcept
+    {
+        return bloom_filter_detail::contains(blocks_.data(), blocks_.size(), bloom_filter_detail::hash_key(key, seed_));
+    }
+
+    void clear() noexcept
+    {
+        std::ranges::fill(blocks_, block{});
+    }
+
+    /// the size of the filter in bytes
+    [[nodiscard]] size_t size_bytes() const noexcept { return blocks_.size() * sizeof(block); }
+
+    /// the size of the image in bytes
+    [[nodiscard]] size_t image_size() const noexcept { return sizeof(image_header) + size_bytes(); }
+
+    /// Write the image of the filter to \a buf
+    /**
+    * \throw std::invalid_argument if \a buf is smaller than \c image_size()
+    */
+    void write_image(const std::span<std::byte> buf) const
+    {
+        if (std::size(buf) < image_size())
+            throw std::invalid_argument("blocked_bloom_filter::write_image");
+
+        // Value-initialize the header so its padding is zeroed.
+        image_header header{};
+        header.magic = bloom_filter_detail::image_magic;
+        header.seed = seed_;
+        header.num_blocks = blocks_.size();
+        (void)std::memcpy(std::data(buf), &header, sizeof(header));
+        (void)std::memcpy(std::data(buf) + sizeof(header), blocks_.data(), size_bytes());
+    }
+
+    /// Get the image of the filter
+    [[nodiscard]] std::vector<std::byte> image() const
+    {
+        std::vector<std::byte> result(image_size());
+        write_image(result);
+        return result;
+    }
+
+private:
+
+    using block = bloom_filter_detail::block;
+    using image_header = bloom_filter_detail::image_header;
+
+    uint64_t seed_;
+    std::vector<block> blocks_;
+};
+
+/// A read-only blocked Bloom filter in an image that is not copied
+/**
+* The image must be aligned to 64 bytes (as \c mmap is), and it must outlive the view.
+*/
+class blocked_bloom_filter_view final
+{
+public:
+
+    /// \throw std::invalid_argument if the image is not valid
+    explicit blocked_bloom_filter_view(const std::span<const std::byte> image) :
+        blocks_{bloom_filter_detail::image_blocks(image, seed_)}
+    {
+    }
+
+    /// Is \a key possibly in the filter?
+    [[nodiscard]] bool contains(const uint64_t key) const noexcept
+    {
+        return bloom_filter_detail::contains(std::data(blocks_), std::size(blocks_),
+                                             bloom_filter_detail::hash_key(key, seed_));
+    }
+
+    [[nodiscard]] bool contains(const std::string_view key) const noexcept
+    {
+        return bloom_filter_detail::contains(std::data(blocks_), std::size(blocks_),
+                                             bloom_filter_detail::hash_key(key, seed_));
+    }
+
+private:
+
+    uint64_t seed_ = 0;
+    std::span<const bloom_filter_detail::block> blocks_;
+};
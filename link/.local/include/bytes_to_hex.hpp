@@ -5,15 +5,24 @@
 /**
 * \file
 * \author Steven Ward
+* The nibbles are converted to characters with a \c PSHUFB lookup (if SSSE3 or AVX2 is available).
+* \sa http://0x80.pl/notesen/2022-01-17-conversions.html
+* \sa hex_to_bytes.hpp
 */
 
 #pragma once
 
+#include "i_to_chars.hpp"
+
 #include <cstddef>
 #include <cstdint>
 #include <span>
 #include <string>
 
+#if defined(__SSSE3__)
+#include <immintrin.h>
+#endif
+
 /// Convert a nibble to a character
 /**
 * \param x the nibble value to convert
@@ -26,6 +35,66 @@ nibble_char(const uint8_t x) noexcept
     return static_cast<char>(x + (x < 10 ? '0' : -10 + 'a'));
 }
 
+/// Convert a span of bytes to hexadecimal characters
+/**
+* \param byte_sp the bytes to convert
+* \param buf the output buffer
+* \pre \a buf has room for <code>std::size(byte_sp) * 2</code> characters.
+* \return one past the last character written
+*/
+static char*
+bytes_to_hex(const std::span<const std::byte> byte_sp, char* buf) noexcept
+{
+    const auto* src = reinterpret_cast<const uint8_t*>(std::data(byte_sp));
+    const auto* const src_end = src + std::size(byte_sp);
+
+#if defined(__AVX2__)
+    {
+        const __m256i table = _mm256_broadcastsi128_si256(
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(hex_digits)));
+        const __m256i mask = _mm256_set1_epi8(0x0F);
+
+        // 32 bytes in, 64 characters out
+        for (; src_end - src >= 32; src += 32, buf += 64)
+        {
+            const __m256i bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src));
+            const __m256i hi = _mm256_shuffle_epi8(table, _mm256_and_si256(_mm256_srli_epi16(bytes, 4), mask));
+            const __m256i lo = _mm256_shuffle_epi8(table, _mm256_and_si256(bytes, mask));
+            // Interleave within each 128-bit lane, then put the lanes in order.
+            const __m256i a = _mm256_unpacklo_epi8(hi, lo); // bytes 0-7, 16-23
+            const __m256i b = _mm256_unpackhi_epi8(hi, lo); // bytes 8-15, 24-31
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(buf), _mm256_permute2x128_si256(a, b, 0x20));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(buf + 32), _mm256_permute2x128_si256(a, b, 0x31));
+        }
+    }
+#endif
+
+#if defined(__SSSE3__)
+    {
+        const __m128i table = _mm_loadu_si128(reinterpret_cast<const __m128i*>(hex_digits));
+        const __m128i mask = _mm_set1_epi8(0x0F);
+
+        // 16 bytes in, 32 characters out
+        for (; src_end - src >= 16; src += 16, buf += 32)
+        {
+            const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+            const __m128i hi = _mm_shuffle_epi8(table, _mm_and_si128(_mm_srli_epi16(bytes, 4), mask));
+            const __m128i lo = _mm_shuffle_epi8(table, _mm_and_si128(bytes, mask));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(buf), _mm_unpacklo_epi8(hi, lo));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(buf + 16), _mm_unpackhi_epi8(hi, lo));
+        }
+    }
+#endif
+
+    for (; src != src_end; ++src)
+    {
+        *buf++ = nibble_char(*src >> 4);
+        *buf++ = nibble_char(*src & 0x0F);
+    }
+
+    return buf;
+}
+
 /// Convert a span of bytes to a hexadecimal string
 /**
 * \param byte_sp the bytes to convert
@@ -38,15 +107,7 @@ bytes_to_hex(const std::span<const std::byte> byte_sp)
 
     std::string result(result_len, '\0'); // size == result_len
 
-    size_t i = 0;
-    for (const auto b : byte_sp)
-    {
-        const auto val = std::to_integer<uint8_t>(b);
-        const uint8_t hi = val >> 4;
-        const uint8_t lo = val & 0x0F;
-        result[i++] = nibble_char(hi);
-        result[i++] = nibble_char(lo);
-    }
+    (void)bytes_to_hex(byte_sp, result.data());
 
     return result;
 }
@@ -136,6 +136,57 @@ circqueue_pop(circqueue* cq, void* x)
     return true;
 }
 
+/// remove the element at the back (the one pushed last), so the queue can be used as a deque
+static bool
+circqueue_pop_back(circqueue* cq, void* x)
+{
+    if (circqueue_is_empty(cq))
+        return false;
+
+    if (cq->tail == 0)                // tail rollunder
+        cq->tail = cq->max_num_elems;
+    --cq->tail;                       // dec tail
+
+    if (x)
+        (void)memcpy(x, (char*)cq->buf + cq->tail * cq->sizeof_elem, cq->sizeof_elem);
+
+    // reset element
+    (void)memset((char*)cq->buf + cq->tail * cq->sizeof_elem, 0, cq->sizeof_elem);
+
+    // was not empty
+    --cq->num_elems;
+
+    return true;
+}
+
+/// get a pointer to the \a i th element from the front (or \c nullptr if out of range)
+static void*
+circqueue_at(const circqueue* cq, size_t i)
+{
+    if (i >= cq->num_elems)
+        return nullptr;
+
+    i += cq->head;
+    if (i >= cq->max_num_elems)
+        i -= cq->max_num_elems;
+
+    return (char*)cq->buf + i * cq->sizeof_elem;
+}
+
+/// get a pointer to the element at the front (or \c nullptr if empty)
+static void*
+circqueue_front(const circqueue* cq)
+{
+    return circqueue_at(cq, 0);
+}
+
+/// get a pointer to the element at the back (or \c nullptr if empty)
+static void*
+circqueue_back(const circqueue* cq)
+{
+    return circqueue_is_empty(cq) ? nullptr : circqueue_at(cq, cq->num_elems - 1);
+}
+
 static void
 circqueue_reset(circqueue* cq)
 {
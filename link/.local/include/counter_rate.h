@@ -0,0 +1,45 @@
+// SPDX-FileCopyrightText: Steven Ward
+// SPDX-License-Identifier: MPL-2.0
+
+/// Get the rate of a counter between two samples
+/**
+* \file
+* \author Steven Ward
+* \sa rtnl_link_stats.h
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+#if defined(__cplusplus)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wold-style-cast"
+#endif
+
+/// Get the rate (per second) of a counter, rounded to the nearest int
+/**
+* \a count can be less than \a prev_count if the counter was reset (e.g. link down/up),
+* or if it wrapped around (e.g. the 32-bit counters of some drivers);
+* that sample is treated as 0 instead of letting the unsigned subtraction wrap around.
+*/
+static inline uintmax_t
+counter_rate(uint64_t count, uint64_t prev_count, uint64_t delta_time_ns)
+{
+    if (delta_time_ns == 0 || count < prev_count)
+        return 0;
+
+    return (uintmax_t)((double)(count - prev_count) * 1E9 / (double)delta_time_ns + 0.5);
+}
+
+#if defined(__cplusplus)
+#pragma GCC diagnostic pop
+#endif
+
+#if defined(__cplusplus)
+} // extern "C"
+#endif
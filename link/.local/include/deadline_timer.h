@@ -0,0 +1,140 @@
+// SPDX-FileCopyrightText: Steven Ward
+// SPDX-License-Identifier: MPL-2.0
+
+/// A timer that expires at absolute deadlines on \c CLOCK_MONOTONIC
+/**
+* \file
+* \author Steven Ward
+* The deadlines are (start + init_delay + k * interval), so the expirations do
+* not drift, unlike re-armed relative timers.
+* Missed deadlines are not made up.
+* \sa https://man7.org/linux/man-pages/man2/timerfd_create.2.html
+* \sa https://man7.org/linux/man-pages/man2/ppoll.2.html
+*/
+
+#pragma once
+
+#include "timespec.h"
+
+#include <err.h>
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdint.h>
+#include <sys/timerfd.h>
+#include <time.h>
+#include <unistd.h>
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+#if defined(__cplusplus)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wold-style-cast"
+#pragma GCC diagnostic ignored "-Wredundant-tags"
+#endif
+
+struct deadline_timer
+{
+    int fd;
+    struct timespec init_delay;
+    struct timespec interval;
+};
+
+static void
+deadline_timer_close(struct deadline_timer* t)
+{
+    if (t->fd >= 0)
+        (void)close(t->fd);
+    t->fd = -1;
+}
+
+/// Create the timer (it is not armed until \c deadline_timer_start)
+/**
+* \retval 0 success
+* \retval -1 failure (a warning is printed)
+*/
+static int
+deadline_timer_open(struct deadline_timer* t, unsigned int init_delay_msec, unsigned int interval_msec)
+{
+    t->init_delay = msec_to_timespec(init_delay_msec);
+    t->interval = msec_to_timespec(interval_msec);
+
+    t->fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (t->fd < 0)
+    {
+        warn("timerfd_create");
+        return -1;
+    }
+
+    return 0;
+}
+
+/// Start (or restart) the deadlines from now
+/**
+* \retval 0 success
+* \retval -1 failure (a warning is printed)
+*/
+static int
+deadline_timer_start(const struct deadline_timer* t)
+{
+    struct timespec start_ts;
+
+    if (clock_gettime(CLOCK_MONOTONIC, &start_ts) < 0)
+    {
+        warn("clock_gettime");
+        return -1;
+    }
+
+    struct itimerspec its = {.it_interval = t->interval, .it_value = {0, 0}};
+    timespecadd(&start_ts, &t->init_delay, &its.it_value);
+
+    if (timerfd_settime(t->fd, TFD_TIMER_ABSTIME, &its, nullptr) < 0)
+    {
+        warn("timerfd_settime");
+        return -1;
+    }
+
+    return 0;
+}
+
+/// Wait for the next deadline, or a signal (with the signal mask \a sigmask)
+/**
+* \retval 0 a deadline passed, or a signal was caught
+* \retval -1 failure (a warning is printed)
+*/
+static int
+deadline_timer_wait(const struct deadline_timer* t, const sigset_t* sigmask)
+{
+    struct pollfd pfd = {.fd = t->fd, .events = POLLIN, .revents = 0};
+
+    const int n = ppoll(&pfd, 1, nullptr, sigmask);
+    if (n < 0)
+    {
+        if (errno == EINTR)
+            return 0;
+        warn("ppoll");
+        return -1;
+    }
+
+    if (n > 0)
+    {
+        uint64_t num_expirations = 0;
+        if (read(t->fd, &num_expirations, sizeof(num_expirations)) < 0 && errno != EAGAIN)
+        {
+            warn("read");
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+#if defined(__cplusplus)
+#pragma GCC diagnostic pop
+#endif
+
+#if defined(__cplusplus)
+} // extern "C"
+#endif
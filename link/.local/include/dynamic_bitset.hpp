@@ -0,0 +1,529 @@
+// SPDX-FileCopyrightText: Steven Ward
+// SPDX-License-Identifier: MPL-2.0
+
+/// A bitset whose size is set at runtime, with SIMD bulk operations and a rank/select index
+/**
+* \file
+* \author Steven Ward
+* The bits are stored in 64-bit words; bit \c i is bit <code>i % 64</code> of word <code>i / 64</code>.
+* The unused bits of the last word are always 0.
+*
+* The bulk operations (AND, OR, XOR, ANDNOT) process 256 bits at a time with AVX2.
+* \c popcount_words counts the bits of a buffer with \c VPOPCNTQ (AVX-512 VPOPCNTDQ),
+* or with the Harley-Seal carry-save adder tree (AVX2), or with \c std::popcount.
+*
+* \sa https://arxiv.org/abs/1611.07612
+* \sa https://www.cs.cmu.edu/~dga/papers/zhou-sea2013.pdf
+* \sa bitmask.hpp
+* \sa simd_popcount.hpp
+*/
+
+#pragma once
+
+#include "bitmask.hpp"
+#if defined(__AVX2__)
+#include "simd_popcount.hpp"
+#endif
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <stdexcept>
+#include <vector>
+
+#if defined(__AVX2__) || defined(__BMI2__)
+#include <immintrin.h>
+#endif
+
+namespace dynamic_bitset_detail
+{
+
+// the word-wise operations (for one word, or for 4 words with AVX2)
+
+struct bit_and
+{
+    [[nodiscard]] static uint64_t apply(const uint64_t a, const uint64_t b) noexcept { return a & b; }
+#if defined(__AVX2__)
+    [[nodiscard]] static __m256i apply(const __m256i a, const __m256i b) noexcept { return _mm256_and_si256(a, b); }
+#endif
+};
+
+struct bit_or
+{
+    [[nodiscard]] static uint64_t apply(const uint64_t a, const uint64_t b) noexcept { return a | b; }
+#if defined(__AVX2__)
+    [[nodiscard]] static __m256i apply(const __m256i a, const __m256i b) noexcept { return _mm256_or_si256(a, b); }
+#endif
+};
+
+struct bit_xor
+{
+    [[nodiscard]] static uint64_t apply(const uint64_t a, const uint64_t b) noexcept { return a ^ b; }
+#if defined(__AVX2__)
+    [[nodiscard]] static __m256i apply(const __m256i a, const __m256i b) noexcept { return _mm256_xor_si256(a, b); }
+#endif
+};
+
+struct bit_and_not
+{
+    [[nodiscard]] static uint64_t apply(const uint64_t a, const uint64_t b) noexcept { return a & ~b; }
+#if defined(__AVX2__)
+    // _mm256_andnot_si256 computes ~first & second
+    [[nodiscard]] static __m256i apply(const __m256i a, const __m256i b) noexcept { return _mm256_andnot_si256(b, a); }
+#endif
+};
+
+#if defined(__AVX2__) && !defined(__AVX512VPOPCNTDQ__)
+/// carry-save adder: (\a h, \a l) = \a a + \a b + \a c (for each bit)
+inline void
+csa(__m256i& h, __m256i& l, const __m256i a, const __m256i b, const __m256i c) noexcept
+{
+    const __m256i u = _mm256_xor_si256(a, b);
+    h = _mm256_or_si256(_mm256_and_si256(a, b), _mm256_and_si256(u, c));
+    l = _mm256_xor_si256(u, c);
+}
+
+[[nodiscard]] inline __m256i
+load(const uint64_t* const p) noexcept
+{
+    return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+}
+
+/// Count the bits of \a n vectors at \a p with the Harley-Seal method
+[[nodiscard]] inline uint64_t
+harley_seal(const uint64_t* const p, const size_t n) noexcept
+{
+    __m256i ones = _mm256_setzero_si256();
+    __m256i twos = _mm256_setzero_si256();
+    __m256i fours = _mm256_setzero_si256();
+    __m256i eights = _mm256_setzero_si256();
+    __m256i sixteens;
+    __m256i twos_a, twos_b, fours_a, fours_b, eights_a, eights_b;
+
+    uint64_t total = 0;
+    size_t i = 0;
+
+    // 16 vectors are reduced to 1 popcount
+    for (; i + 16 <= n; i += 16)
+    {
+        const uint64_t* const q = p + i * 4;
+        csa(twos_a, ones, ones, load(q + 0), load(q + 4));
+        csa(twos_b, ones, ones, load(q + 8), load(q + 12));
+        csa(fours_a, twos, twos, twos_a, twos_b);
+        csa(twos_a, ones, ones, load(q + 16), load(q + 20));
+        csa(twos_b, ones, ones, load(q + 24), load(q + 28));
+        csa(fours_b, twos, twos, twos_a, twos_b);
+        csa(eights_a, fours, fours, fours_a, fours_b);
+        csa(twos_a, ones, ones, load(q + 32), load(q + 36));
+        csa(twos_b, ones, ones, load(q + 40), load(q + 44));
+        csa(fours_a, twos, twos, twos_a, twos_b);
+        csa(twos_a, ones, ones, load(q + 48), load(q + 52));
+        csa(twos_b, ones, ones, load(q + 56), load(q + 60));
+        csa(fours_b, twos, twos, twos_a, twos_b);
+        csa(eights_b, fours, fours, fours_a, fours_b);
+        csa(sixteens, eights, eights, eights_a, eights_b);
+
+        total += static_cast<uint64_t>(simd_popcount(sixteens));
+    }
+
+    total = 16 * total +
+            8 * static_cast<uint64_t>(simd_popcount(eights)) +
+            4 * static_cast<uint64_t>(simd_popcount(fours)) +
+            2 * static_cast<uint64_t>(simd_popcount(twos)) +
+            static_cast<uint64_t>(simd_popcount(ones));
+
+    for (; i < n; ++i)
+        total += static_cast<uint64_t>(simd_popcount(load(p + i * 4)));
+
+    return total;
+}
+#endif
+
+}
+
+/// Count the 1-bits in \a words
+[[nodiscard]] inline uint64_t
+popcount_words(const std::span<const uint64_t> words) noexcept
+{
+    const uint64_t* const p = std::data(words);
+    const size_t n = std::size(words);
+    uint64_t total = 0;
+    size_t i = 0;
+
+#if defined(__AVX512VPOPCNTDQ__)
+    __m512i sum = _mm512_setzero_si512();
+    for (; i + 8 <= n; i += 8)
+        sum = _mm512_add_epi64(sum, _mm512_popcnt_epi64(_mm512_loadu_si512(p + i)));
+    total = static_cast<uint64_t>(_mm512_reduce_add_epi64(sum));
+#elif defined(__AVX2__)
+    total = dynamic_bitset_detail::harley_seal(p, n / 4);
+    i = n / 4 * 4;
+#endif
+
+    for (; i < n; ++i)
+        total += static_cast<uint64_t>(std::popcount(p[i]));
+
+    return total;
+}
+
+/// A bitset whose size is set at runtime
+class dynamic_bitset final
+{
+public:
+
+    using word_type = uint64_t;
+
+    static constexpr size_t bits_per_word = 64;
+
+    /// the value returned when a bit is not found
+    static constexpr size_t npos = SIZE_MAX;
+
+    dynamic_bitset() = default;
+
+    explicit dynamic_bitset(const size_t num_bits, const bool value = false) :
+        words_(num_words_for(num_bits), value ? ~word_type{0} : word_type{0}),
+        size_{num_bits}
+    {
+        clear_unused_bits();
+    }
+
+    // {{{ size
+
+    /// the number of bits
+    [[nodiscard]] size_t size() const noexcept { return size_; }
+
+    [[nodiscard]] bool empty() const noexcept { return size_ == 0; }
+
+    /// Change the number of bits; new bits are set to \a value
+    void resize(const size_t num_bits, const bool value = false)
+    {
+        if (value && num_bits > size_)
+        {
+            // Set the unused bits of the last word (they become used).
+            if (size_ % bits_per_word != 0)
+                words_.back() |= bitmask_highpass<word_type>(static_cast<unsigned int>(size_ % bits_per_word));
+        }
+
+        words_.resize(num_words_for(num_bits), value ? ~word_type{0} : word_type{0});
+        size_ = num_bits;
+        clear_unused_bits();
+    }
+
+    /// the words of the bitset
+    [[nodiscard]] std::span<const word_type> words() const noexcept { return words_; }
+
+    // }}}
+
+    // {{{ single bits
+
+    [[nodiscard]] bool test(const size_t i) const
+    {
+        check_index(i);
+        return (*this)[i];
+    }
+
+    /// Get bit \a i (without checking \a i)
+    [[nodiscard]] bool operator[](const size_t i) const noexcept
+    {
+        return get_bit(words_[i / bits_per_word], static_cast<unsigned int>(i % bits_per_word));
+    }
+
+    dynamic_bitset& set(const size_t i, const bool value = true)
+    {
+        check_index(i);
+        if (value)
+            set_bit(words_[i / bits_per_word], static_cast<unsigned int>(i % bits_per_word));
+        else
+            reset_bit(words_[i / bits_per_word], static_cast<unsigned int>(i % bits_per_word));
+        return *this;
+    }
+
+    dynamic_bitset& reset(const size_t i)
+    {
+        return set(i, false);
+    }
+
+    dynamic_bitset& flip(const size_t i)
+    {
+        check_index(i);
+        toggle_bit(words_[i / bits_per_word], static_cast<unsigned int>(i % bits_per_word));
+        return *this;
+    }
+
+    // }}}
+
+    // {{{ all bits
+
+    dynamic_bitset& set() noexcept
+    {
+        std::ranges::fill(words_, ~word_type{0});
+        clear_unused_bits();
+        return *this;
+    }
+
+    dynamic_bitset& reset() noexcept
+    {
+        std::ranges::fill(words_, word_type{0});
+        return *this;
+    }
+
+    dynamic_bitset& flip() noexcept
+    {
+        for (auto& w : words_)
+            w = ~w;
+        clear_unused_bits();
+        return *this;
+    }
+
+    /// the number of set bits
+    [[nodiscard]] size_t count() const noexcept
+    {
+        return popcount_words(words_);
+    }
+
+    [[nodiscard]] bool any() const noexcept
+    {
+        return std::ranges::any_of(words_, [](const word_type w) { return w != 0; });
+    }
+
+    [[nodiscard]] bool none() const noexcept { return !any(); }
+
+    [[nodiscard]] bool all() const noexcept { return count() == size_; }
+
+    /// Get the index of the first set bit, or \c npos
+    [[nodiscard]] size_t find_first() const noexcept
+    {
+        return find_from_word(0);
+    }
+
+    /// Get the index of the first set bit after \a i, or \c npos
+    [[nodiscard]] size_t find_next(const size_t i) const noexcept
+    {
+        const size_t next = i + 1;
+        if (next >= size_)
+            return npos;
+
+        const size_t wi = next / bits_per_word;
+        const word_type w = words_[wi] & bitmask_highpass<word_type>(static_cast<unsigned int>(next % bits_per_word));
+        if (w != 0)
+            return wi * bits_per_word + static_cast<size_t>(std::countr_zero(w));
+
+        return find_from_word(wi + 1);
+    }
+
+    // }}}
+
+    // {{{ bulk operations
+
+    /// \throw std::invalid_argument if the sizes are different
+    dynamic_bitset& operator&=(const dynamic_bitset& that)
+    {
+        bulk_op<dynamic_bitset_detail::bit_and>(that, "dynamic_bitset::operator&=");
+        return *this;
+    }
+
+    /// \throw std::invalid_argument if the sizes are different
+    dynamic_bitset& operator|=(const dynamic_bitset& that)
+    {
+        bulk_op<dynamic_bitset_detail::bit_or>(that, "dynamic_bitset::operator|=");
+        return *this;
+    }
+
+    /// \throw std::invalid_argument if the sizes are different
+    dynamic_bitset& operator^=(const dynamic_bitset& that)
+    {
+        bulk_op<dynamic_bitset_detail::bit_xor>(that, "dynamic_bitset::operator^=");
+        return *this;
+    }
+
+    /// Clear the bits that are set in \a that (i.e. <code>*this &= ~that</code>)
+    /**
+    * \throw std::invalid_argument if the sizes are different
+    */
+    dynamic_bitset& and_not(const dynamic_bitset& that)
+    {
+        bulk_op<dynamic_bitset_detail::bit_and_not>(that, "dynamic_bitset::and_not");
+        return *this;
+    }
+
+    [[nodiscard]] dynamic_bitset operator~() const
+    {
+        dynamic_bitset result(*this);
+        result.flip();
+        return result;
+    }
+
+    [[nodiscard]] friend dynamic_bitset operator&(dynamic_bitset a, const dynamic_bitset& b) { return a &= b; }
+    [[nodiscard]] friend dynamic_bitset operator|(dynamic_bitset a, const dynamic_bitset& b) { return a |= b; }
+    [[nodiscard]] friend dynamic_bitset operator^(dynamic_bitset a, const dynamic_bitset& b) { return a ^= b; }
+
+    // }}}
+
+    friend bool operator==(const dynamic_bitset& a, const dynamic_bitset& b) noexcept
+    {
+        return a.size_ == b.size_ && a.words_ == b.words_;
+    }
+
+private:
+
+    std::vector<word_type> words_;
+    size_t size_ = 0;
+
+    [[nodiscard]] static size_t num_words_for(const size_t num_bits) noexcept
+    {
+        return (num_bits + bits_per_word - 1) / bits_per_word;
+    }
+
+    void check_index(const size_t i) const
+    {
+        if (i >= size_)
+            throw std::out_of_range("dynamic_bitset");
+    }
+
+    void clear_unused_bits() noexcept
+    {
+        if (size_ % bits_per_word != 0)
+            words_.back() &= bitmask_lowpass<word_type>(static_cast<unsigned int>(size_ % bits_per_word));
+    }
+
+    [[nodiscard]] size_t find_from_word(size_t wi) const noexcept
+    {
+        for (; wi < words_.size(); ++wi)
+        {
+            if (words_[wi] != 0)
+                return wi * bits_per_word + static_cast<size_t>(std::countr_zero(words_[wi]));
+        }
+        return npos;
+    }
+
+    /// Apply the word-wise operation \a Op (the unused bits stay 0 for AND, OR, XOR, and ANDNOT)
+    template <typename Op>
+    void bulk_op(const dynamic_bitset& that, const char* const name)
+    {
+        if (size_ != that.size_)
+            throw std::invalid_argument(name);
+
+        word_type* const a = words_.data();
+        const word_type* const b = that.words_.data();
+        const size_t n = words_.size();
+        size_t i = 0;
+
+#if defined(__AVX2__)
+        for (; i + 4 <= n; i += 4)
+        {
+            auto* const pa = reinterpret_cast<__m256i*>(a + i);
+            const auto* const pb = reinterpret_cast<const __m256i*>(b + i);
+            _mm256_storeu_si256(pa, Op::apply(_mm256_loadu_si256(pa), _mm256_loadu_si256(pb)));
+        }
+#endif
+
+        for (; i < n; ++i)
+            a[i] = Op::apply(a[i], b[i]);
+    }
+};
+
+/// A rank/select index of a \c dynamic_bitset
+/**
+* The index stores the number of set bits before each block of 512 bits (8 words),
+* so \c rank reads one count and popcounts at most 8 words,
+* and \c select does a binary search of the counts, then scans at most 8 words.
+* The index uses about 12.5% of the size of the bitset.
+* The bitset must outlive the index, and it must not be modified after the index is made.
+*/
+class bitset_rank_select final
+{
+public:
+
+    static constexpr size_t npos = dynamic_bitset::npos;
+
+    explicit bitset_rank_select(const dynamic_bitset& bits) :
+        bits_{&bits}
+    {
+        const auto words = bits.words();
+        const size_t num_blocks = (std::size(words) + words_per_block - 1) / words_per_block;
+
+        block_ranks_.reserve(num_blocks + 1);
+        uint64_t rank = 0;
+        for (size_t b = 0; b < num_blocks; ++b)
+        {
+            block_ranks_.push_back(rank);
+            const size_t first = b * words_per_block;
+            rank += popcount_words(words.subspan(first, std::min(words_per_block, std::size(words) - first)));
+        }
+        block_ranks_.push_back(rank);
+    }
+
+    /// the number of set bits
+    [[nodiscard]] size_t count() const noexcept { return block_ranks_.back(); }
+
+    /// Get the number of set bits in [0, \a i)
+    /**
+    * \throw std::out_of_range if \a i is greater than the size of the bitset
+    */
+    [[nodiscard]] size_t rank(const size_t i) const
+    {
+        if (i > bits_->size())
+            throw std::out_of_range("bitset_rank_select::rank");
+
+        const auto words = bits_->words();
+        const size_t wi = i / 64;
+        const size_t first = wi / words_per_block * words_per_block;
+
+        size_t result = block_ranks_[wi / words_per_block];
+        for (size_t j = first; j < wi; ++j)
+            result += static_cast<size_t>(std::popcount(words[j]));
+
+        if (i % 64 != 0)
+            result += static_cast<size_t>(std::popcount(words[wi] & bitmask_lowpass<uint64_t>(static_cast<unsigned int>(i % 64))));
+
+        return result;
+    }
+
+    /// Get the number of unset bits in [0, \a i)
+    [[nodiscard]] size_t rank0(const size_t i) const
+    {
+        return i - rank(i);
+    }
+
+    /// Get the index of the set bit with rank \a k (i.e. the (\a k + 1)th set bit), or \c npos
+    [[nodiscard]] size_t select(size_t k) const noexcept
+    {
+        if (k >= count())
+            return npos;
+
+        // the last block whose rank is <= k
+        const auto iter = std::ranges::upper_bound(block_ranks_, k);
+        const auto b = static_cast<size_t>(iter - block_ranks_.cbegin()) - 1;
+        k -= block_ranks_[b];
+
+        const auto words = bits_->words();
+        for (size_t wi = b * words_per_block;; ++wi)
+        {
+            const auto n = static_cast<size_t>(std::popcount(words[wi]));
+            if (k < n)
+                return wi * 64 + select_in_word(words[wi], static_cast<unsigned int>(k));
+            k -= n;
+        }
+    }
+
+private:
+
+    static constexpr size_t words_per_block = 8;
+
+    const dynamic_bitset* bits_;
+    std::vector<uint64_t> block_ranks_; // the number of set bits before each block (and the total)
+
+    /// Get the index of the set bit with rank \a k in \a w
+    [[nodiscard]] static size_t select_in_word(uint64_t w, unsigned int k) noexcept
+    {
+#if defined(__BMI2__)
+        return static_cast<size_t>(std::countr_zero(_pdep_u64(uint64_t{1} << k, w)));
+#else
+        for (; k > 0; --k)
+            w &= w - 1; // clear the lowest set bit
+        return static_cast<size_t>(std::countr_zero(w));
+#endif
+    }
+};
@@ -5,13 +5,23 @@
 /**
 * \file
 * \author Steven Ward
+* The \c f_to_chars functions write into a caller buffer (e.g. on the stack) and do not allocate.
+* The size of the buffer is bounded by \c f_chars_max, which is computed from \c std::numeric_limits.
+* If the precision is omitted, the shortest representation that round-trips is written.
 * \sa https://en.cppreference.com/w/cpp/utility/to_chars
 */
 
 #pragma once
 
+#include "decltype_unqual.hpp"
+#include "i_to_chars.hpp"
+
+#include <algorithm>
 #include <charconv>
 #include <concepts>
+#include <cstddef>
+#include <limits>
+#include <span>
 #include <string>
 
 void
@@ -22,25 +32,229 @@ resize_to_nul(std::string& s)
         s.resize(i);
 }
 
-std::string
-f_to_s(const std::floating_point auto x,
-       const std::chars_format chars_format,
-       const int precision)
+namespace f_to_s_detail
+{
+
+/// the maximum number of digits of a decimal exponent of type \a T
+template <std::floating_point T>
+inline constexpr size_t exp10_chars = std::max<size_t>(2,
+    dec_digits(static_cast<unsigned int>(std::max(
+        std::numeric_limits<T>::max_exponent10,
+        // the exponent of the smallest subnormal number
+        -std::numeric_limits<T>::min_exponent10 + std::numeric_limits<T>::digits10 + 1))));
+
+/// the maximum number of digits of a binary exponent of type \a T
+template <std::floating_point T>
+inline constexpr size_t exp2_chars =
+    dec_digits(static_cast<unsigned int>(std::max(
+        std::numeric_limits<T>::max_exponent,
+        // the exponent of the smallest subnormal number
+        -std::numeric_limits<T>::min_exponent + std::numeric_limits<T>::digits)));
+
+/// the maximum number of integer digits of a value of type \a T
+template <std::floating_point T>
+inline constexpr size_t int_chars = std::numeric_limits<T>::max_exponent10 + 1;
+
+/// the maximum number of fraction digits of the shortest representation of a value of type \a T
+template <std::floating_point T>
+inline constexpr size_t frac_chars = -std::numeric_limits<T>::min_exponent10 +
+                                     std::numeric_limits<T>::digits10 + 1 +
+                                     std::numeric_limits<T>::max_digits10;
+
+/// the number of hexadecimal digits after the point of the exact representation of a value of type \a T
+template <std::floating_point T>
+inline constexpr size_t hex_frac_chars = (std::numeric_limits<T>::digits + 2) / 4;
+
+/// Get the precision that \c std::to_chars uses for \a precision
+[[nodiscard]] constexpr size_t
+get_precision(const int precision, const size_t default_precision) noexcept
+{
+    return precision < 0 ? default_precision : static_cast<size_t>(precision);
+}
+
+/// Call \a write with a buffer of at least \a n characters and return the characters written
+/**
+* The buffer is on the stack if it is small enough, so only the result is allocated.
+*/
+template <typename F>
+[[nodiscard]] std::string
+to_string(const size_t n, F&& write)
 {
-    std::string s;
-    std::to_chars_result r{};
+    // Large enough for the shortest representation of a double in any format
+    constexpr size_t stack_buf_size = 512;
 
-    do
+    if (n <= stack_buf_size)
     {
-        s.resize(s.size() + 64);
-        r = std::to_chars(s.data(), s.data() + s.size(), x, chars_format, precision);
+        char buf[stack_buf_size];
+        return std::string(buf, write(buf));
     }
-    while (r.ec == std::errc::value_too_large);
 
-    resize_to_nul(s);
+    std::string s(n, '\0');
+    s.resize(static_cast<size_t>(write(s.data()) - s.data()));
     return s;
 }
 
+}
+
+/// Get the maximum number of characters written by \c f_to_chars for type \a T
+/**
+* \param precision the precision (if negative, the default precision is assumed)
+*/
+template <std::floating_point T>
+[[nodiscard]] constexpr size_t
+f_chars_max(const std::chars_format chars_format, const int precision) noexcept
+{
+    using namespace f_to_s_detail;
+
+    // sign + digit + point + fraction + 'e' + sign + exponent
+    const auto scientific_chars = [](const size_t p)
+    {
+        return 1 + 1 + 1 + p + 1 + 1 + exp10_chars<T>;
+    };
+
+    switch (chars_format)
+    {
+    case std::chars_format::scientific:
+        return scientific_chars(get_precision(precision, 6));
+
+    case std::chars_format::fixed:
+        // sign + integer + point + fraction
+        return 1 + int_chars<T> + 1 + get_precision(precision, 6);
+
+    case std::chars_format::hex:
+        // sign + digit + point + fraction + 'p' + sign + exponent
+        return 1 + 1 + 1 + std::max(get_precision(precision, 6), hex_frac_chars<T>) +
+               1 + 1 + exp2_chars<T>;
+
+    default:
+        // Either scientific or fixed with at most 4 zeros after the point
+        return std::max(scientific_chars(get_precision(precision, 6)),
+                        1 + 1 + 1 + 4 + get_precision(precision, 6));
+    }
+}
+
+/// Get the maximum number of characters of the shortest representation written by \c f_to_chars for type \a T
+template <std::floating_point T>
+[[nodiscard]] constexpr size_t
+f_chars_max(const std::chars_format chars_format = std::chars_format::general) noexcept
+{
+    using namespace f_to_s_detail;
+
+    constexpr size_t scientific_max =
+        f_chars_max<T>(std::chars_format::scientific, std::numeric_limits<T>::max_digits10 - 1);
+
+    switch (chars_format)
+    {
+    case std::chars_format::scientific:
+        return scientific_max;
+
+    case std::chars_format::fixed:
+        // sign + integer + point + fraction
+        return 1 + std::max(int_chars<T>, 1 + 1 + frac_chars<T>);
+
+    case std::chars_format::hex:
+        return f_chars_max<T>(std::chars_format::hex, static_cast<int>(hex_frac_chars<T>));
+
+    default:
+        // Either scientific or fixed with at most max_digits10 integer digits
+        return std::max(scientific_max,
+                        f_chars_max<T>(std::chars_format::general,
+                                       std::numeric_limits<T>::max_digits10));
+    }
+}
+
+/// Write \a x with \a chars_format and \a precision
+/**
+* \pre \a buf has room for <code>f_chars_max<decltype(x)>(chars_format, precision)</code> characters.
+* \return one past the last character written
+*/
+char*
+f_to_chars(char* buf,
+           const std::floating_point auto x,
+           const std::chars_format chars_format,
+           const int precision) noexcept
+{
+    using T = decltype_unqual(x);
+    return std::to_chars(buf, buf + f_chars_max<T>(chars_format, precision),
+                         x, chars_format, precision).ptr;
+}
+
+/// Write the shortest representation of \a x with \a chars_format
+/**
+* \pre \a buf has room for <code>f_chars_max<decltype(x)>(chars_format)</code> characters.
+* \return one past the last character written
+*/
+char*
+f_to_chars(char* buf,
+           const std::floating_point auto x,
+           const std::chars_format chars_format = std::chars_format::general) noexcept
+{
+    using T = decltype_unqual(x);
+    return std::to_chars(buf, buf + f_chars_max<T>(chars_format), x, chars_format).ptr;
+}
+
+/// Write each number of \a xs with \a chars_format and \a precision, followed by \a sep
+/**
+* \pre \a buf has room for <code>std::size(xs) * (f_chars_max<T>(chars_format, precision) + 1)</code> characters.
+* \return one past the last character written
+*/
+template <std::floating_point T>
+char*
+f_to_chars(char* buf,
+           const std::span<const T> xs,
+           const std::chars_format chars_format,
+           const int precision,
+           const char sep = '\n') noexcept
+{
+    for (const T x : xs)
+    {
+        buf = f_to_chars(buf, x, chars_format, precision);
+        *buf++ = sep;
+    }
+
+    return buf;
+}
+
+/// Write the shortest representation of each number of \a xs with \a chars_format, followed by \a sep
+/**
+* \pre \a buf has room for <code>std::size(xs) * (f_chars_max<T>(chars_format) + 1)</code> characters.
+* \return one past the last character written
+*/
+template <std::floating_point T>
+char*
+f_to_chars(char* buf,
+           const std::span<const T> xs,
+           const std::chars_format chars_format = std::chars_format::general,
+           const char sep = '\n') noexcept
+{
+    for (const T x : xs)
+    {
+        buf = f_to_chars(buf, x, chars_format);
+        *buf++ = sep;
+    }
+
+    return buf;
+}
+
+std::string
+f_to_s(const std::floating_point auto x,
+       const std::chars_format chars_format,
+       const int precision)
+{
+    using T = decltype_unqual(x);
+    return f_to_s_detail::to_string(f_chars_max<T>(chars_format, precision),
+        [&](char* buf) { return f_to_chars(buf, x, chars_format, precision); });
+}
+
+std::string
+f_to_s(const std::floating_point auto x,
+       const std::chars_format chars_format = std::chars_format::general)
+{
+    using T = decltype_unqual(x);
+    return f_to_s_detail::to_string(f_chars_max<T>(chars_format),
+        [&](char* buf) { return f_to_chars(buf, x, chars_format); });
+}
+
 std::string
 f_to_s_scientific(const std::floating_point auto x, const int precision)
 {
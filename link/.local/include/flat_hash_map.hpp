@@ -0,0 +1,775 @@
+// SPDX-FileCopyrightText: Steven Ward
+// SPDX-License-Identifier: MPL-2.0
+
+/// An open-addressing hash map with SIMD probing (like a Swiss table)
+/**
+* \file
+* \author Steven Ward
+* The elements are stored in one flat array, so there is no allocation per element.
+* Each slot has a control byte: empty, deleted, or the low 7 bits of the hash of its key.
+* A probe compares the control bytes of a group of 16 slots with one SSE2 comparison,
+* and only the slots whose control byte matches are compared with the key.
+* The hash of \c Hash is mixed with \c wyhash64, so an identity hash (e.g. \c std::hash of an integer) is fine.
+*
+* Unlike \c std::unordered_map, iterators and references are invalidated by a rehash,
+* and the key of an element is copied (not moved) when the table grows,
+* so call \c reserve first if the number of elements is known.
+*
+* \sa https://abseil.io/about/design/swisstables
+* \sa https://github.com/abseil/abseil-cpp/blob/master/absl/container/internal/raw_hash_set.h
+* \sa unordered_associative_container.hpp
+*/
+
+#pragma once
+
+#include "wyhash.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+namespace flat_hash_map_detail
+{
+
+using ctrl_t = int8_t;
+
+inline constexpr ctrl_t ctrl_empty = -128; // 0b1000'0000
+inline constexpr ctrl_t ctrl_deleted = -2; // 0b1111'1110
+
+inline constexpr size_t group_width = 16;
+
+/// the control bytes of an empty table (so an empty table does not allocate)
+alignas(group_width) inline constexpr ctrl_t empty_group[group_width * 2] = {
+    ctrl_empty, ctrl_empty, ctrl_empty, ctrl_empty, ctrl_empty, ctrl_empty, ctrl_empty, ctrl_empty,
+    ctrl_empty, ctrl_empty, ctrl_empty, ctrl_empty, ctrl_empty, ctrl_empty, ctrl_empty, ctrl_empty,
+    ctrl_empty, ctrl_empty, ctrl_empty, ctrl_empty, ctrl_empty, ctrl_empty, ctrl_empty, ctrl_empty,
+    ctrl_empty, ctrl_empty, ctrl_empty, ctrl_empty, ctrl_empty, ctrl_empty, ctrl_empty, ctrl_empty,
+};
+
+/// Get a bitmask of the control bytes of the group at \a ctrl that equal \a h2
+[[nodiscard]] inline uint32_t
+match(const ctrl_t* const ctrl, const ctrl_t h2) noexcept
+{
+#if defined(__SSE2__)
+    const __m128i group = _mm_loadu_si128(reinterpret_cast<const __m128i*>(ctrl));
+    return static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(group, _mm_set1_epi8(static_cast<char>(h2)))));
+#else
+    uint32_t result = 0;
+    for (size_t i = 0; i < group_width; ++i)
+        result |= static_cast<uint32_t>(ctrl[i] == h2) << i;
+    return result;
+#endif
+}
+
+/// Get a bitmask of the control bytes of the group at \a ctrl that are empty
+[[nodiscard]] inline uint32_t
+match_empty(const ctrl_t* const ctrl) noexcept
+{
+    return match(ctrl, ctrl_empty);
+}
+
+/// Get a bitmask of the control bytes of the group at \a ctrl that are empty or deleted
+[[nodiscard]] inline uint32_t
+match_empty_or_deleted(const ctrl_t* const ctrl) noexcept
+{
+#if defined(__SSE2__)
+    // Only empty and deleted have the sign bit set.
+    const __m128i group = _mm_loadu_si128(reinterpret_cast<const __m128i*>(ctrl));
+    return static_cast<uint32_t>(_mm_movemask_epi8(group));
+#else
+    uint32_t result = 0;
+    for (size_t i = 0; i < group_width; ++i)
+        result |= static_cast<uint32_t>(ctrl[i] < 0) << i;
+    return result;
+#endif
+}
+
+}
+
+/// An open-addressing hash map with SIMD probing (like a Swiss table)
+template <typename Key,
+          typename T,
+          typename Hash = std::hash<Key>,
+          typename KeyEqual = std::equal_to<Key>>
+class flat_hash_map final
+{
+public:
+
+    using key_type = Key;
+    using mapped_type = T;
+    using value_type = std::pair<const Key, T>;
+    using size_type = size_t;
+    using difference_type = ptrdiff_t;
+    using hasher = Hash;
+    using key_equal = KeyEqual;
+    using reference = value_type&;
+    using const_reference = const value_type&;
+    using pointer = value_type*;
+    using const_pointer = const value_type*;
+
+private:
+
+    using ctrl_t = flat_hash_map_detail::ctrl_t;
+    static constexpr size_t group_width = flat_hash_map_detail::group_width;
+
+    template <bool Const>
+    class iterator_impl
+    {
+    public:
+
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = flat_hash_map::value_type;
+        using difference_type = ptrdiff_t;
+        using pointer = std::conditional_t<Const, const value_type*, value_type*>;
+        using reference = std::conditional_t<Const, const value_type&, value_type&>;
+
+        iterator_impl() = default;
+
+        // Allow converting an iterator to a const_iterator
+        template <bool C = Const>
+        requires C
+        iterator_impl(const iterator_impl<false>& that) noexcept :
+            ctrl_{that.ctrl_}, slot_{that.slot_}, end_{that.end_}
+        {
+        }
+
+        reference operator*() const noexcept { return *slot_; }
+        pointer operator->() const noexcept { return slot_; }
+
+        iterator_impl& operator++() noexcept
+        {
+            ++ctrl_;
+            ++slot_;
+            skip_empty_or_deleted();
+            return *this;
+        }
+
+        iterator_impl operator++(int) noexcept
+        {
+            auto result = *this;
+            ++*this;
+            return result;
+        }
+
+        friend bool operator==(const iterator_impl& a, const iterator_impl& b) noexcept
+        {
+            return a.ctrl_ == b.ctrl_;
+        }
+
+    private:
+
+        friend class flat_hash_map;
+        friend class iterator_impl<!Const>;
+
+        const ctrl_t* ctrl_ = nullptr;
+        value_type* slot_ = nullptr;
+        const ctrl_t* end_ = nullptr;
+
+        iterator_impl(const ctrl_t* const ctrl, value_type* const slot, const ctrl_t* const end) noexcept :
+            ctrl_{ctrl}, slot_{slot}, end_{end}
+        {
+        }
+
+        void skip_empty_or_deleted() noexcept
+        {
+            while (ctrl_ != end_ && *ctrl_ < 0)
+            {
+                ++ctrl_;
+                ++slot_;
+            }
+        }
+    };
+
+public:
+
+    using iterator = iterator_impl<false>;
+    using const_iterator = iterator_impl<true>;
+
+    flat_hash_map() noexcept(std::is_nothrow_default_constructible_v<Hash> &&
+                             std::is_nothrow_default_constructible_v<KeyEqual>) = default;
+
+    /// Reserve space for \a bucket_count elements
+    explicit flat_hash_map(const size_type bucket_count,
+                           const Hash& hash = Hash(),
+                           const KeyEqual& equal = KeyEqual()) :
+        hash_{hash}, equal_{equal}
+    {
+        reserve(bucket_count);
+    }
+
+    template <std::input_iterator InputIt>
+    flat_hash_map(InputIt first, const InputIt last, const size_type bucket_count = 0,
+                  const Hash& hash = Hash(), const KeyEqual& equal = KeyEqual()) :
+        flat_hash_map(bucket_count, hash, equal)
+    {
+        insert(first, last);
+    }
+
+    flat_hash_map(const std::initializer_list<value_type> init, const size_type bucket_count = 0,
+                  const Hash& hash = Hash(), const KeyEqual& equal = KeyEqual()) :
+        flat_hash_map(init.begin(), init.end(), std::max(bucket_count, init.size()), hash, equal)
+    {
+    }
+
+    flat_hash_map(const flat_hash_map& that) :
+        flat_hash_map(that.size(), that.hash_, that.equal_)
+    {
+        for (const auto& value : that)
+            (void)insert_unique(value.first, value);
+    }
+
+    flat_hash_map(flat_hash_map&& that) noexcept :
+        hash_{std::move(that.hash_)},
+        equal_{std::move(that.equal_)},
+        ctrl_{std::exchange(that.ctrl_, empty_ctrl())},
+        slots_{std::exchange(that.slots_, nullptr)},
+        capacity_{std::exchange(that.capacity_, 0)},
+        size_{std::exchange(that.size_, 0)},
+        growth_left_{std::exchange(that.growth_left_, 0)}
+    {
+    }
+
+    flat_hash_map& operator=(const flat_hash_map& that)
+    {
+        if (this != &that)
+        {
+            flat_hash_map tmp(that);
+            swap(tmp);
+        }
+        return *this;
+    }
+
+    flat_hash_map& operator=(flat_hash_map&& that) noexcept
+    {
+        if (this != &that)
+        {
+            destroy();
+            hash_ = std::move(that.hash_);
+            equal_ = std::move(that.equal_);
+            ctrl_ = std::exchange(that.ctrl_, empty_ctrl());
+            slots_ = std::exchange(that.slots_, nullptr);
+            capacity_ = std::exchange(that.capacity_, 0);
+            size_ = std::exchange(that.size_, 0);
+            growth_left_ = std::exchange(that.growth_left_, 0);
+        }
+        return *this;
+    }
+
+    ~flat_hash_map()
+    {
+        destroy();
+    }
+
+    // {{{ iterators
+
+    [[nodiscard]] iterator begin() noexcept
+    {
+        iterator result{ctrl_, slots_, ctrl_ + capacity_};
+        result.skip_empty_or_deleted();
+        return result;
+    }
+
+    [[nodiscard]] const_iterator begin() const noexcept { return const_cast<flat_hash_map*>(this)->begin(); }
+    [[nodiscard]] const_iterator cbegin() const noexcept { return begin(); }
+
+    [[nodiscard]] iterator end() noexcept
+    {
+        return {ctrl_ + capacity_, slots_ + capacity_, ctrl_ + capacity_};
+    }
+
+    [[nodiscard]] const_iterator end() const noexcept { return const_cast<flat_hash_map*>(this)->end(); }
+    [[nodiscard]] const_iterator cend() const noexcept { return end(); }
+
+    // }}}
+
+    // {{{ capacity
+
+    [[nodiscard]] bool empty() const noexcept { return size_ == 0; }
+    [[nodiscard]] size_type size() const noexcept { return size_; }
+
+    [[nodiscard]] size_type max_size() const noexcept
+    {
+        return std::allocator_traits<std::allocator<value_type>>::max_size(std::allocator<value_type>{});
+    }
+
+    // }}}
+
+    // {{{ modifiers
+
+    void clear() noexcept
+    {
+        if (capacity_ == 0)
+            return;
+
+        for (size_t i = 0; i < capacity_; ++i)
+        {
+            if (ctrl_[i] >= 0)
+                std::destroy_at(slots_ + i);
+        }
+
+        std::fill_n(ctrl_, capacity_ + group_width, flat_hash_map_detail::ctrl_empty);
+        size_ = 0;
+        growth_left_ = max_size_for(capacity_);
+    }
+
+    std::pair<iterator, bool> insert(const value_type& value)
+    {
+        return insert_unique(value.first, value);
+    }
+
+    std::pair<iterator, bool> insert(value_type&& value)
+    {
+        return insert_unique(value.first, std::move(value));
+    }
+
+    template <std::input_iterator InputIt>
+    void insert(InputIt first, const InputIt last)
+    {
+        for (; first != last; ++first)
+            (void)insert(*first);
+    }
+
+    void insert(const std::initializer_list<value_type> ilist)
+    {
+        insert(ilist.begin(), ilist.end());
+    }
+
+    template <typename... Args>
+    std::pair<iterator, bool> emplace(Args&&... args)
+    {
+        value_type value(std::forward<Args>(args)...);
+        return insert_unique(value.first, std::move(value));
+    }
+
+    template <typename... Args>
+    std::pair<iterator, bool> try_emplace(const key_type& key, Args&&... args)
+    {
+        return insert_unique(key, std::piecewise_construct, std::forward_as_tuple(key),
+                             std::forward_as_tuple(std::forward<Args>(args)...));
+    }
+
+    template <typename... Args>
+    std::pair<iterator, bool> try_emplace(key_type&& key, Args&&... args)
+    {
+        return insert_unique(key, std::piecewise_construct, std::forward_as_tuple(std::move(key)),
+                             std::forward_as_tuple(std::forward<Args>(args)...));
+    }
+
+    template <typename M>
+    std::pair<iterator, bool> insert_or_assign(const key_type& key, M&& obj)
+    {
+        auto result = try_emplace(key, std::forward<M>(obj));
+        if (!result.second)
+            result.first->second = std::forward<M>(obj);
+        return result;
+    }
+
+    /// Erase the element at \a pos
+    /**
+    * Other iterators are not invalidated.
+    * \return an iterator to the next element
+    */
+    iterator erase(const const_iterator pos)
+    {
+        const auto i = static_cast<size_t>(pos.ctrl_ - ctrl_);
+        erase_at(i);
+        iterator result{ctrl_ + i, slots_ + i, ctrl_ + capacity_};
+        result.skip_empty_or_deleted();
+        return result;
+    }
+
+    iterator erase(const iterator pos)
+    {
+        return erase(const_iterator{pos});
+    }
+
+    iterator erase(const_iterator first, const const_iterator last)
+    {
+        while (first != last)
+            first = erase(first);
+        return {ctrl_ + (last.ctrl_ - ctrl_), slots_ + (last.ctrl_ - ctrl_), ctrl_ + capacity_};
+    }
+
+    size_type erase(const key_type& key)
+    {
+        const size_t i = find_index(key);
+        if (i == capacity_)
+            return 0;
+        erase_at(i);
+        return 1;
+    }
+
+    void swap(flat_hash_map& that) noexcept
+    {
+        using std::swap;
+        swap(hash_, that.hash_);
+        swap(equal_, that.equal_);
+        swap(ctrl_, that.ctrl_);
+        swap(slots_, that.slots_);
+        swap(capacity_, that.capacity_);
+        swap(size_, that.size_);
+        swap(growth_left_, that.growth_left_);
+    }
+
+    friend void swap(flat_hash_map& a, flat_hash_map& b) noexcept { a.swap(b); }
+
+    // }}}
+
+    // {{{ lookup
+
+    [[nodiscard]] T& at(const key_type& key)
+    {
+        const size_t i = find_index(key);
+        if (i == capacity_)
+            throw std::out_of_range("flat_hash_map::at");
+        return slots_[i].second;
+    }
+
+    [[nodiscard]] const T& at(const key_type& key) const
+    {
+        return const_cast<flat_hash_map*>(this)->at(key);
+    }
+
+    T& operator[](const key_type& key)
+    {
+        return try_emplace(key).first->second;
+    }
+
+    T& operator[](key_type&& key)
+    {
+        return try_emplace(std::move(key)).first->second;
+    }
+
+    [[nodiscard]] size_type count(const key_type& key) const
+    {
+        return contains(key) ? 1 : 0;
+    }
+
+    [[nodiscard]] iterator find(const key_type& key)
+    {
+        return iterator_at(find_index(key));
+    }
+
+    [[nodiscard]] const_iterator find(const key_type& key) const
+    {
+        return const_cast<flat_hash_map*>(this)->find(key);
+    }
+
+    [[nodiscard]] bool contains(const key_type& key) const
+    {
+        return find_index(key) != capacity_;
+    }
+
+    [[nodiscard]] std::pair<iterator, iterator> equal_range(const key_type& key)
+    {
+        const auto first = find(key);
+        return {first, first == end() ? first : std::next(first)};
+    }
+
+    [[nodiscard]] std::pair<const_iterator, const_iterator> equal_range(const key_type& key) const
+    {
+        const auto first = find(key);
+        return {first, first == end() ? first : std::next(first)};
+    }
+
+    // }}}
+
+    // {{{ bucket interface
+
+    [[nodiscard]] size_type bucket_count() const noexcept { return capacity_; }
+
+    // }}}
+
+    // {{{ hash policy
+
+    [[nodiscard]] float load_factor() const noexcept
+    {
+        return capacity_ == 0 ? 0.0F : static_cast<float>(size_) / static_cast<float>(capacity_);
+    }
+
+    /// the maximum load factor (which is fixed)
+    [[nodiscard]] float max_load_factor() const noexcept { return 7.0F / 8.0F; }
+
+    /// The maximum load factor is fixed, so this does nothing.
+    void max_load_factor(float) noexcept {}
+
+    /// Rehash so there are at least \a count slots (and enough for the elements)
+    void rehash(const size_type count)
+    {
+        const size_t min_capacity = std::max(count, capacity_for(size_));
+        if (min_capacity == 0)
+        {
+            if (size_ == 0)
+            {
+                destroy();
+                reset_empty();
+            }
+            return;
+        }
+
+        resize(std::bit_ceil(std::max(min_capacity, group_width)));
+    }
+
+    /// Reserve space for at least \a count elements
+    void reserve(const size_type count)
+    {
+        if (count > size_ + growth_left_)
+            rehash(capacity_for(count));
+    }
+
+    // }}}
+
+    // {{{ observers
+
+    [[nodiscard]] hasher hash_function() const { return hash_; }
+    [[nodiscard]] key_equal key_eq() const { return equal_; }
+
+    // }}}
+
+    friend bool operator==(const flat_hash_map& a, const flat_hash_map& b)
+    {
+        if (a.size() != b.size())
+            return false;
+
+        for (const auto& value : a)
+        {
+            const auto iter = b.find(value.first);
+            if (iter == b.end() || !(iter->second == value.second))
+                return false;
+        }
+
+        return true;
+    }
+
+private:
+
+    [[no_unique_address]] Hash hash_{};
+    [[no_unique_address]] KeyEqual equal_{};
+    ctrl_t* ctrl_ = empty_ctrl(); // capacity_ + group_width control bytes (the first group is cloned at the end)
+    value_type* slots_ = nullptr;
+    size_t capacity_ = 0; // 0 or a power of 2 that is at least group_width
+    size_t size_ = 0;
+    size_t growth_left_ = 0; // the number of elements that can be inserted before a rehash
+
+    [[nodiscard]] static ctrl_t* empty_ctrl() noexcept
+    {
+        // It is never written, because capacity_ is 0.
+        return const_cast<ctrl_t*>(flat_hash_map_detail::empty_group);
+    }
+
+    /// the maximum number of elements for \a capacity slots (i.e. 7/8 of the slots)
+    [[nodiscard]] static constexpr size_t max_size_for(const size_t capacity) noexcept
+    {
+        return capacity - capacity / 8;
+    }
+
+    /// the minimum number of slots for \a count elements
+    [[nodiscard]] static constexpr size_t capacity_for(const size_t count) noexcept
+    {
+        return count == 0 ? 0 : count + (count + 6) / 7;
+    }
+
+    [[nodiscard]] uint64_t hash_of(const key_type& key) const
+    {
+        return wyhash64(static_cast<uint64_t>(hash_(key)), _wyp[2]);
+    }
+
+    [[nodiscard]] static ctrl_t h2_of(const uint64_t hash) noexcept
+    {
+        return static_cast<ctrl_t>(hash & 0x7F);
+    }
+
+    [[nodiscard]] iterator iterator_at(const size_t i) noexcept
+    {
+        return {ctrl_ + i, slots_ + i, ctrl_ + capacity_};
+    }
+
+    void set_ctrl(const size_t i, const ctrl_t c) noexcept
+    {
+        ctrl_[i] = c;
+        // Keep the clone of the first group in sync.
+        if (i < group_width)
+            ctrl_[capacity_ + i] = c;
+    }
+
+    /// Get the index of \a key, or \c capacity_ if it is not found
+    [[nodiscard]] size_t find_index(const key_type& key) const
+    {
+        return (capacity_ == 0) ? 0 : find_index(key, hash_of(key));
+    }
+
+    [[nodiscard]] size_t find_index(const key_type& key, const uint64_t hash) const
+    {
+        const ctrl_t h2 = h2_of(hash);
+        const size_t mask = capacity_ - 1;
+
+        // triangular probing visits every group
+        for (size_t pos = (hash >> 7) & mask, step = 0;; step += group_width, pos = (pos + step) & mask)
+        {
+            for (uint32_t m = flat_hash_map_detail::match(ctrl_ + pos, h2); m != 0; m &= m - 1)
+            {
+                const size_t i = (pos + static_cast<size_t>(std::countr_zero(m))) & mask;
+                if (equal_(slots_[i].first, key))
+                    return i;
+            }
+
+            if (flat_hash_map_detail::match_empty(ctrl_ + pos) != 0)
+                return capacity_;
+        }
+    }
+
+    /// Get the index of the first empty or deleted slot for \a hash
+    [[nodiscard]] size_t find_insert_index(const uint64_t hash) const noexcept
+    {
+        const size_t mask = capacity_ - 1;
+
+        for (size_t pos = (hash >> 7) & mask, step = 0;; step += group_width, pos = (pos + step) & mask)
+        {
+            if (const uint32_t m = flat_hash_map_detail::match_empty_or_deleted(ctrl_ + pos); m != 0)
+                return (pos + static_cast<size_t>(std::countr_zero(m))) & mask;
+        }
+    }
+
+    /// Insert the value constructed from \a args if \a key is not found
+    template <typename... Args>
+    std::pair<iterator, bool> insert_unique(const key_type& key, Args&&... args)
+    {
+        const uint64_t hash = hash_of(key);
+
+        if (capacity_ > 0)
+        {
+            if (const size_t i = find_index(key, hash); i != capacity_)
+                return {iterator_at(i), false};
+        }
+
+        const size_t i = find_insert_index_for_growth(hash);
+
+        std::construct_at(slots_ + i, std::forward<Args>(args)...);
+        if (ctrl_[i] == flat_hash_map_detail::ctrl_empty)
+            --growth_left_;
+        set_ctrl(i, h2_of(hash));
+        ++size_;
+
+        return {iterator_at(i), true};
+    }
+
+    /// Get the slot to insert \a hash into, growing the table if needed
+    [[nodiscard]] size_t find_insert_index_for_growth(const uint64_t hash)
+    {
+        if (capacity_ > 0)
+        {
+            const size_t i = find_insert_index(hash);
+            // Reusing a deleted slot does not need growth.
+            if (growth_left_ > 0 || ctrl_[i] == flat_hash_map_detail::ctrl_deleted)
+                return i;
+        }
+
+        // If many slots are deleted, rehash in place (to the same capacity), else double it.
+        if (capacity_ > 0 && size_ * 2 <= max_size_for(capacity_))
+            resize(capacity_);
+        else
+            resize(capacity_ == 0 ? group_width : capacity_ * 2);
+
+        return find_insert_index(hash);
+    }
+
+    void erase_at(const size_t i)
+    {
+        std::destroy_at(slots_ + i);
+        --size_;
+
+        // If the group that starts here has an empty slot, a probe never passed this slot, so it can be empty.
+        const size_t mask = capacity_ - 1;
+        const size_t before = (i - group_width) & mask;
+        const uint32_t empty_after = flat_hash_map_detail::match_empty(ctrl_ + i);
+        const uint32_t empty_before = flat_hash_map_detail::match_empty(ctrl_ + before);
+        const bool was_never_full = empty_before != 0 && empty_after != 0 &&
+            static_cast<size_t>(std::countr_zero(empty_after)) +
+            static_cast<size_t>(std::countl_zero(empty_before << 16)) < group_width;
+
+        if (was_never_full)
+        {
+            set_ctrl(i, flat_hash_map_detail::ctrl_empty);
+            ++growth_left_;
+        }
+        else
+        {
+            set_ctrl(i, flat_hash_map_detail::ctrl_deleted);
+        }
+    }
+
+    /// Move the elements to a table with \a new_capacity slots
+    void resize(const size_t new_capacity)
+    {
+        ctrl_t* const old_ctrl = ctrl_;
+        value_type* const old_slots = slots_;
+        const size_t old_capacity = capacity_;
+
+        auto new_ctrl = std::make_unique_for_overwrite<ctrl_t[]>(new_capacity + group_width);
+        std::allocator<value_type> alloc;
+        value_type* const new_slots = alloc.allocate(new_capacity);
+
+        std::fill_n(new_ctrl.get(), new_capacity + group_width, flat_hash_map_detail::ctrl_empty);
+
+        ctrl_ = new_ctrl.release();
+        slots_ = new_slots;
+        capacity_ = new_capacity;
+        growth_left_ = max_size_for(new_capacity) - size_;
+
+        for (size_t i = 0; i < old_capacity; ++i)
+        {
+            if (old_ctrl[i] < 0)
+                continue;
+
+            const uint64_t hash = hash_of(old_slots[i].first);
+            const size_t j = find_insert_index(hash);
+            // The key is const, so it is copied; the mapped value is moved.
+            std::construct_at(slots_ + j, std::move(old_slots[i]));
+            set_ctrl(j, h2_of(hash));
+            std::destroy_at(old_slots + i);
+        }
+
+        if (old_capacity > 0)
+        {
+            delete[] old_ctrl;
+            alloc.deallocate(old_slots, old_capacity);
+        }
+    }
+
+    void destroy() noexcept
+    {
+        if (capacity_ == 0)
+            return;
+
+        for (size_t i = 0; i < capacity_; ++i)
+        {
+            if (ctrl_[i] >= 0)
+                std::destroy_at(slots_ + i);
+        }
+
+        delete[] ctrl_;
+        std::allocator<value_type>{}.deallocate(slots_, capacity_);
+    }
+
+    void reset_empty() noexcept
+    {
+        ctrl_ = empty_ctrl();
+        slots_ = nullptr;
+        capacity_ = 0;
+        size_ = 0;
+        growth_left_ = 0;
+    }
+};
@@ -0,0 +1,482 @@
+// SPDX-FileCopyrightText: Steven Ward
+// SPDX-License-Identifier: MPL-2.0
+
+/// A sorted map stored in one flat array, with a branchless binary search
+/**
+* \file
+* \author Steven Ward
+* The elements are stored in a \c std::vector sorted by key, so a search does not chase pointers (unlike \c std::map).
+* Insertion and erasure are O(n), so it is best for tables that are built once and searched often.
+*
+* The binary search has no unpredictable branches, and it prefetches both possible next midpoints.
+* If \a Eytzinger is \c true, the keys are also stored in the Eytzinger (breadth-first) order,
+* so the first levels of the search share a few cache lines, and each level prefetches the cache line 4 levels below.
+* That uses more memory and makes every modification rebuild the index.
+*
+* It satisfies \c AssociativeContainer, so the functions in find_key.hpp work with it.
+*
+* \sa https://arxiv.org/abs/1509.05053
+* \sa https://algorithmica.org/en/eytzinger
+* \sa https://probablydance.com/2023/04/27/beautiful-branchless-binary-search/
+* \sa find_key.hpp
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <functional>
+#include <initializer_list>
+#include <iterator>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+/// Get the first element in [\a first, \a last) that is not less than \a value (like \c std::lower_bound) without branches
+template <std::random_access_iterator Iter, typename T, typename Compare = std::less<>>
+[[nodiscard]] constexpr Iter
+branchless_lower_bound(Iter first, const Iter last, const T& value, Compare comp = {})
+{
+    auto len = std::distance(first, last);
+    if (len == 0)
+        return first;
+
+    while (len > 1)
+    {
+        const auto half = len / 2;
+        if !consteval
+        {
+            __builtin_prefetch(std::to_address(first + half / 2));
+            __builtin_prefetch(std::to_address(first + (half + half / 2)));
+        }
+        // This is compiled to a conditional move.
+        first += comp(first[half], value) ? half : 0;
+        len -= half;
+    }
+
+    return first + (comp(*first, value) ? 1 : 0);
+}
+
+/// Get the first element in [\a first, \a last) that is greater than \a value (like \c std::upper_bound) without branches
+template <std::random_access_iterator Iter, typename T, typename Compare = std::less<>>
+[[nodiscard]] constexpr Iter
+branchless_upper_bound(Iter first, const Iter last, const T& value, Compare comp = {})
+{
+    auto len = std::distance(first, last);
+    if (len == 0)
+        return first;
+
+    while (len > 1)
+    {
+        const auto half = len / 2;
+        if !consteval
+        {
+            __builtin_prefetch(std::to_address(first + half / 2));
+            __builtin_prefetch(std::to_address(first + (half + half / 2)));
+        }
+        first += !comp(value, first[half]) ? half : 0;
+        len -= half;
+    }
+
+    return first + (!comp(value, *first) ? 1 : 0);
+}
+
+/// A sorted map stored in one flat array
+/**
+* \tparam Eytzinger if \c true, search an index of the keys in the Eytzinger order
+*
+* Iterators are random access, and they are invalidated by any insertion or erasure.
+* The key of an element must not be modified through an iterator.
+*/
+template <typename Key,
+          typename T,
+          typename Compare = std::less<Key>,
+          bool Eytzinger = false>
+class flat_sorted_map final
+{
+public:
+
+    using key_type = Key;
+    using mapped_type = T;
+    using value_type = std::pair<Key, T>;
+    using container_type = std::vector<value_type>;
+    using size_type = size_t;
+    using difference_type = ptrdiff_t;
+    using key_compare = Compare;
+    using reference = value_type&;
+    using const_reference = const value_type&;
+    using iterator = container_type::iterator;
+    using const_iterator = container_type::const_iterator;
+    using reverse_iterator = container_type::reverse_iterator;
+    using const_reverse_iterator = container_type::const_reverse_iterator;
+
+    /// Compare elements by their keys
+    class value_compare
+    {
+    public:
+
+        [[nodiscard]] bool operator()(const value_type& a, const value_type& b) const
+        {
+            return comp_(a.first, b.first);
+        }
+
+    private:
+
+        friend class flat_sorted_map;
+
+        [[no_unique_address]] Compare comp_;
+
+        explicit value_compare(const Compare& comp) : comp_{comp} {}
+    };
+
+    flat_sorted_map() = default;
+
+    explicit flat_sorted_map(const Compare& comp) : comp_{comp} {}
+
+    /// If a key is repeated, the first element with the key is kept.
+    template <std::input_iterator InputIt>
+    flat_sorted_map(const InputIt first, const InputIt last, const Compare& comp = Compare()) :
+        comp_{comp}
+    {
+        insert(first, last);
+    }
+
+    flat_sorted_map(const std::initializer_list<value_type> init, const Compare& comp = Compare()) :
+        flat_sorted_map(init.begin(), init.end(), comp)
+    {
+    }
+
+    // {{{ iterators
+
+    [[nodiscard]] iterator begin() noexcept { return data_.begin(); }
+    [[nodiscard]] const_iterator begin() const noexcept { return data_.begin(); }
+    [[nodiscard]] const_iterator cbegin() const noexcept { return data_.cbegin(); }
+
+    [[nodiscard]] iterator end() noexcept { return data_.end(); }
+    [[nodiscard]] const_iterator end() const noexcept { return data_.end(); }
+    [[nodiscard]] const_iterator cend() const noexcept { return data_.cend(); }
+
+    [[nodiscard]] reverse_iterator rbegin() noexcept { return data_.rbegin(); }
+    [[nodiscard]] const_reverse_iterator rbegin() const noexcept { return data_.rbegin(); }
+    [[nodiscard]] const_reverse_iterator crbegin() const noexcept { return data_.crbegin(); }
+
+    [[nodiscard]] reverse_iterator rend() noexcept { return data_.rend(); }
+    [[nodiscard]] const_reverse_iterator rend() const noexcept { return data_.rend(); }
+    [[nodiscard]] const_reverse_iterator crend() const noexcept { return data_.crend(); }
+
+    // }}}
+
+    // {{{ capacity
+
+    [[nodiscard]] bool empty() const noexcept { return data_.empty(); }
+    [[nodiscard]] size_type size() const noexcept { return data_.size(); }
+    [[nodiscard]] size_type max_size() const noexcept { return data_.max_size(); }
+
+    void reserve(const size_type count) { data_.reserve(count); }
+
+    // }}}
+
+    // {{{ modifiers
+
+    void clear() noexcept
+    {
+        data_.clear();
+        if constexpr (Eytzinger)
+        {
+            eytz_keys_.clear();
+            eytz_pos_.clear();
+        }
+    }
+
+    std::pair<iterator, bool> insert(const value_type& value)
+    {
+        return try_emplace(value.first, value.second);
+    }
+
+    std::pair<iterator, bool> insert(value_type&& value)
+    {
+        return try_emplace(std::move(value.first), std::move(value.second));
+    }
+
+    /// Insert the elements of [\a first, \a last)
+    /**
+    * The elements are appended, then sorted and merged, so the index is rebuilt once.
+    * If a key is repeated, the first element with the key is kept.
+    */
+    template <std::input_iterator InputIt>
+    void insert(InputIt first, const InputIt last)
+    {
+        const auto old_size = std::ssize(data_);
+        data_.insert(data_.end(), first, last);
+
+        const auto middle = data_.begin() + old_size;
+        const auto vcomp = value_comp();
+        std::stable_sort(middle, data_.end(), vcomp);
+        std::inplace_merge(data_.begin(), middle, data_.end(), vcomp);
+
+        // Keep the first of the equivalent elements (the old elements come first).
+        const auto equivalent = [&](const value_type& a, const value_type& b)
+        {
+            return !comp_(a.first, b.first);
+        };
+        data_.erase(std::unique(data_.begin(), data_.end(), equivalent), data_.end());
+
+        rebuild_index();
+    }
+
+    void insert(const std::initializer_list<value_type> ilist)
+    {
+        insert(ilist.begin(), ilist.end());
+    }
+
+    template <typename... Args>
+    std::pair<iterator, bool> emplace(Args&&... args)
+    {
+        value_type value(std::forward<Args>(args)...);
+        return try_emplace(std::move(value.first), std::move(value.second));
+    }
+
+    template <typename... Args>
+    std::pair<iterator, bool> try_emplace(const key_type& key, Args&&... args)
+    {
+        return emplace_unique(key, key, std::forward<Args>(args)...);
+    }
+
+    template <typename... Args>
+    std::pair<iterator, bool> try_emplace(key_type&& key, Args&&... args)
+    {
+        return emplace_unique(key, std::move(key), std::forward<Args>(args)...);
+    }
+
+    template <typename M>
+    std::pair<iterator, bool> insert_or_assign(const key_type& key, M&& obj)
+    {
+        auto result = try_emplace(key, std::forward<M>(obj));
+        if (!result.second)
+            result.first->second = std::forward<M>(obj);
+        return result;
+    }
+
+    iterator erase(const const_iterator pos)
+    {
+        const auto result = data_.erase(pos);
+        rebuild_index();
+        return result;
+    }
+
+    iterator erase(const iterator pos)
+    {
+        return erase(const_iterator{pos});
+    }
+
+    iterator erase(const const_iterator first, const const_iterator last)
+    {
+        const auto result = data_.erase(first, last);
+        rebuild_index();
+        return result;
+    }
+
+    size_type erase(const key_type& key)
+    {
+        const auto iter = find(key);
+        if (iter == end())
+            return 0;
+        (void)erase(iter);
+        return 1;
+    }
+
+    void swap(flat_sorted_map& that) noexcept
+    {
+        using std::swap;
+        swap(comp_, that.comp_);
+        swap(data_, that.data_);
+        swap(eytz_keys_, that.eytz_keys_);
+        swap(eytz_pos_, that.eytz_pos_);
+    }
+
+    friend void swap(flat_sorted_map& a, flat_sorted_map& b) noexcept { a.swap(b); }
+
+    // }}}
+
+    // {{{ lookup
+
+    [[nodiscard]] T& at(const key_type& key)
+    {
+        const auto iter = find(key);
+        if (iter == end())
+            throw std::out_of_range("flat_sorted_map::at");
+        return iter->second;
+    }
+
+    [[nodiscard]] const T& at(const key_type& key) const
+    {
+        return const_cast<flat_sorted_map*>(this)->at(key);
+    }
+
+    T& operator[](const key_type& key)
+    {
+        return try_emplace(key).first->second;
+    }
+
+    T& operator[](key_type&& key)
+    {
+        return try_emplace(std::move(key)).first->second;
+    }
+
+    [[nodiscard]] size_type count(const key_type& key) const
+    {
+        return contains(key) ? 1 : 0;
+    }
+
+    [[nodiscard]] iterator find(const key_type& key)
+    {
+        const auto iter = lower_bound(key);
+        return (iter != end() && !comp_(key, iter->first)) ? iter : end();
+    }
+
+    [[nodiscard]] const_iterator find(const key_type& key) const
+    {
+        return const_cast<flat_sorted_map*>(this)->find(key);
+    }
+
+    [[nodiscard]] bool contains(const key_type& key) const
+    {
+        return find(key) != end();
+    }
+
+    [[nodiscard]] std::pair<iterator, iterator> equal_range(const key_type& key)
+    {
+        const auto first = lower_bound(key);
+        return {first, (first != end() && !comp_(key, first->first)) ? std::next(first) : first};
+    }
+
+    [[nodiscard]] std::pair<const_iterator, const_iterator> equal_range(const key_type& key) const
+    {
+        return const_cast<flat_sorted_map*>(this)->equal_range(key);
+    }
+
+    /// Get the first element whose key is not less than \a key
+    [[nodiscard]] iterator lower_bound(const key_type& key)
+    {
+        if constexpr (Eytzinger)
+            return eytzinger_search([&](const key_type& k) { return comp_(k, key); });
+        else
+            return data_lower_bound(key);
+    }
+
+    [[nodiscard]] const_iterator lower_bound(const key_type& key) const
+    {
+        return const_cast<flat_sorted_map*>(this)->lower_bound(key);
+    }
+
+    /// Get the first element whose key is greater than \a key
+    [[nodiscard]] iterator upper_bound(const key_type& key)
+    {
+        if constexpr (Eytzinger)
+            return eytzinger_search([&](const key_type& k) { return !comp_(key, k); });
+        else
+            return branchless_upper_bound(data_.begin(), data_.end(), key,
+                [&](const key_type& k, const value_type& v) { return comp_(k, v.first); });
+    }
+
+    [[nodiscard]] const_iterator upper_bound(const key_type& key) const
+    {
+        return const_cast<flat_sorted_map*>(this)->upper_bound(key);
+    }
+
+    // }}}
+
+    // {{{ observers
+
+    [[nodiscard]] key_compare key_comp() const { return comp_; }
+    [[nodiscard]] value_compare value_comp() const { return value_compare(comp_); }
+
+    // }}}
+
+    friend bool operator==(const flat_sorted_map& a, const flat_sorted_map& b)
+    {
+        return a.data_ == b.data_;
+    }
+
+private:
+
+    [[no_unique_address]] Compare comp_{};
+    container_type data_;
+
+    // The Eytzinger index (only used if Eytzinger is true).
+    // Element 0 is not used; the children of element k are 2k and 2k + 1.
+    std::vector<key_type> eytz_keys_;
+    std::vector<size_t> eytz_pos_; // the index in data_ of each key (eytz_pos_[0] is the size)
+
+    [[nodiscard]] iterator data_lower_bound(const key_type& key)
+    {
+        return branchless_lower_bound(data_.begin(), data_.end(), key,
+            [&](const value_type& v, const key_type& k) { return comp_(v.first, k); });
+    }
+
+    /// Insert the element constructed from \a k and \a args if \a key is not found
+    template <typename K, typename... Args>
+    std::pair<iterator, bool> emplace_unique(const key_type& key, K&& k, Args&&... args)
+    {
+        auto iter = data_lower_bound(key);
+        if (iter != data_.end() && !comp_(key, iter->first))
+            return {iter, false};
+
+        iter = data_.emplace(iter, std::piecewise_construct,
+                             std::forward_as_tuple(std::forward<K>(k)),
+                             std::forward_as_tuple(std::forward<Args>(args)...));
+        rebuild_index();
+        return {iter, true};
+    }
+
+    /// Search the Eytzinger index for the first key for which \a go_right is false
+    template <typename Pred>
+    [[nodiscard]] iterator eytzinger_search(Pred go_right)
+    {
+        const size_t n = data_.size();
+        if (n == 0)
+            return data_.end();
+
+        // the number of keys in a cache line (so k * line is 4 levels below k if the keys are 4 bytes)
+        constexpr size_t line = std::max<size_t>(64 / sizeof(key_type), 1);
+
+        size_t k = 1;
+        while (k <= n)
+        {
+            __builtin_prefetch(eytz_keys_.data() + std::min(k * line, n));
+            k = 2 * k + (go_right(eytz_keys_[k]) ? 1 : 0);
+        }
+
+        // Go back up to the last node where the search went left.
+        k >>= std::countr_one(k) + 1;
+
+        return data_.begin() + static_cast<difference_type>(eytz_pos_[k]);
+    }
+
+    /// Put the keys in the Eytzinger order (by an in-order traversal of the implicit tree)
+    size_t build_index(const size_t k, size_t i)
+    {
+        if (k <= data_.size())
+        {
+            i = build_index(2 * k, i);
+            eytz_keys_[k] = data_[i].first;
+            eytz_pos_[k] = i;
+            ++i;
+            i = build_index(2 * k + 1, i);
+        }
+        return i;
+    }
+
+    void rebuild_index()
+    {
+        if constexpr (Eytzinger)
+        {
+            const size_t n = data_.size();
+            eytz_keys_.resize(n + 1);
+            eytz_pos_.resize(n + 1);
+            eytz_pos_[0] = n;
+            (void)build_index(1, 0);
+        }
+    }
+};
@@ -0,0 +1,148 @@
+// SPDX-FileCopyrightText: Steven Ward
+// SPDX-License-Identifier: MPL-2.0
+
+/// Convert a hexadecimal string to bytes
+/**
+* \file
+* \author Steven Ward
+* Uppercase and lowercase hexadecimal digits are accepted.
+* The characters are validated and converted 32 at a time (if SSSE3 is available).
+* \sa http://0x80.pl/notesen/2022-01-17-conversions.html
+* \sa bytes_to_hex.hpp
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <stdexcept>
+#include <string_view>
+#include <vector>
+
+#if defined(__SSSE3__)
+#include <immintrin.h>
+#endif
+
+/// Convert a hexadecimal character to its value
+/**
+* \return the value of \a c, or \c 0xFF if \a c is not a hexadecimal digit
+*/
+[[nodiscard]] static constexpr uint8_t
+hex_char_value(const char c) noexcept
+{
+    if (c >= '0' && c <= '9') return static_cast<uint8_t>(c - '0');
+    if (c >= 'a' && c <= 'f') return static_cast<uint8_t>(c - 'a' + 10);
+    if (c >= 'A' && c <= 'F') return static_cast<uint8_t>(c - 'A' + 10);
+    return 0xFF;
+}
+
+#if defined(__SSSE3__)
+namespace hex_to_bytes_detail
+{
+
+/// Get the values of the hexadecimal characters in \a chars
+/**
+* \param[out] valid all ones if every character is a hexadecimal digit
+*/
+[[nodiscard]] static inline __m128i
+hex_values(const __m128i chars, __m128i& valid) noexcept
+{
+    const __m128i digit = _mm_sub_epi8(chars, _mm_set1_epi8('0'));
+    const __m128i is_digit = _mm_cmpeq_epi8(_mm_min_epu8(digit, _mm_set1_epi8(9)), digit);
+
+    // Fold uppercase to lowercase.
+    const __m128i alpha = _mm_sub_epi8(_mm_or_si128(chars, _mm_set1_epi8(0x20)), _mm_set1_epi8('a'));
+    const __m128i is_alpha = _mm_cmpeq_epi8(_mm_min_epu8(alpha, _mm_set1_epi8(5)), alpha);
+
+    valid = _mm_and_si128(valid, _mm_or_si128(is_digit, is_alpha));
+
+    return _mm_or_si128(_mm_and_si128(is_digit, digit),
+                        _mm_and_si128(is_alpha, _mm_add_epi8(alpha, _mm_set1_epi8(10))));
+}
+
+}
+#endif
+
+/// Convert hexadecimal characters to bytes
+/**
+* \param hex the characters to convert
+* \param buf the output buffer
+* \pre \a buf has room for <code>std::size(hex) / 2</code> bytes.
+* \retval true every character was converted
+* \retval false \a hex has an odd number of characters or a character that is not a hexadecimal digit (the contents of \a buf are unspecified)
+*/
+[[nodiscard]] static bool
+hex_to_bytes(const std::string_view hex, std::byte* buf) noexcept
+{
+    if (std::size(hex) % 2 != 0)
+        return false;
+
+    const char* src = std::data(hex);
+    const char* const src_end = src + std::size(hex);
+    auto* dst = reinterpret_cast<uint8_t*>(buf);
+
+#if defined(__SSSE3__)
+    {
+        using namespace hex_to_bytes_detail;
+
+        // the weights of the high and low nibbles of each pair of characters
+        const __m128i weights = _mm_set1_epi16(0x0110);
+
+        // 32 characters in, 16 bytes out
+        for (; src_end - src >= 32; src += 32, dst += 16)
+        {
+            __m128i valid = _mm_set1_epi8(static_cast<char>(0xFF));
+            const __m128i v0 = hex_values(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src)), valid);
+            const __m128i v1 = hex_values(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 16)), valid);
+
+            if (_mm_movemask_epi8(valid) != 0xFFFF)
+                return false;
+
+            // hi * 16 + lo
+            const __m128i w0 = _mm_maddubs_epi16(v0, weights);
+            const __m128i w1 = _mm_maddubs_epi16(v1, weights);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst), _mm_packus_epi16(w0, w1));
+        }
+    }
+#endif
+
+    for (; src != src_end; src += 2)
+    {
+        const uint8_t hi = hex_char_value(src[0]);
+        const uint8_t lo = hex_char_value(src[1]);
+
+        if ((hi | lo) > 0x0F)
+            return false;
+
+        *dst++ = static_cast<uint8_t>((hi << 4) | lo);
+    }
+
+    return true;
+}
+
+/// Convert hexadecimal characters to bytes
+/**
+* \return \c false if \a byte_sp does not have room for <code>std::size(hex) / 2</code> bytes
+* \sa hex_to_bytes(std::string_view, std::byte*)
+*/
+[[nodiscard]] static bool
+hex_to_bytes(const std::string_view hex, const std::span<std::byte> byte_sp) noexcept
+{
+    return std::size(byte_sp) >= std::size(hex) / 2 && hex_to_bytes(hex, std::data(byte_sp));
+}
+
+/// Convert a hexadecimal string to bytes
+/**
+* \throw std::invalid_argument if \a hex has an odd number of characters or a character that is not a hexadecimal digit
+*/
+[[nodiscard]] static std::vector<std::byte>
+hex_to_bytes(const std::string_view hex)
+{
+    std::vector<std::byte> result(std::size(hex) / 2);
+
+    if (!hex_to_bytes(hex, std::data(result)))
+        throw std::invalid_argument("hex_to_bytes");
+
+    return result;
+}
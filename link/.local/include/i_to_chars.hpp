@@ -0,0 +1,233 @@
+// SPDX-FileCopyrightText: Steven Ward
+// SPDX-License-Identifier: MPL-2.0
+
+/// Write integers as text into a caller buffer
+/**
+* \file
+* \author Steven Ward
+* Decimal uses a table of digit pairs.
+* Hexadecimal uses a nibble lookup with \c PSHUFB (if SSSE3 is available).
+* Binary uses a SWAR multiply to spread 8 bits into 8 characters.
+* \sa https://www.facebook.com/notes/10158791579037200/ (Three Optimization Tips for C++, Andrei Alexandrescu)
+* \sa https://github.com/fmtlib/fmt/blob/master/include/fmt/format.h
+* \sa http://0x80.pl/notesen/2022-01-17-conversions.html
+*/
+
+#pragma once
+
+#include "decltype_unqual.hpp"
+
+#include <bit>
+#include <climits>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <span>
+#include <type_traits>
+
+#if defined(__SSSE3__)
+#include <immintrin.h>
+#endif
+
+/// the pairs of decimal digits from "00" to "99"
+inline constexpr char digit_pairs[] =
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
+
+/// the lowercase hexadecimal digits
+inline constexpr char hex_digits[] = "0123456789abcdef";
+
+/// the maximum number of decimal digits of an integer of type \a T (including the sign)
+template <std::integral T>
+inline constexpr size_t max_dec_chars = std::numeric_limits<T>::digits10 + 1 +
+                                        std::numeric_limits<T>::is_signed;
+
+/// the number of hexadecimal digits of an unsigned integer of type \a T
+template <std::unsigned_integral T>
+inline constexpr size_t hex_chars = std::numeric_limits<T>::digits / 4;
+
+/// the number of octal digits of an unsigned integer of type \a T
+template <std::unsigned_integral T>
+inline constexpr size_t oct_chars = (std::numeric_limits<T>::digits + 2) / 3;
+
+/// the number of binary digits of an unsigned integer of type \a T
+template <std::unsigned_integral T>
+inline constexpr size_t bin_chars = std::numeric_limits<T>::digits;
+
+/// Get the number of decimal digits of \a x
+[[nodiscard]] constexpr unsigned int
+dec_digits(std::unsigned_integral auto x) noexcept
+{
+    unsigned int n = 1;
+
+    while (true)
+    {
+        if (x < 10U) return n;
+        if (x < 100U) return n + 1;
+        if (x < 1000U) return n + 2;
+        if (x < 10000U) return n + 3;
+        x = static_cast<decltype(x)>(x / 10000U);
+        n += 4;
+    }
+}
+
+/// Write \a x in decimal
+/**
+* \pre \a buf has room for \c max_dec_chars<decltype(x)> characters.
+* \return one past the last character written
+*/
+constexpr char*
+dec_to_chars(char* buf, const std::integral auto x) noexcept
+{
+    using T = decltype_unqual(x);
+    using U = std::make_unsigned_t<T>;
+
+    U u = static_cast<U>(x);
+
+    if constexpr (std::is_signed_v<T>)
+    {
+        if (x < 0)
+        {
+            *buf++ = '-';
+            u = static_cast<U>(U{0} - u);
+        }
+    }
+
+    const unsigned int n = dec_digits(u);
+    char* const end = buf + n;
+    char* p = end;
+
+    while (u >= 100U)
+    {
+        const auto i = static_cast<size_t>(u % 100U) * 2;
+        u = static_cast<U>(u / 100U);
+        p -= 2;
+        p[0] = digit_pairs[i];
+        p[1] = digit_pairs[i + 1];
+    }
+
+    if (u >= 10U)
+    {
+        const auto i = static_cast<size_t>(u) * 2;
+        p -= 2;
+        p[0] = digit_pairs[i];
+        p[1] = digit_pairs[i + 1];
+    }
+    else
+    {
+        *--p = static_cast<char>('0' + u);
+    }
+
+    return end;
+}
+
+/// Write all the hexadecimal digits of \a x (i.e. padded with zeros)
+/**
+* \pre \a buf has room for \c hex_chars<decltype(x)> characters.
+* \return one past the last character written
+*/
+inline char*
+hex_to_chars_fixed(char* buf, const std::unsigned_integral auto x) noexcept
+{
+    using T = decltype_unqual(x);
+    constexpr size_t n = hex_chars<T>;
+
+#if defined(__SSSE3__)
+    if constexpr (sizeof(T) > 1)
+    {
+        // Put the most significant byte first.
+        const uint64_t be = std::byteswap(static_cast<uint64_t>(x) << (64 - 4 * n));
+        const __m128i bytes = _mm_cvtsi64_si128(static_cast<long long>(be));
+        const __m128i lo = _mm_and_si128(bytes, _mm_set1_epi8(0x0F));
+        const __m128i hi = _mm_and_si128(_mm_srli_epi16(bytes, 4), _mm_set1_epi8(0x0F));
+        const __m128i nibbles = _mm_unpacklo_epi8(hi, lo);
+        const __m128i table = _mm_loadu_si128(reinterpret_cast<const __m128i*>(hex_digits));
+
+        char tmp[sizeof(__m128i)];
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(tmp), _mm_shuffle_epi8(table, nibbles));
+        (void)std::memcpy(buf, tmp, n);
+        return buf + n;
+    }
+#endif
+
+    for (size_t i = 0; i < n; ++i)
+    {
+        buf[i] = hex_digits[(static_cast<uintmax_t>(x) >> (4 * (n - 1 - i))) & 0x0FU];
+    }
+
+    return buf + n;
+}
+
+/// Write all the octal digits of \a x (i.e. padded with zeros)
+/**
+* \pre \a buf has room for \c oct_chars<decltype(x)> characters.
+* \return one past the last character written
+*/
+constexpr char*
+oct_to_chars_fixed(char* buf, std::unsigned_integral auto x) noexcept
+{
+    constexpr size_t n = oct_chars<decltype_unqual(x)>;
+
+    for (size_t i = n; i > 0; --i)
+    {
+        buf[i - 1] = static_cast<char>('0' + (x & 07U));
+        x = static_cast<decltype(x)>(x >> 3);
+    }
+
+    return buf + n;
+}
+
+/// Write all the binary digits of \a x (i.e. padded with zeros)
+/**
+* \pre \a buf has room for \c bin_chars<decltype(x)> characters.
+* \return one past the last character written
+*/
+inline char*
+bin_to_chars_fixed(char* buf, const std::unsigned_integral auto x) noexcept
+{
+    using T = decltype_unqual(x);
+
+    for (size_t i = 0; i < sizeof(T); ++i)
+    {
+        // most significant byte first
+        const auto b = static_cast<uint8_t>(x >> (CHAR_BIT * (sizeof(T) - 1 - i)));
+        // Copy the byte to every lane, and keep bit (7 - lane) in each lane.
+        const uint64_t bits = (b * UINT64_C(0x0101010101010101)) & UINT64_C(0x0102040810204080);
+        // Each lane becomes 0x00 or 0x01, then '0' or '1'.
+        uint64_t chars = ((bits + UINT64_C(0x7F7F7F7F7F7F7F7F)) >> 7) & UINT64_C(0x0101010101010101);
+        chars += UINT64_C(0x3030303030303030);
+        if constexpr (std::endian::native == std::endian::big)
+            chars = std::byteswap(chars);
+        (void)std::memcpy(buf + CHAR_BIT * i, &chars, sizeof(chars));
+    }
+
+    return buf + bin_chars<T>;
+}
+
+/// Write each integer of \a xs in decimal, followed by \a sep
+/**
+* \pre \a buf has room for <code>std::size(xs) * (max_dec_chars<T> + 1)</code> characters.
+* \return one past the last character written
+*/
+template <std::integral T>
+char*
+dec_to_chars(char* buf, const std::span<const T> xs, const char sep = '\n') noexcept
+{
+    for (const T x : xs)
+    {
+        buf = dec_to_chars(buf, x);
+        *buf++ = sep;
+    }
+
+    return buf;
+}
@@ -10,6 +10,8 @@
 
 #pragma once
 
+#include "i_to_chars.hpp"
+
 #include <charconv>
 #include <climits>
 #include <concepts>
@@ -32,6 +34,10 @@ i_to_s(const std::integral auto x, const int base = 10)
         CHAR_BIT * sizeof(x) + std::numeric_limits<decltype(x)>::is_signed;
 
     char buf[buf_size] = {'\0'};
+
+    if (base == 10)
+        return std::string(buf, dec_to_chars(buf, x));
+
     const std::to_chars_result r = std::to_chars(buf, buf + buf_size, x, base);
     return std::string(buf, r.ptr);
 }
@@ -0,0 +1,105 @@
+// SPDX-FileCopyrightText: Steven Ward
+// SPDX-License-Identifier: MPL-2.0
+
+/// Gather pieces of memory and write them to a file descriptor with \c writev
+/**
+* \file
+* \author Steven Ward
+* \sa https://man7.org/linux/man-pages/man2/writev.2.html
+*/
+
+#pragma once
+
+#include <array>
+#include <cerrno>
+#include <cstddef>
+#include <string_view>
+#include <sys/uio.h>
+#include <system_error>
+
+/// Gather pieces of memory and write them to a file descriptor with \c writev
+/**
+* The pieces are not copied, so they must outlive the call to \c flush.
+* Up to \c max_pieces pieces are written with one system call.
+*
+* The file descriptor is not owned (i.e. it is not closed).
+*/
+class iov_writer final
+{
+public:
+
+    // IOV_MAX on Linux
+    static constexpr size_t max_pieces = 1024;
+
+    explicit iov_writer(const int fd) noexcept : fd_{fd}
+    {
+    }
+
+    // Disallow copying
+    iov_writer(const iov_writer&) = delete;
+    iov_writer& operator=(const iov_writer&) = delete;
+
+    ~iov_writer() = default;
+
+    /// Add \a piece to be written
+    /**
+    * \throw std::system_error if \c writev(2) fails
+    */
+    void add(const std::string_view piece)
+    {
+        if (piece.empty())
+            return;
+
+        if (size_ == max_pieces)
+            flush();
+
+        iov_[size_++] = {const_cast<char*>(std::data(piece)), std::size(piece)};
+    }
+
+    /// Write the pieces that were added
+    /**
+    * \throw std::system_error if \c writev(2) fails
+    */
+    void flush()
+    {
+        iovec* iov = iov_.data();
+        size_t iov_count = size_;
+
+        while (iov_count > 0)
+        {
+            const ssize_t bytes_written = ::writev(fd_, iov, static_cast<int>(iov_count));
+
+            if (bytes_written < 0)
+            {
+                if (errno == EINTR)
+                    continue;
+
+                size_ = 0;
+                throw std::system_error(std::make_error_code(std::errc{errno}), "writev");
+            }
+
+            // Skip the pieces that were written, and adjust a piece that was partially written.
+            auto n = static_cast<size_t>(bytes_written);
+            while (iov_count > 0 && n >= iov->iov_len)
+            {
+                n -= iov->iov_len;
+                ++iov;
+                --iov_count;
+            }
+
+            if (iov_count > 0)
+            {
+                iov->iov_base = static_cast<char*>(iov->iov_base) + n;
+                iov->iov_len -= n;
+            }
+        }
+
+        size_ = 0;
+    }
+
+private:
+
+    int fd_;
+    size_t size_{0};
+    std::array<iovec, max_pieces> iov_;
+};
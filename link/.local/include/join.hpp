@@ -6,94 +6,219 @@
 * \file
 * \author Steven Ward
 *
-* Note: Only \c std::string is supported.
+* Note: Only \c std::string, \c std::pmr::string, \c std::string_view, and <code>const char*</code> elements are supported.
+*
+* Empty (and null) strings are skipped.
+*
+* If the iterators are forward iterators, the length of the result is computed first, so the result is allocated once.
+* The overloads with a \c std::pmr::memory_resource (e.g. an \c arena) allocate the result from it.
+* The \c join_to functions write into an output iterator, a fixed buffer, or a file descriptor, so the result is never allocated.
 */
 
 #pragma once
 
+#include "iov_writer.hpp"
 #include "type_any_of.hpp"
 
+#include <algorithm>
 #include <concepts>
+#include <cstddef>
+#include <cstring>
 #include <iterator>
+#include <memory_resource>
+#include <span>
 #include <string>
 #include <string_view>
+#include <type_traits>
 
-template <std::input_iterator Iter>
-requires type_any_of<std::remove_cv_t<typename std::iterator_traits<Iter>::value_type>,
-                     std::string,
-                     std::string_view>
-auto
-join(const Iter& first, const Iter& last, const std::string& joiner = ", ")
+namespace join_detail
 {
-    std::string result;
+
+template <typename Iter>
+concept string_iterator =
+    std::input_iterator<Iter> &&
+    type_any_of<std::remove_cv_t<typename std::iterator_traits<Iter>::value_type>,
+                std::string,
+                std::pmr::string,
+                std::string_view,
+                const char*>;
+
+[[nodiscard]] inline std::string_view
+to_string_view(const std::string_view s) noexcept
+{
+    return s;
+}
+
+[[nodiscard]] inline std::string_view
+to_string_view(const char* const s) noexcept
+{
+    return s != nullptr ? std::string_view{s} : std::string_view{};
+}
+
+/// Call \a f for each non-empty string in [\a first, \a last) and each \a joiner between them
+/**
+* \a f is never called with an empty piece (e.g. the default joiner, whose \c data is null, which \c memcpy must not be given).
+*/
+template <string_iterator Iter>
+void
+for_each_piece(const Iter& first, const Iter& last, const std::string_view joiner, auto&& f)
+{
+    bool empty = true;
 
     for (Iter i = first; i != last; i = std::next(i))
     {
-        if (i->empty())
+        const std::string_view s = to_string_view(*i);
+
+        if (s.empty())
             continue;
 
-        if (!result.empty())
-            result += joiner;
+        if (!empty && !joiner.empty())
+            f(joiner);
 
-        result += *i;
+        f(s);
+        empty = false;
     }
-
-    return result;
 }
 
-template <std::input_iterator Iter>
-requires std::same_as<typename std::iterator_traits<Iter>::value_type, const char*>
-auto
-join(const Iter& first, const Iter& last, const std::string& joiner = ", ")
+/// Get the length of the joined strings
+template <string_iterator Iter>
+[[nodiscard]] size_t
+joined_size(const Iter& first, const Iter& last, const std::string_view joiner)
 {
-    std::string result;
+    size_t size = 0;
+    for_each_piece(first, last, joiner, [&](const std::string_view piece) { size += std::size(piece); });
+    return size;
+}
 
-    for (Iter i = first; i != last; i = std::next(i))
+/// Join the strings into \a result
+template <typename String, string_iterator Iter>
+void
+join(String& result, const Iter& first, const Iter& last, const std::string_view joiner)
+{
+    if constexpr (std::forward_iterator<Iter>)
     {
-        if (*i == nullptr || (*i)[0] == '\0')
-            continue;
+        result.resize_and_overwrite(joined_size(first, last, joiner),
+            [&](char* p, const size_t n)
+            {
+                for_each_piece(first, last, joiner, [&](const std::string_view piece)
+                {
+                    (void)std::memcpy(p, std::data(piece), std::size(piece));
+                    p += std::size(piece);
+                });
+                return n;
+            });
+    }
+    else
+    {
+        for_each_piece(first, last, joiner, [&](const std::string_view piece) { result += piece; });
+    }
+}
 
-        if (!result.empty())
-            result += joiner;
+}
 
-        result += *i;
-    }
+template <join_detail::string_iterator Iter>
+auto
+join(const Iter& first, const Iter& last, const std::string_view joiner = ", ")
+{
+    std::string result;
+    join_detail::join(result, first, last, joiner);
+    return result;
+}
 
+/// Join the strings into a string allocated from \a mr (e.g. an \c arena)
+template <join_detail::string_iterator Iter>
+std::pmr::string
+join(const Iter& first, const Iter& last, const std::string_view joiner, std::pmr::memory_resource* const mr)
+{
+    std::pmr::string result(mr);
+    join_detail::join(result, first, last, joiner);
     return result;
 }
 
 // template template parameter
 template <template <typename> typename Container, typename StringT>
-requires type_any_of<StringT, std::string, std::string_view, const char*>
+requires type_any_of<StringT, std::string, std::pmr::string, std::string_view, const char*>
 auto
-join(const Container<StringT>& c, const std::string& joiner = ", ")
+join(const Container<StringT>& c, const std::string_view joiner = ", ")
 {
     return join(c.cbegin(), c.cend(), joiner);
 }
 
-template <std::input_iterator Iter>
-requires type_any_of<std::remove_cv_t<typename std::iterator_traits<Iter>::value_type>,
-                     std::string,
-                     std::string_view>
-auto
-concatenate(const Iter& first, const Iter& last)
+/// Join the strings into the output iterator \a out
+/**
+* \return the output iterator one past the last character written
+*/
+template <std::output_iterator<char> Out, join_detail::string_iterator Iter>
+Out
+join_to(Out out, const Iter& first, const Iter& last, const std::string_view joiner = ", ")
+{
+    join_detail::for_each_piece(first, last, joiner, [&](const std::string_view piece)
+    {
+        out = std::ranges::copy(piece, out).out;
+    });
+
+    return out;
+}
+
+/// Join the strings into the buffer \a buf
+/**
+* Like \c snprintf, the result is truncated if \a buf is too small (but it is not null-terminated).
+* \return the length of the joined strings (which is greater than <code>std::size(buf)</code> if the result was truncated)
+*/
+template <join_detail::string_iterator Iter>
+size_t
+join_to(const std::span<char> buf, const Iter& first, const Iter& last, const std::string_view joiner = ", ")
+{
+    size_t size = 0;
+
+    join_detail::for_each_piece(first, last, joiner, [&](const std::string_view piece)
+    {
+        if (size < std::size(buf))
+            (void)std::memcpy(std::data(buf) + size, std::data(piece),
+                              std::min(std::size(piece), std::size(buf) - size));
+        size += std::size(piece);
+    });
+
+    return size;
+}
+
+/// Join the strings and write them to the file descriptor \a fd with \c writev
+/**
+* The strings are not copied, so the elements must not be temporaries.
+* \throw std::system_error if \c writev(2) fails
+*/
+template <join_detail::string_iterator Iter>
+requires std::forward_iterator<Iter> &&
+         (std::is_lvalue_reference_v<std::iter_reference_t<Iter>> ||
+          type_any_of<std::iter_value_t<Iter>, std::string_view, const char*>)
+void
+join_to(const int fd, const Iter& first, const Iter& last, const std::string_view joiner = ", ")
 {
-    return join(first, last, std::string{});
+    iov_writer writer{fd};
+    join_detail::for_each_piece(first, last, joiner, [&](const std::string_view piece) { writer.add(piece); });
+    writer.flush();
 }
 
-template <std::input_iterator Iter>
-requires std::same_as<typename std::iterator_traits<Iter>::value_type, const char*>
+template <join_detail::string_iterator Iter>
 auto
 concatenate(const Iter& first, const Iter& last)
 {
-    return join(first, last, std::string{});
+    return join(first, last, std::string_view{});
+}
+
+/// Concatenate the strings into a string allocated from \a mr (e.g. an \c arena)
+template <join_detail::string_iterator Iter>
+std::pmr::string
+concatenate(const Iter& first, const Iter& last, std::pmr::memory_resource* const mr)
+{
+    return join(first, last, std::string_view{}, mr);
 }
 
 // template template parameter
 template <template <typename> typename Container, typename StringT>
-requires type_any_of<StringT, std::string, std::string_view, const char*>
+requires type_any_of<StringT, std::string, std::pmr::string, std::string_view, const char*>
 auto
 concatenate(const Container<StringT>& c)
 {
-    return join(c.cbegin(), c.cend(), std::string{});
+    return join(c.cbegin(), c.cend(), std::string_view{});
 }
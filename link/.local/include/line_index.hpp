@@ -0,0 +1,387 @@
+// SPDX-FileCopyrightText: Steven Ward
+// SPDX-License-Identifier: MPL-2.0
+
+/// Random access to the lines of a memory-mapped text file
+/**
+* \file
+* \author Steven Ward
+* The byte offset of every Nth line is stored in a sampled offset table.
+* To get line \c n, start at the nearest sampled line before it and scan forward with \c memchr.
+* The table can be saved next to the file (with the suffix ".lidx") so later runs do not rescan the file.
+* \sa https://man7.org/linux/man-pages/man2/mmap.2.html
+*/
+
+#pragma once
+
+#include "fd-utils.h"
+#include "unique_fd.hpp"
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <filesystem>
+#include <optional>
+#include <string_view>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <system_error>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+/// Random access to the lines of a memory-mapped text file
+/**
+* Lines are numbered from \c 0.
+* A line includes its terminating newline, except possibly the last line.
+*/
+class line_index final
+{
+public:
+
+    static constexpr size_t default_sample_interval = 1024;
+
+    /// Map the file at \a path and build the offset table
+    /**
+    * \param sample_interval the offset of every \a sample_interval line is stored
+    * \throw std::system_error if the file could not be opened or mapped
+    */
+    explicit line_index(const std::filesystem::path& path,
+                        const size_t sample_interval = default_sample_interval) :
+        line_index(path, sample_interval, nullptr)
+    {
+    }
+
+    /// Map the file at \a path and load the offset table saved next to it
+    /**
+    * If the saved offset table is missing or stale, it is rebuilt and saved.
+    * \throw std::system_error if the file could not be opened or mapped
+    */
+    [[nodiscard]] static line_index
+    open(const std::filesystem::path& path,
+         const size_t sample_interval = default_sample_interval)
+    {
+        bool loaded = false;
+        line_index result(path, sample_interval, &loaded);
+
+        if (!loaded)
+        {
+            // Saving is optional (e.g. the directory might not be writable).
+            (void)result.save();
+        }
+
+        return result;
+    }
+
+    // Disallow copying
+    line_index(const line_index&) = delete;
+    line_index& operator=(const line_index&) = delete;
+
+    // Allow moving
+    line_index(line_index&& that) noexcept :
+        path_{std::move(that.path_)},
+        data_{std::exchange(that.data_, nullptr)},
+        size_{std::exchange(that.size_, 0)},
+        mmap_size_{std::exchange(that.mmap_size_, 0)},
+        mtime_{that.mtime_},
+        sample_interval_{that.sample_interval_},
+        num_lines_{that.num_lines_},
+        samples_{std::move(that.samples_)}
+    {
+    }
+
+    line_index& operator=(line_index&&) = delete;
+
+    ~line_index() noexcept
+    {
+        if (data_ != nullptr)
+            (void)::munmap(const_cast<char*>(data_), mmap_size_);
+    }
+
+    /// the number of lines in the file
+    [[nodiscard]] size_t num_lines() const noexcept { return num_lines_; }
+
+    /// the contents of the file
+    [[nodiscard]] std::string_view data() const noexcept { return {data_, size_}; }
+
+    /// Get the byte offset of the start of line \a n
+    /**
+    * If \a n is at least \c num_lines(), the size of the file is returned.
+    */
+    [[nodiscard]] size_t line_offset(const size_t n) const noexcept
+    {
+        if (n >= num_lines_)
+            return size_;
+
+        size_t offset = samples_[n / sample_interval_];
+
+        for (size_t i = n % sample_interval_; i > 0; --i)
+        {
+            const auto* const nl = static_cast<const char*>(
+                std::memchr(data_ + offset, '\n', size_ - offset));
+            // The file has fewer lines than the offset table says.
+            if (nl == nullptr)
+                return size_;
+            offset = static_cast<size_t>(nl - data_) + 1;
+        }
+
+        return offset;
+    }
+
+    /// Get line \a n
+    [[nodiscard]] std::string_view line(const size_t n) const noexcept
+    {
+        return lines(n, n + 1);
+    }
+
+    /// Get the lines in the interval [\a first, \a last)
+    /**
+    * The byte ranges of disjoint line ranges can be processed in parallel.
+    */
+    [[nodiscard]] std::string_view lines(const size_t first, const size_t last) const noexcept
+    {
+        if (first >= last)
+            return {};
+
+        const size_t begin = line_offset(first);
+        return {data_ + begin, line_offset(last) - begin};
+    }
+
+    /// Save the offset table next to the file
+    /**
+    * \return \c true on success
+    */
+    bool save() const
+    {
+        const auto index_path = get_index_path(path_);
+
+        std::FILE* fp = std::fopen(index_path.c_str(), "wb");
+        if (fp == nullptr)
+            return false;
+
+        const header hdr = make_header();
+
+        bool ok = std::fwrite(&hdr, sizeof(hdr), 1, fp) == 1;
+        ok = ok && std::fwrite(std::data(samples_), sizeof(uint64_t), std::size(samples_), fp) ==
+                       std::size(samples_);
+        ok = (std::fclose(fp) == 0) && ok;
+
+        if (!ok)
+            (void)std::remove(index_path.c_str());
+
+        return ok;
+    }
+
+    /// Get the path of the saved offset table of \a path
+    [[nodiscard]] static std::filesystem::path
+    get_index_path(const std::filesystem::path& path)
+    {
+        auto index_path = path;
+        index_path += ".lidx";
+        return index_path;
+    }
+
+private:
+
+    struct header
+    {
+        char magic[8];
+        uint64_t file_size;
+        int64_t mtime_sec;
+        int64_t mtime_nsec;
+        uint64_t sample_interval;
+        uint64_t num_lines;
+        uint64_t num_samples;
+    };
+
+    static constexpr char magic[8] = {'L', 'I', 'D', 'X', '0', '0', '0', '1'};
+
+    std::filesystem::path path_;
+    const char* data_ = nullptr;
+    size_t size_ = 0;
+    size_t mmap_size_ = 0;
+    timespec mtime_{};
+    size_t sample_interval_ = default_sample_interval;
+    size_t num_lines_ = 0;
+    std::vector<uint64_t> samples_; // the offset of every sample_interval_ line
+
+    /// If \a loaded is not null, try to load the saved offset table first
+    line_index(const std::filesystem::path& path, const size_t sample_interval, bool* loaded) :
+        path_{path},
+        sample_interval_{sample_interval > 0 ? sample_interval : default_sample_interval}
+    {
+        const unique_fd fd{::open(path.c_str(), O_RDONLY | O_CLOEXEC)};
+        if (!fd.ok())
+            throw std::system_error(std::make_error_code(std::errc{errno}), path);
+
+        struct stat statbuf{};
+        if (::fstat(fd.get(), &statbuf) < 0)
+            throw std::system_error(std::make_error_code(std::errc{errno}), path);
+
+        size_ = static_cast<size_t>(statbuf.st_size);
+        mtime_ = statbuf.st_mtim;
+        mmap_size_ = get_mmap_size(size_);
+
+        void* addr = ::mmap(nullptr, mmap_size_, PROT_READ, MAP_PRIVATE, fd.get(), 0);
+        if (addr == MAP_FAILED)
+            throw std::system_error(std::make_error_code(std::errc{errno}), path);
+
+        data_ = static_cast<const char*>(addr);
+
+        if (loaded != nullptr)
+        {
+            *loaded = load();
+            if (*loaded)
+                return;
+        }
+
+        (void)madvise_sequential_willneed(addr, mmap_size_);
+
+        build();
+    }
+
+    [[nodiscard]] header make_header() const noexcept
+    {
+        header hdr{};
+        (void)std::memcpy(hdr.magic, magic, sizeof(magic));
+        hdr.file_size = size_;
+        hdr.mtime_sec = mtime_.tv_sec;
+        hdr.mtime_nsec = mtime_.tv_nsec;
+        hdr.sample_interval = sample_interval_;
+        hdr.num_lines = num_lines_;
+        hdr.num_samples = std::size(samples_);
+        return hdr;
+    }
+
+    /// Load the saved offset table if it matches the file
+    bool load()
+    {
+        const auto index_path = get_index_path(path_);
+
+        std::FILE* fp = std::fopen(index_path.c_str(), "rb");
+        if (fp == nullptr)
+            return false;
+
+        header hdr{};
+
+        bool ok = std::fread(&hdr, sizeof(hdr), 1, fp) == 1 &&
+                  std::memcmp(hdr.magic, magic, sizeof(magic)) == 0 &&
+                  hdr.file_size == size_ &&
+                  hdr.mtime_sec == mtime_.tv_sec &&
+                  hdr.mtime_nsec == mtime_.tv_nsec &&
+                  hdr.sample_interval > 0 &&
+                  hdr.num_samples == (hdr.num_lines + hdr.sample_interval - 1) / hdr.sample_interval;
+
+        if (ok)
+        {
+            samples_.resize(hdr.num_samples);
+            ok = std::fread(std::data(samples_), sizeof(uint64_t), std::size(samples_), fp) ==
+                 std::size(samples_);
+        }
+
+        (void)std::fclose(fp);
+
+        ok = ok && valid_samples(hdr);
+
+        if (ok)
+        {
+            sample_interval_ = hdr.sample_interval;
+            num_lines_ = hdr.num_lines;
+        }
+        else
+        {
+            samples_.clear();
+        }
+
+        return ok;
+    }
+
+    /// Check that the loaded offsets are the starts of lines within the file
+    [[nodiscard]] bool valid_samples(const header& hdr) const noexcept
+    {
+        if (hdr.num_lines > size_ || (hdr.num_lines == 0) != (size_ == 0))
+            return false;
+
+        uint64_t prev = 0;
+
+        for (size_t i = 0; i < std::size(samples_); ++i)
+        {
+            const uint64_t offset = samples_[i];
+
+            if (i == 0)
+            {
+                if (offset != 0)
+                    return false;
+            }
+            else if (offset <= prev || offset >= size_ || data_[offset - 1] != '\n')
+            {
+                return false;
+            }
+
+            prev = offset;
+        }
+
+        return true;
+    }
+
+    /// Scan the file for newlines and build the offset table
+    void build()
+    {
+        samples_.clear();
+        num_lines_ = 0;
+
+        if (size_ == 0)
+            return;
+
+        // Line 0 starts at offset 0.
+        samples_.push_back(0);
+        num_lines_ = 1;
+
+        // Called for every newline at offset i
+        const auto add_newline = [&](const size_t i)
+        {
+            // A newline at the end of the file does not start another line.
+            if (i + 1 == size_)
+                return;
+
+            if (num_lines_ % sample_interval_ == 0)
+                samples_.push_back(i + 1);
+
+            ++num_lines_;
+        };
+
+        size_t i = 0;
+
+#if defined(__AVX2__)
+        const __m256i nl32 = _mm256_set1_epi8('\n');
+        for (; i + sizeof(__m256i) <= size_; i += sizeof(__m256i))
+        {
+            const __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data_ + i));
+            auto mask = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, nl32)));
+            for (; mask != 0; mask &= mask - 1)
+                add_newline(i + static_cast<size_t>(__builtin_ctz(mask)));
+        }
+#elif defined(__SSE2__)
+        const __m128i nl16 = _mm_set1_epi8('\n');
+        for (; i + sizeof(__m128i) <= size_; i += sizeof(__m128i))
+        {
+            const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data_ + i));
+            auto mask = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, nl16)));
+            for (; mask != 0; mask &= mask - 1)
+                add_newline(i + static_cast<size_t>(__builtin_ctz(mask)));
+        }
+#endif
+
+        for (; i < size_; ++i)
+        {
+            if (data_[i] == '\n')
+                add_newline(i);
+        }
+    }
+};
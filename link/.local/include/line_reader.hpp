@@ -0,0 +1,160 @@
+// SPDX-FileCopyrightText: Steven Ward
+// SPDX-License-Identifier: MPL-2.0
+
+/// Read delimited lines from a file descriptor into a reusable buffer
+/**
+* \file
+* \author Steven Ward
+* This is a faster alternative to \c getline and \c getdelim.
+* Lines are returned as a \c std::string_view into the internal buffer, so there is no copy per line.
+* \sa https://www.man7.org/linux/man-pages/man2/read.2.html
+* \sa https://www.man7.org/linux/man-pages/man3/memchr.3.html
+*/
+
+#pragma once
+
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <string_view>
+#include <system_error>
+#include <unistd.h>
+
+/// Read delimited lines from a file descriptor into a reusable buffer
+/**
+* Large blocks are read with \c read(2), and delimiters are found with \c memchr (which is vectorized in glibc).
+* A line that straddles two blocks is moved to the front of the buffer before the next block is read.
+* If a line is longer than the buffer, the buffer is doubled.
+*
+* The \c std::string_view returned by \c next is invalidated by the next call to \c next.
+*
+* The file descriptor is not owned (i.e. it is not closed).
+*/
+class line_reader final
+{
+public:
+
+    static constexpr size_t default_buf_size = 64 * 1024;
+
+    explicit line_reader(const int fd,
+                         const char delim = '\n',
+                         const size_t buf_size = default_buf_size) :
+        fd_{fd},
+        delim_{delim},
+        buf_size_{buf_size > 0 ? buf_size : default_buf_size},
+        buf_{std::make_unique_for_overwrite<char[]>(buf_size_)}
+    {
+    }
+
+    // Disallow copying
+    line_reader(const line_reader&) = delete;
+    line_reader& operator=(const line_reader&) = delete;
+
+    // Allow moving
+    line_reader(line_reader&&) noexcept = default;
+    line_reader& operator=(line_reader&&) noexcept = default;
+
+    ~line_reader() = default;
+
+    /// Get the next line
+    /**
+    * \param[out] line the next line (without the delimiter, if \a strip_delim)
+    * \param strip_delim if the delimiter should be stripped from \a line
+    * \retval true a line was read
+    * \retval false the end of the file was reached (\a line is empty)
+    * \throw std::system_error if \c read(2) fails
+    * The last line does not need to end with the delimiter.
+    */
+    bool next(std::string_view& line, const bool strip_delim = true)
+    {
+        while (true)
+        {
+            const char* const begin = buf_.get() + pos_;
+            const size_t avail = end_ - pos_;
+
+            if (const auto* const found = static_cast<const char*>(
+                    std::memchr(begin, delim_, avail));
+                found != nullptr)
+            {
+                const auto len = static_cast<size_t>(found - begin);
+                line = std::string_view(begin, len + (strip_delim ? 0 : 1));
+                pos_ += len + 1;
+                return true;
+            }
+
+            if (eof_)
+            {
+                if (avail == 0)
+                {
+                    line = {};
+                    return false;
+                }
+
+                // The last line has no delimiter.
+                line = std::string_view(begin, avail);
+                pos_ = end_;
+                return true;
+            }
+
+            fill();
+        }
+    }
+
+    /// the number of bytes read but not yet returned
+    /**
+    * If this is \c 0, the next call to \c next will call \c read(2) (which might block).
+    */
+    [[nodiscard]] size_t available() const noexcept { return end_ - pos_; }
+
+private:
+
+    int fd_;
+    char delim_;
+    size_t buf_size_;
+    std::unique_ptr<char[]> buf_;
+    size_t pos_{0}; // the beginning of the unread data
+    size_t end_{0}; // the end of the unread data
+    bool eof_{false};
+
+    /// Read the next block, keeping the unread (partial) line
+    void fill()
+    {
+        const size_t avail = end_ - pos_;
+
+        if (pos_ > 0)
+        {
+            // Move the partial line to the front.
+            if (avail > 0)
+                (void)std::memmove(buf_.get(), buf_.get() + pos_, avail);
+            pos_ = 0;
+            end_ = avail;
+        }
+
+        if (end_ == buf_size_)
+        {
+            // The partial line fills the buffer.
+            const size_t new_buf_size = buf_size_ * 2;
+            auto new_buf = std::make_unique_for_overwrite<char[]>(new_buf_size);
+            (void)std::memcpy(new_buf.get(), buf_.get(), end_);
+            buf_ = std::move(new_buf);
+            buf_size_ = new_buf_size;
+        }
+
+        ssize_t bytes_read = 0;
+
+        do
+        {
+            bytes_read = ::read(fd_, buf_.get() + end_, buf_size_ - end_);
+        }
+        while (bytes_read < 0 && errno == EINTR);
+
+        if (bytes_read < 0)
+            throw std::system_error(std::make_error_code(std::errc{errno}), "read");
+
+        if (bytes_read == 0)
+            eof_ = true;
+
+        end_ += static_cast<size_t>(bytes_read);
+    }
+};
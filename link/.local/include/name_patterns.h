@@ -0,0 +1,80 @@
+// SPDX-FileCopyrightText: Steven Ward
+// SPDX-License-Identifier: MPL-2.0
+
+/// Select names (e.g. of network interfaces or disks) with include and exclude patterns
+/**
+* \file
+* \author Steven Ward
+* A name is selected if it matches no exclude pattern,
+* and it matches an include pattern (or there is no include pattern).
+* \sa https://man7.org/linux/man-pages/man3/fnmatch.3.html
+*/
+
+#pragma once
+
+#include <err.h>
+#include <fnmatch.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+#define NAME_PATTERNS_MAX 32
+
+/// The shell wildcard patterns (the strings are not copied)
+struct name_patterns
+{
+    const char* include[NAME_PATTERNS_MAX];
+    size_t num_include;
+    const char* exclude[NAME_PATTERNS_MAX];
+    size_t num_exclude;
+};
+
+/// Add the pattern \a pattern (to the exclude patterns if \a exclude is true)
+/**
+* \retval 0 success
+* \retval -1 there are too many patterns (a warning is printed)
+*/
+static int
+name_patterns_add(struct name_patterns* np, const char* pattern, bool exclude)
+{
+    const char** patterns = exclude ? np->exclude : np->include;
+    size_t* num_patterns = exclude ? &np->num_exclude : &np->num_include;
+
+    if (*num_patterns == NAME_PATTERNS_MAX)
+    {
+        warnx("too many patterns (max %d)", NAME_PATTERNS_MAX);
+        return -1;
+    }
+
+    patterns[(*num_patterns)++] = pattern;
+    return 0;
+}
+
+/// Is the name \a name selected by the include and exclude patterns?
+static bool
+name_patterns_match(const struct name_patterns* np, const char* name)
+{
+    for (size_t i = 0; i < np->num_exclude; ++i)
+    {
+        if (fnmatch(np->exclude[i], name, 0) == 0)
+            return false;
+    }
+
+    if (np->num_include == 0)
+        return true;
+
+    for (size_t i = 0; i < np->num_include; ++i)
+    {
+        if (fnmatch(np->include[i], name, 0) == 0)
+            return true;
+    }
+
+    return false;
+}
+
+#if defined(__cplusplus)
+} // extern "C"
+#endif
@@ -0,0 +1,440 @@
+// SPDX-FileCopyrightText: Steven Ward
+// SPDX-License-Identifier: MPL-2.0
+
+/// Fast, validated parsing of integers
+/**
+* \file
+* \author Steven Ward
+* These are drop-in replacements for \c strtoumax and \c strtoimax, without locale or \c errno overhead.
+* Decimal digits are parsed 16 at a time with SSE4.1, or 8 at a time with SWAR.
+* Hexadecimal digits are parsed 8 at a time with SWAR.
+* \sa https://en.cppreference.com/w/c/string/byte/strtoimax
+* \sa https://lemire.me/blog/2022/01/21/swar-explained-parsing-eight-digits/
+* \sa http://0x80.pl/notesen/2014-10-12-parsing-decimal-numbers-part-1-swar.html
+* \sa http://0x80.pl/articles/simd-parsing-int-sequences.html
+* \sa https://graphics.stanford.edu/~seander/bithacks.html#HasBetweenInWord
+*/
+
+#pragma once
+
+#include <errno.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__SSE4_1__)
+#include <immintrin.h>
+#endif
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+#if defined(__cplusplus)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wold-style-cast"
+#pragma GCC diagnostic ignored "-Wuseless-cast"
+#endif
+
+#define SWAR_ONES UINT64_C(0x0101010101010101)
+#define SWAR_HIGH_BITS UINT64_C(0x8080808080808080)
+
+/// Load 8 bytes as a little-endian integer
+/**
+* The first character is in the least significant byte.
+*/
+static inline uint64_t
+swar_load8(const char* p)
+{
+    uint64_t v = 0;
+    (void)memcpy(&v, p, sizeof(v));
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    v = __builtin_bswap64(v);
+#endif
+    return v;
+}
+
+/// Set the high bit of each byte of \a v that is within [\a lo, \a hi]
+/**
+* \pre Every byte of \a v is less than \c 0x80.
+* \pre 0 < \a lo <= \a hi < 0x80
+*/
+static inline uint64_t
+swar_between(const uint64_t v, const uint8_t lo, const uint8_t hi)
+{
+    const uint64_t ge_lo = v + SWAR_ONES * (uint64_t)(0x80 - lo);
+    const uint64_t gt_hi = v + SWAR_ONES * (uint64_t)(0x7F - hi);
+    return ge_lo & ~gt_hi & SWAR_HIGH_BITS;
+}
+
+/// Get the number of leading bytes of \a v that have the high bit set in \a valid
+static inline unsigned int
+swar_leading_count(const uint64_t valid)
+{
+    const uint64_t invalid = ~valid & SWAR_HIGH_BITS;
+    return (invalid == 0) ? 8U : (unsigned int)__builtin_ctzll(invalid) / 8U;
+}
+
+/// Get the number of leading decimal digits in \a v
+static inline unsigned int
+swar_dec_digits8(const uint64_t v)
+{
+    const uint64_t ascii = ~v & SWAR_HIGH_BITS;
+    return swar_leading_count(swar_between(v & ~SWAR_HIGH_BITS, '0', '9') & ascii);
+}
+
+/// Get the number of leading hexadecimal digits in \a v
+static inline unsigned int
+swar_hex_digits8(const uint64_t v)
+{
+    const uint64_t ascii = ~v & SWAR_HIGH_BITS;
+    const uint64_t v7 = v & ~SWAR_HIGH_BITS;
+    // Setting bit 5 makes uppercase letters lowercase.
+    const uint64_t is_hex = swar_between(v7, '0', '9') |
+                            swar_between(v7 | (SWAR_ONES * 0x20), 'a', 'f');
+    return swar_leading_count(is_hex & ascii);
+}
+
+/// Convert 8 decimal digits to an integer
+/**
+* Bytes that are \c 0 are treated as the digit \c 0.
+* \sa https://lemire.me/blog/2022/01/21/swar-explained-parsing-eight-digits/
+*/
+static inline uint32_t
+swar_parse_dec8(uint64_t v)
+{
+    v &= SWAR_ONES * 0x0F;
+    v = (v * (10 << 8 | 1)) >> 8;
+    v = ((v & UINT64_C(0x00FF00FF00FF00FF)) * (100 << 16 | 1)) >> 16;
+    return (uint32_t)(((v & UINT64_C(0x0000FFFF0000FFFF)) * (UINT64_C(10000) << 32 | 1)) >> 32);
+}
+
+/// Convert 8 hexadecimal digits to an integer
+/**
+* Bytes that are \c 0 are treated as the digit \c 0.
+*/
+static inline uint32_t
+swar_parse_hex8(uint64_t v)
+{
+    // Letters have bit 6 set.
+    v = (v & (SWAR_ONES * 0x0F)) + ((v >> 6) & SWAR_ONES) * 9;
+    // The first character is the most significant nibble.
+    v = ((v & UINT64_C(0x000F000F000F000F)) << 4) | ((v >> 8) & UINT64_C(0x000F000F000F000F));
+    v = ((v & UINT64_C(0x000000FF000000FF)) << 8) | ((v >> 16) & UINT64_C(0x000000FF000000FF));
+    return (uint32_t)(((v & UINT64_C(0xFFFF)) << 16) | ((v >> 32) & UINT64_C(0xFFFF)));
+}
+
+#if defined(__SSE4_1__)
+/// Convert 16 decimal digits to an integer
+/**
+* \retval true if all 16 characters are decimal digits
+*/
+static inline bool
+sse_parse_dec16(const char* p, uint64_t* value)
+{
+    const __m128i chunk = _mm_loadu_si128((const __m128i*)p);
+    const __m128i digits = _mm_sub_epi8(chunk, _mm_set1_epi8('0'));
+    const __m128i is_digit = _mm_cmpeq_epi8(_mm_min_epu8(digits, _mm_set1_epi8(9)), digits);
+
+    if (_mm_movemask_epi8(is_digit) != 0xFFFF)
+        return false;
+
+    // 2 digits in each 16-bit lane
+    __m128i t = _mm_maddubs_epi16(digits, _mm_setr_epi8(10, 1, 10, 1, 10, 1, 10, 1,
+                                                        10, 1, 10, 1, 10, 1, 10, 1));
+    // 4 digits in each 32-bit lane
+    t = _mm_madd_epi16(t, _mm_setr_epi16(100, 1, 100, 1, 100, 1, 100, 1));
+    // 4 digits in each 16-bit lane
+    t = _mm_packus_epi32(t, t);
+    // 8 digits in each 32-bit lane
+    t = _mm_madd_epi16(t, _mm_setr_epi16(10000, 1, 10000, 1, 10000, 1, 10000, 1));
+
+    const uint64_t hi = (uint32_t)_mm_cvtsi128_si32(t);
+    const uint64_t lo = (uint32_t)_mm_extract_epi32(t, 1);
+    *value = hi * UINT64_C(100000000) + lo;
+    return true;
+}
+#endif
+
+/// Get the value of the digit \a c, or \c 36 if \a c is not a digit
+static inline unsigned int
+digit_value(const char c)
+{
+    const unsigned char uc = (unsigned char)c;
+    if (uc >= '0' && uc <= '9')
+        return (unsigned int)(uc - '0');
+    if ((uc | 0x20) >= 'a' && (uc | 0x20) <= 'z')
+        return (uc | 0x20U) - 'a' + 10;
+    return 36;
+}
+
+/// Parse the digits in [\a p, \a last) in base \a base
+/**
+* \param[in,out] p the first character, updated to the first character after the digits
+* \param[out] value the parsed value, or \c UINT64_MAX if it overflowed
+* \retval 0 success
+* \retval ERANGE overflow
+*/
+static inline int
+parse_digits(const char** p, const char* last, const unsigned int base, uint64_t* value)
+{
+    static const uint64_t pow10[9] = {
+        1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000,
+    };
+
+    const char* q = *p;
+    uint64_t x = 0;
+    bool overflow = false;
+
+    if (base == 10)
+    {
+#if defined(__SSE4_1__)
+        uint64_t chunk16 = 0;
+        while (last - q >= 16 && sse_parse_dec16(q, &chunk16))
+        {
+            overflow |= __builtin_mul_overflow(x, UINT64_C(10000000000000000), &x);
+            overflow |= __builtin_add_overflow(x, chunk16, &x);
+            q += 16;
+        }
+#endif
+        while (last - q >= 8)
+        {
+            uint64_t v = swar_load8(q);
+            const unsigned int n = swar_dec_digits8(v);
+            if (n == 0)
+                break;
+            if (n < 8)
+                v <<= 8 * (8 - n);
+            overflow |= __builtin_mul_overflow(x, pow10[n], &x);
+            overflow |= __builtin_add_overflow(x, (uint64_t)swar_parse_dec8(v), &x);
+            q += n;
+            if (n < 8)
+                goto done;
+        }
+    }
+    else if (base == 16)
+    {
+        while (last - q >= 8)
+        {
+            uint64_t v = swar_load8(q);
+            const unsigned int n = swar_hex_digits8(v);
+            if (n == 0)
+                break;
+            if (n < 8)
+                v <<= 8 * (8 - n);
+            overflow |= (x >> (64 - 4 * n)) != 0;
+            x = (x << (4 * n)) | swar_parse_hex8(v);
+            q += n;
+            if (n < 8)
+                goto done;
+        }
+    }
+
+    for (unsigned int d = 0; q < last && (d = digit_value(*q)) < base; ++q)
+    {
+        overflow |= __builtin_mul_overflow(x, (uint64_t)base, &x);
+        overflow |= __builtin_add_overflow(x, (uint64_t)d, &x);
+    }
+
+done:
+    *p = q;
+
+    if (overflow)
+    {
+        *value = UINT64_MAX;
+        return ERANGE;
+    }
+
+    *value = x;
+    return 0;
+}
+
+/// Parse the magnitude and sign of an integer
+/**
+* Like \c strtoumax, leading whitespace, an optional sign, and a base prefix are accepted.
+* If \a base is \c 0, the base is determined by the prefix:
+* "0x" or "0X" is hexadecimal, "0b" or "0B" is binary, "0" is octal, and otherwise decimal.
+*
+* \param first the first character
+* \param last one past the last character
+* \param base \c 0 or within [2, 36]
+* \param[out] magnitude the magnitude (\c UINT64_MAX if it overflowed)
+* \param[out] negative if there was a minus sign
+* \param[out] endptr if not null, the first character after the integer, or \a first if there are no digits
+* \retval 0 success
+* \retval EINVAL no digits, or invalid \a base
+* \retval ERANGE the magnitude is greater than \c UINT64_MAX
+*/
+static inline int
+parse_int_magnitude(const char* first, const char* last, unsigned int base,
+                    uint64_t* magnitude, bool* negative, const char** endptr)
+{
+    const char* p = first;
+
+    *magnitude = 0;
+    *negative = false;
+
+    if (endptr != nullptr)
+        *endptr = first;
+
+    if (base == 1 || base > 36)
+        return EINVAL;
+
+    // isspace in the "C" locale
+    while (p < last && (*p == ' ' || (*p >= '\t' && *p <= '\r')))
+        ++p;
+
+    if (p < last && (*p == '+' || *p == '-'))
+    {
+        *negative = (*p == '-');
+        ++p;
+    }
+
+    // The prefix is only skipped if a valid digit follows it.
+    if (last - p >= 3 && p[0] == '0')
+    {
+        const char x = (char)(p[1] | 0x20);
+        if (x == 'x' && (base == 0 || base == 16) && digit_value(p[2]) < 16)
+        {
+            base = 16;
+            p += 2;
+        }
+        else if (x == 'b' && (base == 0 || base == 2) && digit_value(p[2]) < 2)
+        {
+            base = 2;
+            p += 2;
+        }
+    }
+
+    if (base == 0)
+        base = (p < last && *p == '0') ? 8 : 10;
+
+    if (p == last || digit_value(*p) >= base)
+        return EINVAL;
+
+    const int result = parse_digits(&p, last, base, magnitude);
+
+    if (endptr != nullptr)
+        *endptr = p;
+
+    return result;
+}
+
+/// Parse an unsigned integer like \c strtoumax
+/**
+* A minus sign negates the value (modulo 2^64), like \c strtoumax.
+* \param[out] value the result, or \c UINTMAX_MAX if it overflowed
+* \retval 0 success
+* \retval EINVAL no digits
+* \retval ERANGE overflow
+* \sa parse_int_magnitude
+*/
+static inline int
+parse_umax(const char* first, const char* last, const unsigned int base,
+           uintmax_t* value, const char** endptr)
+{
+    uint64_t magnitude = 0;
+    bool negative = false;
+    const int result = parse_int_magnitude(first, last, base, &magnitude, &negative, endptr);
+
+    *value = (result != 0) ? magnitude : (negative ? -magnitude : magnitude);
+    return result;
+}
+
+/// Parse a signed integer like \c strtoimax
+/**
+* \param[out] value the result, or \c INTMAX_MIN or \c INTMAX_MAX if it overflowed
+* \retval 0 success
+* \retval EINVAL no digits
+* \retval ERANGE overflow
+* \sa parse_int_magnitude
+*/
+static inline int
+parse_imax(const char* first, const char* last, const unsigned int base,
+           intmax_t* value, const char** endptr)
+{
+    uint64_t magnitude = 0;
+    bool negative = false;
+    int result = parse_int_magnitude(first, last, base, &magnitude, &negative, endptr);
+
+    if (result == 0)
+    {
+        if (negative && magnitude > (uint64_t)INTMAX_MAX + 1)
+            result = ERANGE;
+        else if (!negative && magnitude > (uint64_t)INTMAX_MAX)
+            result = ERANGE;
+    }
+
+    if (result == ERANGE)
+        *value = negative ? INTMAX_MIN : INTMAX_MAX;
+    else
+        *value = negative ? (intmax_t)(0 - magnitude) : (intmax_t)magnitude;
+
+    return result;
+}
+
+/// Parse an unsigned integer that must be at most \a max
+/**
+* Unlike \c parse_umax, a minus sign is only allowed for zero.
+* \param[out] value the result, or \a max if it overflowed
+* \retval 0 success
+* \retval EINVAL no digits
+* \retval ERANGE the value is greater than \a max, or negative
+*/
+static inline int
+parse_uint_max(const char* first, const char* last, const unsigned int base,
+               const uint64_t max, uint64_t* value, const char** endptr)
+{
+    uint64_t magnitude = 0;
+    bool negative = false;
+    int result = parse_int_magnitude(first, last, base, &magnitude, &negative, endptr);
+
+    if (result == 0 && (magnitude > max || (negative && magnitude != 0)))
+        result = ERANGE;
+
+    *value = (result == ERANGE) ? max : magnitude;
+    return result;
+}
+
+/// Parse a signed integer that must be within [\a min, \a max]
+/**
+* \pre \a min <= 0 <= \a max
+* \param[out] value the result, or \a min or \a max if it overflowed
+* \retval 0 success
+* \retval EINVAL no digits
+* \retval ERANGE the value is not within [\a min, \a max]
+*/
+static inline int
+parse_int_range(const char* first, const char* last, const unsigned int base,
+                const int64_t min, const int64_t max, int64_t* value, const char** endptr)
+{
+    uint64_t magnitude = 0;
+    bool negative = false;
+    int result = parse_int_magnitude(first, last, base, &magnitude, &negative, endptr);
+
+    if (result == 0)
+    {
+        if (negative && magnitude > (uint64_t)0 - (uint64_t)min)
+            result = ERANGE;
+        else if (!negative && magnitude > (uint64_t)max)
+            result = ERANGE;
+    }
+
+    if (result == ERANGE)
+        *value = negative ? min : max;
+    else
+        *value = negative ? (int64_t)(0 - magnitude) : (int64_t)magnitude;
+
+    return result;
+}
+
+#undef SWAR_ONES
+#undef SWAR_HIGH_BITS
+
+#if defined(__cplusplus)
+#pragma GCC diagnostic pop
+#endif
+
+#if defined(__cplusplus)
+} // extern "C"
+#endif
@@ -0,0 +1,181 @@
+// SPDX-FileCopyrightText: Steven Ward
+// SPDX-License-Identifier: MPL-2.0
+
+/// A constexpr perfect hash map from string keys
+/**
+* \file
+* \author Steven Ward
+* The table is built at compile time with the "hash and displace" method (like CHD and PTHash).
+* Each key is hashed once with \c fnv1a_64.
+* The hash selects a bucket, and each bucket has a pilot value that is mixed with the hash to get the slot.
+* The pilots are chosen so no two keys have the same slot.
+* A lookup is one hash, one slot, and one string comparison.
+* \sa https://cmph.sourceforge.net/papers/esa09.pdf
+* \sa https://arxiv.org/abs/2104.10402
+* \sa fnv.hpp
+*/
+
+#pragma once
+
+#include "fnv.hpp"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string_view>
+#include <utility>
+
+/// A constexpr perfect hash map from \a N string keys to values of type \a T
+template <typename T, size_t N>
+requires (N > 0)
+class perfect_hash_map final
+{
+public:
+
+    using value_type = std::pair<std::string_view, T>;
+
+    /// Build the table
+    /**
+    * \throw std::invalid_argument if a key is duplicated (which is a compile error in a constant expression)
+    */
+    constexpr explicit perfect_hash_map(const value_type (&entries)[N]) :
+        entries_{std::to_array(entries)}
+    {
+        build();
+    }
+
+    /// Get the value of \a key
+    /**
+    * \return a pointer to the value, or \c nullptr if \a key is not in the map
+    */
+    [[nodiscard]] constexpr const T* find(const std::string_view key) const noexcept
+    {
+        const uint32_t i = slots_[get_slot(fnv1a_64(key))];
+        return (i < N && entries_[i].first == key) ? &entries_[i].second : nullptr;
+    }
+
+    [[nodiscard]] constexpr bool contains(const std::string_view key) const noexcept
+    {
+        return find(key) != nullptr;
+    }
+
+    [[nodiscard]] static constexpr size_t size() noexcept { return N; }
+
+    [[nodiscard]] constexpr auto begin() const noexcept { return entries_.cbegin(); }
+    [[nodiscard]] constexpr auto end() const noexcept { return entries_.cend(); }
+
+private:
+
+    // a few keys per bucket
+    static constexpr size_t num_buckets = (N + 3) / 4;
+
+    // a power of 2 that is at least N
+    static constexpr size_t num_slots = std::bit_ceil(N);
+
+    static constexpr uint32_t empty_slot = UINT32_MAX;
+
+    std::array<value_type, N> entries_;
+    std::array<uint32_t, num_buckets> pilots_{};
+    std::array<uint32_t, num_slots> slots_{}; // the index of the entry in each slot
+
+    [[nodiscard]] static constexpr size_t get_bucket(const uint64_t hash) noexcept
+    {
+        return (hash >> 32) % num_buckets;
+    }
+
+    [[nodiscard]] static constexpr size_t get_slot(const uint64_t hash, const uint32_t pilot) noexcept
+    {
+        const uint64_t x = (hash ^ (pilot * UINT64_C(0x9E3779B97F4A7C15))) * UINT64_C(0xD6E8FEB86659FD93);
+        return (x >> 32) & (num_slots - 1);
+    }
+
+    [[nodiscard]] constexpr size_t get_slot(const uint64_t hash) const noexcept
+    {
+        return get_slot(hash, pilots_[get_bucket(hash)]);
+    }
+
+    constexpr void build()
+    {
+        std::array<uint64_t, N> hashes{};
+        for (size_t i = 0; i < N; ++i)
+        {
+            hashes[i] = fnv1a_64(entries_[i].first);
+
+            for (size_t j = 0; j < i; ++j)
+            {
+                if (entries_[j].first == entries_[i].first)
+                    throw std::invalid_argument("perfect_hash_map: duplicate key");
+            }
+        }
+
+        // Sort the entries by bucket, and the buckets by size (largest first).
+        std::array<size_t, num_buckets> bucket_sizes{};
+        for (const auto hash : hashes)
+            ++bucket_sizes[get_bucket(hash)];
+
+        std::array<uint32_t, N> order{};
+        for (size_t i = 0; i < N; ++i)
+            order[i] = static_cast<uint32_t>(i);
+
+        std::sort(order.begin(), order.end(), [&](const uint32_t a, const uint32_t b)
+        {
+            const size_t bucket_a = get_bucket(hashes[a]);
+            const size_t bucket_b = get_bucket(hashes[b]);
+            if (bucket_sizes[bucket_a] != bucket_sizes[bucket_b])
+                return bucket_sizes[bucket_a] > bucket_sizes[bucket_b];
+            return bucket_a < bucket_b;
+        });
+
+        slots_.fill(empty_slot);
+
+        for (size_t first = 0; first < N;)
+        {
+            const size_t bucket = get_bucket(hashes[order[first]]);
+            const size_t last = first + bucket_sizes[bucket];
+
+            // Find a pilot that puts every key of the bucket in a different empty slot.
+            for (uint32_t pilot = 0;; ++pilot)
+            {
+                if (pilot == UINT32_MAX)
+                    throw std::invalid_argument("perfect_hash_map: no pilot found");
+
+                size_t placed = first;
+                for (; placed < last; ++placed)
+                {
+                    const size_t slot = get_slot(hashes[order[placed]], pilot);
+                    if (slots_[slot] != empty_slot)
+                        break;
+                    slots_[slot] = order[placed];
+                }
+
+                if (placed == last)
+                {
+                    pilots_[bucket] = pilot;
+                    break;
+                }
+
+                // Undo the partial placement.
+                for (size_t i = first; i < placed; ++i)
+                    slots_[get_slot(hashes[order[i]], pilot)] = empty_slot;
+            }
+
+            first = last;
+        }
+    }
+};
+
+/// Make a perfect hash map from string keys to values of type \a T
+/**
+* \code
+* constexpr auto colors = make_perfect_hash_map<int>({{"red", 1}, {"green", 2}, {"blue", 3}});
+* \endcode
+*/
+template <typename T, size_t N>
+[[nodiscard]] constexpr auto
+make_perfect_hash_map(const std::pair<std::string_view, T> (&entries)[N])
+{
+    return perfect_hash_map<T, N>(entries);
+}
@@ -0,0 +1,228 @@
+// SPDX-FileCopyrightText: Steven Ward
+// SPDX-License-Identifier: MPL-2.0
+
+/// Re-read a pseudo-file (in /proc or /sys) without reopening it, and scan integers in it
+/**
+* \file
+* \author Steven Ward
+* Unlike \c pscanf, which calls \c fopen, \c vfscanf, and \c fclose every time,
+* the file is opened once, and every read is a \c pread at offset 0 into the same buffer.
+* The buffer only grows if the file does not fit in it, so reading does not allocate.
+* The scan functions parse the buffer in place (with \c parse_digits).
+* \sa pscanf.h
+* \sa parse_int.h
+*/
+
+#pragma once
+
+#include "parse_int.h"
+
+#include <err.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+#if defined(__cplusplus)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wold-style-cast"
+#pragma GCC diagnostic ignored "-Wuseless-cast"
+#endif
+
+#define PREADER_INIT_CAPACITY 4096
+
+/// A pseudo-file that is re-read with \c pread
+struct preader
+{
+    const char* path;
+    int fd;
+    char* buf; // the contents of the file (null-terminated)
+    size_t cap;
+    size_t len;
+};
+
+/// Open \a path
+/**
+* \a path is not copied.
+* \retval 0 success
+* \retval -1 failure (a warning is printed)
+*/
+static int
+preader_open(struct preader* r, const char* path)
+{
+    r->path = path;
+    r->buf = nullptr;
+    r->cap = 0;
+    r->len = 0;
+
+    r->fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (r->fd < 0)
+    {
+        warn("open '%s'", path);
+        return -1;
+    }
+
+    r->buf = (char*)malloc(PREADER_INIT_CAPACITY);
+    if (r->buf == nullptr)
+    {
+        warn("malloc");
+        (void)close(r->fd);
+        r->fd = -1;
+        return -1;
+    }
+    r->cap = PREADER_INIT_CAPACITY;
+    r->buf[0] = '\0';
+
+    return 0;
+}
+
+static void
+preader_close(struct preader* r)
+{
+    if (r->fd >= 0)
+        (void)close(r->fd);
+    r->fd = -1;
+    free(r->buf);
+    r->buf = nullptr;
+    r->cap = 0;
+    r->len = 0;
+}
+
+/// Read the whole file into the buffer
+/**
+* If the file fills the buffer, the buffer is doubled and the file is read again,
+* so the contents are from one generation of the file.
+* \return the length of the contents, or \c -1 on failure (a warning is printed)
+*/
+static ssize_t
+preader_read(struct preader* r)
+{
+    while (true)
+    {
+        size_t len = 0;
+
+        while (len < r->cap - 1)
+        {
+            const ssize_t n = pread(r->fd, r->buf + len, r->cap - 1 - len, (off_t)len);
+            if (n < 0)
+            {
+                if (errno == EINTR)
+                    continue;
+                warn("pread '%s'", r->path);
+                return -1;
+            }
+            if (n == 0)
+                break;
+            len += (size_t)n;
+        }
+
+        if (len < r->cap - 1)
+        {
+            r->buf[len] = '\0';
+            r->len = len;
+            return (ssize_t)len;
+        }
+
+        char* buf = (char*)realloc(r->buf, r->cap * 2);
+        if (buf == nullptr)
+        {
+            warn("realloc");
+            return -1;
+        }
+        r->buf = buf;
+        r->cap *= 2;
+    }
+}
+
+/// Skip spaces and tabs
+static inline void
+scan_skip_blanks(const char** p, const char* last)
+{
+    const char* q = *p;
+    while (q < last && (*q == ' ' || *q == '\t'))
+        ++q;
+    *p = q;
+}
+
+/// Skip blanks, then scan a decimal unsigned integer
+/**
+* \retval true success
+* \retval false no digits, or overflow
+*/
+static inline bool
+scan_u64(const char** p, const char* last, uint64_t* value)
+{
+    scan_skip_blanks(p, last);
+
+    const char* q = *p;
+    if (q == last || (unsigned char)(*q - '0') > 9)
+        return false;
+
+    return parse_digits(p, last, 10, value) == 0;
+}
+
+/// Skip blanks, then skip a field (a sequence of characters that are not blanks or newlines)
+/**
+* \retval false there is no field on the line
+*/
+static inline bool
+scan_skip_field(const char** p, const char* last)
+{
+    scan_skip_blanks(p, last);
+
+    const char* q = *p;
+    while (q < last && *q != ' ' && *q != '\t' && *q != '\n')
+        ++q;
+
+    const bool found = q != *p;
+    *p = q;
+    return found;
+}
+
+/// Skip to the start of the next line
+/**
+* \retval false there is no next line
+*/
+static inline bool
+scan_next_line(const char** p, const char* last)
+{
+    const char* q = (const char*)memchr(*p, '\n', (size_t)(last - *p));
+    if (q == nullptr)
+    {
+        *p = last;
+        return false;
+    }
+    *p = q + 1;
+    return *p < last;
+}
+
+/// Read the file, and scan the integer at its start (e.g. a sysfs attribute)
+/**
+* \retval 0 success
+* \retval -1 failure
+*/
+static int
+preader_read_u64(struct preader* r, uint64_t* value)
+{
+    if (preader_read(r) < 0)
+        return -1;
+
+    const char* p = r->buf;
+    return scan_u64(&p, r->buf + r->len, value) ? 0 : -1;
+}
+
+#if defined(__cplusplus)
+#pragma GCC diagnostic pop
+#endif
+
+#if defined(__cplusplus)
+} // extern "C"
+#endif
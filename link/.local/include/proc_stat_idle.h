@@ -0,0 +1,60 @@
+// SPDX-FileCopyrightText: Steven Ward
+// SPDX-License-Identifier: MPL-2.0
+
+/// Get the idle ticks and the total ticks of all CPUs from /proc/stat
+/**
+* \file
+* \author Steven Ward
+* Adapted from my slstatus
+* https://github.com/planet36/slstatus/blob/main/components/cpu.c
+* \sa preader.h
+*/
+
+#pragma once
+
+#include "preader.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+/// Read /proc/stat with \a stat_reader, and scan its first ("cpu") line into \a idle and \a sum
+/**
+* iowait is excluded from \a sum, because the CPU is idle while it waits.
+* \retval 0 success
+* \retval -1 failure
+*/
+static int
+proc_stat_idle(struct preader* stat_reader, uint64_t* idle, uint64_t* sum)
+{
+    if (preader_read(stat_reader) < 0)
+        return -1;
+
+    const char* p = stat_reader->buf;
+    const char* const last = p + stat_reader->len;
+
+    uint64_t a[7];
+
+    // cpu user nice system idle iowait irq softirq
+    if (!scan_skip_field(&p, last))
+        return -1;
+
+    for (size_t i = 0; i < 7; ++i)
+    {
+        if (!scan_u64(&p, last, &a[i]))
+            return -1;
+    }
+
+    *idle = a[3];
+    // iowait is excluded
+    *sum = a[0] + a[1] + a[2] + a[3] + a[5] + a[6];
+
+    return 0;
+}
+
+#if defined(__cplusplus)
+} // extern "C"
+#endif
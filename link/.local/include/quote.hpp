@@ -9,12 +9,15 @@
 * \sa https://www.gnu.org/software/bash/manual/bash.html#Single-Quotes
 *
 * Note: Only \c std::string is supported.
+*
+* The overloads with a \c std::pmr::memory_resource (e.g. an \c arena) allocate the result from it.
 */
 
 #pragma once
 
 #include <cctype>
 #include <cstdint>
+#include <memory_resource>
 #include <string>
 #include <string_view>
 
@@ -88,7 +91,7 @@ is_special_char_shell(const char c)
 
 /// Does the string contain special characters for a POSIX shell?
 bool
-contains_special_chars_shell(const std::string& s)
+contains_special_chars_shell(const std::string_view s)
 {
     for (const auto c : s)
     {
@@ -147,20 +150,33 @@ escape_shell(const char c)
 /**
 * \sa https://pubs.opengroup.org/onlinepubs/9699919799/utilities/V3_chap02.html#tag_18_02
 */
-std::string
-escape_shell(const std::string& s)
+template <typename String = std::string>
+String
+escape_shell(const std::string_view s, const typename String::allocator_type& alloc = {})
 {
-    std::string result;
+    String result(alloc);
     result.reserve(s.size());
 
     for (const auto c : s)
     {
-        result += escape_shell(c);
+        result += std::string_view{escape_shell(c)};
     }
 
     return result;
 }
 
+std::string
+escape_shell(const std::string& s)
+{
+    return escape_shell<std::string>(s);
+}
+
+std::pmr::string
+escape_shell(const std::string_view s, std::pmr::memory_resource* const mr)
+{
+    return escape_shell<std::pmr::string>(s, mr);
+}
+
 /// Quote the string for a POSIX shell
 /**
 * \sa https://www.gnu.org/software/bash/manual/bash.html#Single-Quotes
@@ -170,12 +186,13 @@ character within the quotes. A single quote may not occur between single
 quotes, even when preceded by a backslash.
 </blockquote>
 */
-std::string
-quote_shell_always(const std::string& s)
+template <typename String = std::string>
+String
+quote_shell_always(const std::string_view s, const typename String::allocator_type& alloc = {})
 {
     constexpr char delim = SINGLE_QUOTE;
 
-    std::string result;
+    String result(alloc);
     result.reserve(s.size() + 2);
 
     result += delim;
@@ -200,20 +217,45 @@ quote_shell_always(const std::string& s)
     return result;
 }
 
-/// Conditionally quote the string for a POSIX shell
 std::string
-quote_shell(const std::string& s)
+quote_shell_always(const std::string& s)
+{
+    return quote_shell_always<std::string>(s);
+}
+
+std::pmr::string
+quote_shell_always(const std::string_view s, std::pmr::memory_resource* const mr)
+{
+    return quote_shell_always<std::pmr::string>(s, mr);
+}
+
+/// Conditionally quote the string for a POSIX shell
+template <typename String = std::string>
+String
+quote_shell(const std::string_view s, const typename String::allocator_type& alloc = {})
 {
     if (s.empty() || contains_special_chars_shell(s))
     {
-        return quote_shell_always(s);
+        return quote_shell_always<String>(s, alloc);
     }
     else
     {
-        return s;
+        return String(s, alloc);
     }
 }
 
+std::string
+quote_shell(const std::string& s)
+{
+    return quote_shell<std::string>(s);
+}
+
+std::pmr::string
+quote_shell(const std::string_view s, std::pmr::memory_resource* const mr)
+{
+    return quote_shell<std::pmr::string>(s, mr);
+}
+
 /// Escape the character for a C character literal
 /**
 * \sa https://en.cppreference.com/w/c/language/escape
@@ -265,19 +307,20 @@ quote_c(const char c)
 }
 
 /// Quote the string for a C string literal
-std::string
-quote_c(const std::string& s)
+template <typename String = std::string>
+String
+quote_c(const std::string_view s, const typename String::allocator_type& alloc = {})
 {
     constexpr char delim = DOUBLE_QUOTE;
 
-    std::string result;
+    String result(alloc);
     result.reserve(s.size() + 2);
 
     result += delim;
 
     for (const auto c : s)
     {
-        result += escape_c(c);
+        result += std::string_view{escape_c(c)};
     }
 
     result += delim;
@@ -285,6 +328,18 @@ quote_c(const std::string& s)
     return result;
 }
 
+std::string
+quote_c(const std::string& s)
+{
+    return quote_c<std::string>(s);
+}
+
+std::pmr::string
+quote_c(const std::string_view s, std::pmr::memory_resource* const mr)
+{
+    return quote_c<std::pmr::string>(s, mr);
+}
+
 /// Escape the character for a Perl Compatible Regular Expression (PCRE)
 /**
 * \sa https://perldoc.perl.org/perlre#Escape-sequences
@@ -319,36 +374,57 @@ escape_pcre(const char c)
 }
 
 /// Escape the string for a Perl Compatible Regular Expression (PCRE)
-std::string
-escape_pcre(const std::string& s)
+template <typename String = std::string>
+String
+escape_pcre(const std::string_view s, const typename String::allocator_type& alloc = {})
 {
-    std::string result;
+    String result(alloc);
     result.reserve(s.size());
 
     for (const auto c : s)
     {
-        result += escape_pcre(c);
+        result += std::string_view{escape_pcre(c)};
     }
 
     return result;
 }
 
+std::string
+escape_pcre(const std::string& s)
+{
+    return escape_pcre<std::string>(s);
+}
+
+std::pmr::string
+escape_pcre(const std::string_view s, std::pmr::memory_resource* const mr)
+{
+    return escape_pcre<std::pmr::string>(s, mr);
+}
+
 inline std::string
 quote(const std::string& s)
 {
     return quote_shell_always(s);
 }
 
+inline std::pmr::string
+quote(const std::string_view s, std::pmr::memory_resource* const mr)
+{
+    return quote_shell_always(s, mr);
+}
+
 /// Quote the string similar to \c std::quoted
 /**
 * \sa https://en.cppreference.com/w/cpp/io/manip/quoted
 */
-std::string
-quote_simple(const std::string& s,
+template <typename String = std::string>
+String
+quote_simple(const std::string_view s,
              const char delim = DOUBLE_QUOTE,
-             const char escape = BACKSLASH)
+             const char escape = BACKSLASH,
+             const typename String::allocator_type& alloc = {})
 {
-    std::string result;
+    String result(alloc);
     result.reserve(s.size() + 2);
 
     result += delim;
@@ -367,3 +443,21 @@ quote_simple(const std::string& s,
 
     return result;
 }
+
+std::string
+quote_simple(const std::string& s,
+             const char delim = DOUBLE_QUOTE,
+             const char escape = BACKSLASH)
+{
+    return quote_simple<std::string>(s, delim, escape);
+}
+
+/// Quote the string similar to \c std::quoted
+std::pmr::string
+quote_simple(const std::string_view s,
+             std::pmr::memory_resource* const mr,
+             const char delim = DOUBLE_QUOTE,
+             const char escape = BACKSLASH)
+{
+    return quote_simple<std::pmr::string>(s, delim, escape, mr);
+}
@@ -0,0 +1,480 @@
+// SPDX-FileCopyrightText: Steven Ward
+// SPDX-License-Identifier: MPL-2.0
+
+/// A counting quotient filter
+/**
+* \file
+* \author Steven Ward
+* Each key has a fingerprint: a quotient (which is the index of its canonical slot) and a remainder (which is stored).
+* The remainders of the same quotient are stored in a sorted run, starting at or after the canonical slot.
+* Each slot has 3 metadata bits: "occupied" (a run for this quotient exists),
+* "continuation" (this is not the first remainder of its run), and "shifted" (this is not in its canonical slot).
+* Unlike a Bloom filter, keys can be removed, and a key can be inserted more than once (so it is counted).
+*
+* The key is mixed with the seed by \c mumx_mix_u64x2,
+* and the quotient and the remainder are taken from the two results, so they are independent.
+*
+* Like \c blocked_bloom_filter, the filter can be written to a flat byte image (in the native byte order).
+*
+* \tparam Slot the type of a slot (the remainder has the bits of \a Slot minus 3)
+*
+* \sa https://en.wikipedia.org/wiki/Quotient_filter
+* \sa https://vldb.org/pvldb/vol5/p1627_michaelabender_vldb2012.pdf
+* \sa bloom_filter.hpp
+*/
+
+#pragma once
+
+#include "fnv.hpp"
+#include "mix.hpp"
+
+#include <algorithm>
+#include <array>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <stdexcept>
+#include <string_view>
+#include <vector>
+
+namespace quotient_filter_detail
+{
+
+/// the header of a filter image
+struct alignas(64) image_header
+{
+    std::array<char, 8> magic;
+    uint64_t seed;
+    uint64_t quotient_bits;
+    uint64_t slot_size;
+    uint64_t count;
+};
+
+inline constexpr std::array<char, 8> image_magic{'Q', 'F', 'I', 'L', 'T', '0', '0', '1'};
+
+}
+
+/// A counting quotient filter
+template <std::unsigned_integral Slot = uint32_t>
+requires (sizeof(Slot) >= 2)
+class quotient_filter final
+{
+public:
+
+    static constexpr unsigned int remainder_bits = sizeof(Slot) * 8 - 3;
+
+    /// Make a filter with 2**\a quotient_bits slots
+    /**
+    * \throw std::invalid_argument if \a quotient_bits is not in [1, 40]
+    */
+    explicit quotient_filter(const unsigned int quotient_bits, const uint64_t seed = 0) :
+        seed_{seed},
+        quotient_bits_{quotient_bits}
+    {
+        if (quotient_bits < 1 || quotient_bits > 40)
+            throw std::invalid_argument("quotient_filter");
+
+        slots_.resize(size_t{1} << quotient_bits);
+    }
+
+    /// Copy the filter in the image \a image
+    /**
+    * \throw std::invalid_argument if the image is not valid
+    */
+    [[nodiscard]] static quotient_filter
+    from_image(const std::span<const std::byte> image)
+    {
+        using quotient_filter_detail::image_header;
+
+        image_header header{};
+        if (std::size(image) < sizeof(header))
+            throw std::invalid_argument("quotient_filter: invalid image");
+        (void)std::memcpy(&header, std::data(image), sizeof(header));
+
+        if (header.magic != quotient_filter_detail::image_magic || header.slot_size != sizeof(Slot) ||
+            header.quotient_bits < 1 || header.quotient_bits > 40 ||
+            (std::size(image) - sizeof(header)) / sizeof(Slot) < (size_t{1} << header.quotient_bits) ||
+            header.count > (size_t{1} << header.quotient_bits))
+            throw std::invalid_argument("quotient_filter: invalid image");
+
+        quotient_filter result(static_cast<unsigned int>(header.quotient_bits), header.seed);
+        (void)std::memcpy(result.slots_.data(), std::data(image) + sizeof(header),
+                          result.slots_.size() * sizeof(Slot));
+
+        if (header.count != result.num_entries())
+            throw std::invalid_argument("quotient_filter: invalid image");
+
+        result.count_ = header.count;
+        return result;
+    }
+
+    /// Insert \a key
+    /**
+    * \return false if the filter is full
+    */
+    bool insert(const uint64_t key) noexcept
+    {
+        return insert_fingerprint(fingerprint(key));
+    }
+
+    bool insert(const std::string_view key) noexcept
+    {
+        return insert(fnv1a_64(key));
+    }
+
+    /// Remove one copy of \a key
+    /**
+    * Only remove keys that were inserted; removing another key (that is a false positive) removes the wrong key.
+    * \return false if \a key was not found
+    */
+    bool erase(const uint64_t key) noexcept
+    {
+        return erase_fingerprint(fingerprint(key));
+    }
+
+    bool erase(const std::string_view key) noexcept
+    {
+        return erase(fnv1a_64(key));
+    }
+
+    /// Get the number of copies of \a key (which may be too high, but not too low)
+    [[nodiscard]] size_t count(const uint64_t key) const noexcept
+    {
+        const auto [fq, fr] = fingerprint(key);
+
+        if (!is_occupied(slots_[fq]))
+            return 0;
+
+        size_t result = 0;
+        size_t s = find_run_index(fq);
+        do
+        {
+            const Slot rem = remainder(slots_[s]);
+            if (rem == fr)
+                ++result;
+            else if (rem > fr)
+                break;
+            s = incr(s);
+        }
+        while (is_continuation(slots_[s]));
+
+        return result;
+    }
+
+    [[nodiscard]] size_t count(const std::string_view key) const noexcept
+    {
+        return count(fnv1a_64(key));
+    }
+
+    /// Is \a key possibly in the filter?
+    [[nodiscard]] bool contains(const uint64_t key) const noexcept
+    {
+        return count(key) != 0;
+    }
+
+    [[nodiscard]] bool contains(const std::string_view key) const noexcept
+    {
+        return contains(fnv1a_64(key));
+    }
+
+    void clear() noexcept
+    {
+        std::ranges::fill(slots_, Slot{0});
+        count_ = 0;
+    }
+
+    /// the number of keys (including copies)
+    [[nodiscard]] size_t size() const noexcept { return count_; }
+
+    /// the number of slots
+    [[nodiscard]] size_t capacity() const noexcept { return slots_.size(); }
+
+    [[nodiscard]] bool empty() const noexcept { return count_ == 0; }
+
+    /// the size of the image in bytes
+    [[nodiscard]] size_t image_size() const noexcept
+    {
+        return sizeof(quotient_filter_detail::image_header) + slots_.size() * sizeof(Slot);
+    }
+
+    /// Write the image of the filter to \a buf
+    /**
+    * \throw std::invalid_argument if \a buf is smaller than \c image_size()
+    */
+    void write_image(const std::span<std::byte> buf) const
+    {
+        if (std::size(buf) < image_size())
+            throw std::invalid_argument("quotient_filter::write_image");
+
+        // Value-initialize the header so its padding is zeroed.
+        quotient_filter_detail::image_header header{};
+        header.magic = quotient_filter_detail::image_magic;
+        header.seed = seed_;
+        header.quotient_bits = quotient_bits_;
+        header.slot_size = sizeof(Slot);
+        header.count = count_;
+        (void)std::memcpy(std::data(buf), &header, sizeof(header));
+        (void)std::memcpy(std::data(buf) + sizeof(header), slots_.data(), slots_.size() * sizeof(Slot));
+    }
+
+    /// Get the image of the filter
+    [[nodiscard]] std::vector<std::byte> image() const
+    {
+        std::vector<std::byte> result(image_size());
+        write_image(result);
+        return result;
+    }
+
+private:
+
+    // the metadata bits of a slot
+    static constexpr Slot occupied_bit = 1;
+    static constexpr Slot continuation_bit = 2;
+    static constexpr Slot shifted_bit = 4;
+    static constexpr Slot metadata_mask = 7;
+
+    struct fingerprint_t
+    {
+        size_t quotient;
+        Slot remainder;
+    };
+
+    uint64_t seed_;
+    unsigned int quotient_bits_;
+    size_t count_ = 0;
+    std::vector<Slot> slots_;
+
+    [[nodiscard]] fingerprint_t fingerprint(const uint64_t key) const noexcept
+    {
+        uint64_t x0 = key;
+        uint64_t x1 = seed_;
+        mumx_mix_u64x2(x0, x1);
+        return {x0 >> (64 - quotient_bits_),
+                static_cast<Slot>(x1 & ((uint64_t{1} << remainder_bits) - 1))};
+    }
+
+    [[nodiscard]] size_t incr(const size_t i) const noexcept { return (i + 1) & (slots_.size() - 1); }
+    [[nodiscard]] size_t decr(const size_t i) const noexcept { return (i - 1) & (slots_.size() - 1); }
+
+    [[nodiscard]] static bool is_occupied(const Slot s) noexcept { return (s & occupied_bit) != 0; }
+    [[nodiscard]] static bool is_continuation(const Slot s) noexcept { return (s & continuation_bit) != 0; }
+    [[nodiscard]] static bool is_shifted(const Slot s) noexcept { return (s & shifted_bit) != 0; }
+    [[nodiscard]] static bool is_empty_slot(const Slot s) noexcept { return (s & metadata_mask) == 0; }
+
+    /// the number of slots that are not empty (each holds one entry)
+    [[nodiscard]] size_t num_entries() const noexcept
+    {
+        size_t n = 0;
+        for (const Slot s : slots_)
+            n += !is_empty_slot(s);
+        return n;
+    }
+
+    [[nodiscard]] static bool is_run_start(const Slot s) noexcept
+    {
+        return !is_continuation(s) && (is_occupied(s) || is_shifted(s));
+    }
+
+    [[nodiscard]] static bool is_cluster_start(const Slot s) noexcept
+    {
+        return is_occupied(s) && !is_continuation(s) && !is_shifted(s);
+    }
+
+    [[nodiscard]] static Slot remainder(const Slot s) noexcept { return static_cast<Slot>(s >> 3); }
+
+    [[nodiscard]] static Slot set_bits(const Slot s, const Slot bits) noexcept { return static_cast<Slot>(s | bits); }
+    [[nodiscard]] static Slot clear_bits(const Slot s, const Slot bits) noexcept { return static_cast<Slot>(s & ~bits); }
+
+    /// Get the index of the first slot of the run of the quotient \a fq
+    [[nodiscard]] size_t find_run_index(const size_t fq) const noexcept
+    {
+        // Find the start of the cluster.
+        size_t b = fq;
+        while (is_shifted(slots_[b]))
+            b = decr(b);
+
+        // Skip the runs of the quotients before fq.
+        size_t s = b;
+        while (b != fq)
+        {
+            do
+            {
+                s = incr(s);
+            }
+            while (is_continuation(slots_[s]));
+
+            do
+            {
+                b = incr(b);
+            }
+            while (!is_occupied(slots_[b]));
+        }
+
+        return s;
+    }
+
+    /// Insert \a entry at \a s, and shift the following entries of the cluster
+    void insert_into(size_t s, Slot entry) noexcept
+    {
+        bool empty;
+        do
+        {
+            Slot prev = slots_[s];
+            empty = is_empty_slot(prev);
+            if (!empty)
+            {
+                // The occupied bit belongs to the slot, not to the entry.
+                prev = set_bits(prev, shifted_bit);
+                if (is_occupied(prev))
+                {
+                    entry = set_bits(entry, occupied_bit);
+                    prev = clear_bits(prev, occupied_bit);
+                }
+            }
+            slots_[s] = entry;
+            entry = prev;
+            s = incr(s);
+        }
+        while (!empty);
+    }
+
+    bool insert_fingerprint(const fingerprint_t fp) noexcept
+    {
+        const auto [fq, fr] = fp;
+
+        if (count_ == slots_.size())
+            return false;
+
+        Slot entry = static_cast<Slot>(fr << 3);
+        const Slot t_fq = slots_[fq];
+
+        if (is_empty_slot(t_fq))
+        {
+            slots_[fq] = set_bits(entry, occupied_bit);
+            ++count_;
+            return true;
+        }
+
+        const bool run_exists = is_occupied(t_fq);
+        if (!run_exists)
+            slots_[fq] = set_bits(t_fq, occupied_bit);
+
+        const size_t start = find_run_index(fq);
+        size_t s = start;
+
+        if (run_exists)
+        {
+            // Keep the run sorted (a copy goes after the equal remainders).
+            do
+            {
+                if (remainder(slots_[s]) > fr)
+                    break;
+                s = incr(s);
+            }
+            while (is_continuation(slots_[s]));
+
+            if (s == start)
+            {
+                // The old first entry of the run becomes a continuation.
+                slots_[start] = set_bits(slots_[start], continuation_bit);
+            }
+            else
+            {
+                entry = set_bits(entry, continuation_bit);
+            }
+        }
+
+        if (s != fq)
+            entry = set_bits(entry, shifted_bit);
+
+        insert_into(s, entry);
+        ++count_;
+        return true;
+    }
+
+    /// Remove the entry at \a s (of the quotient \a quot), and shift the following entries of the cluster back
+    void delete_entry(size_t s, size_t quot) noexcept
+    {
+        const size_t orig = s;
+        Slot curr = slots_[s];
+        size_t sp = incr(s);
+
+        while (true)
+        {
+            const Slot next = slots_[sp];
+            const bool curr_occupied = is_occupied(curr);
+
+            if (is_empty_slot(next) || is_cluster_start(next) || sp == orig)
+            {
+                slots_[s] = 0;
+                return;
+            }
+
+            // Fix the entries that slide into their canonical slots.
+            Slot updated_next = next;
+            if (is_run_start(next))
+            {
+                do
+                {
+                    quot = incr(quot);
+                }
+                while (!is_occupied(slots_[quot]));
+
+                if (curr_occupied && quot == s)
+                    updated_next = clear_bits(next, shifted_bit);
+            }
+
+            slots_[s] = curr_occupied ? set_bits(updated_next, occupied_bit) : clear_bits(updated_next, occupied_bit);
+            s = sp;
+            sp = incr(sp);
+            curr = next;
+        }
+    }
+
+    bool erase_fingerprint(const fingerprint_t fp) noexcept
+    {
+        const auto [fq, fr] = fp;
+
+        if (!is_occupied(slots_[fq]) || count_ == 0)
+            return false;
+
+        // Find the entry.
+        size_t s = find_run_index(fq);
+        Slot rem;
+        do
+        {
+            rem = remainder(slots_[s]);
+            if (rem >= fr)
+                break;
+            s = incr(s);
+        }
+        while (is_continuation(slots_[s]));
+
+        if (rem != fr)
+            return false;
+
+        const bool replace_run_start = is_run_start(slots_[s]);
+
+        // If this is the only entry of the run, the quotient is no longer occupied.
+        if (replace_run_start && !is_continuation(slots_[incr(s)]))
+            slots_[fq] = clear_bits(slots_[fq], occupied_bit);
+
+        delete_entry(s, fq);
+
+        if (replace_run_start)
+        {
+            // The next entry of the run is the new first entry.
+            Slot next = slots_[s];
+            if (is_continuation(next))
+                next = clear_bits(next, continuation_bit);
+            if (s == fq && is_run_start(next))
+                next = clear_bits(next, shifted_bit);
+            slots_[s] = next;
+        }
+
+        --count_;
+        return true;
+    }
+};
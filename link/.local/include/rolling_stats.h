@@ -0,0 +1,352 @@
+// SPDX-FileCopyrightText: Steven Ward
+// SPDX-License-Identifier: MPL-2.0
+
+/// Rolling statistics of a sampled metric: EWMAs, and the min, max, mean, and percentiles of a sliding window
+/**
+* \file
+* \author Steven Ward
+* The window is the last \c window samples (a \c circqueue).
+* - The EWMAs have time constants (in seconds), and use the actual time between samples,
+*   so they are correct if samples are late or the interval changes.
+* - The min and max are the fronts of monotonic deques (also \c circqueue), so a push is amortized O(1).
+* - The percentiles are estimated from a fixed-bucket histogram of the window
+*   (linear or logarithmic buckets between \c hist_lo and \c hist_hi),
+*   and clamped to the exact min and max.
+*
+* NaN samples are ignored.
+* \sa circqueue.h
+* \sa https://en.wikipedia.org/wiki/Exponential_smoothing#Time_constant
+* \sa https://en.wikipedia.org/wiki/Sliding_window_protocol
+*/
+
+#pragma once
+
+#include "circqueue.h"
+
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+#if defined(__cplusplus)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wold-style-cast"
+#pragma GCC diagnostic ignored "-Wuseless-cast"
+#endif
+
+#define ROLLING_STATS_MAX_EWMA 4
+
+struct rolling_stats_config
+{
+    size_t window; // samples
+    size_t num_ewma;
+    double ewma_tau_s[ROLLING_STATS_MAX_EWMA]; // time constants (seconds)
+    size_t num_buckets;
+    double hist_lo;
+    double hist_hi;
+    bool hist_log; // logarithmic buckets (hist_lo must be positive)
+};
+
+/// an element of the min and max deques
+struct rolling_stats_entry
+{
+    uint64_t seq;
+    double value;
+};
+
+struct rolling_stats
+{
+    struct rolling_stats_config config;
+
+    circqueue window;    // double
+    circqueue min_deque; // struct rolling_stats_entry, increasing values
+    circqueue max_deque; // struct rolling_stats_entry, decreasing values
+    uint64_t seq;        // the number of samples pushed
+
+    double sum;
+    size_t pushes_since_resum;
+
+    double ewma[ROLLING_STATS_MAX_EWMA];
+    uint64_t prev_time_ns;
+
+    uint32_t* buckets;
+    double bucket_scale; // buckets per unit (of the value, or of its log)
+    double bucket_origin;
+};
+
+static void
+rolling_stats_free(struct rolling_stats* rs)
+{
+    if (rs->window.buf != nullptr)
+        circqueue_free(&rs->window);
+    if (rs->min_deque.buf != nullptr)
+        circqueue_free(&rs->min_deque);
+    if (rs->max_deque.buf != nullptr)
+        circqueue_free(&rs->max_deque);
+    free(rs->buckets);
+    rs->buckets = nullptr;
+}
+
+/// \retval 0 success
+/// \retval -1 failure (invalid config, or no memory)
+static int
+rolling_stats_init(struct rolling_stats* rs, const struct rolling_stats_config* config)
+{
+    (void)memset(rs, 0, sizeof(*rs));
+    rs->config = *config;
+
+    if (config->window == 0 || config->num_ewma > ROLLING_STATS_MAX_EWMA ||
+        config->num_buckets == 0 || !(config->hist_lo < config->hist_hi) ||
+        (config->hist_log && !(config->hist_lo > 0)))
+        return -1;
+
+    rs->window = circqueue_init(config->window, sizeof(double));
+    rs->min_deque = circqueue_init(config->window, sizeof(struct rolling_stats_entry));
+    rs->max_deque = circqueue_init(config->window, sizeof(struct rolling_stats_entry));
+    rs->buckets = (uint32_t*)calloc(config->num_buckets, sizeof(*rs->buckets));
+
+    if (rs->window.buf == nullptr || rs->min_deque.buf == nullptr ||
+        rs->max_deque.buf == nullptr || rs->buckets == nullptr)
+    {
+        rolling_stats_free(rs);
+        return -1;
+    }
+
+    if (config->hist_log)
+    {
+        rs->bucket_origin = log(config->hist_lo);
+        rs->bucket_scale = (double)config->num_buckets / (log(config->hist_hi) - rs->bucket_origin);
+    }
+    else
+    {
+        rs->bucket_origin = config->hist_lo;
+        rs->bucket_scale = (double)config->num_buckets / (config->hist_hi - config->hist_lo);
+    }
+
+    return 0;
+}
+
+/// Get the bucket of \a value (values out of range are in the first or last bucket)
+static inline size_t
+rolling_stats_bucket(const struct rolling_stats* rs, double value)
+{
+    double x = 0;
+
+    if (rs->config.hist_log)
+        x = (value > rs->config.hist_lo) ? (log(value) - rs->bucket_origin) * rs->bucket_scale : 0;
+    else
+        x = (value - rs->bucket_origin) * rs->bucket_scale;
+
+    if (!(x > 0))
+        return 0;
+    if (x >= (double)(rs->config.num_buckets - 1))
+        return rs->config.num_buckets - 1;
+    return (size_t)x;
+}
+
+/// Get the lower edge of bucket \a i
+static inline double
+rolling_stats_bucket_edge(const struct rolling_stats* rs, size_t i)
+{
+    const double x = rs->bucket_origin + (double)i / rs->bucket_scale;
+    return rs->config.hist_log ? exp(x) : x;
+}
+
+/// Add a sample taken at \a time_ns (on \c CLOCK_MONOTONIC)
+static void
+rolling_stats_push(struct rolling_stats* rs, uint64_t time_ns, double value)
+{
+    if (isnan(value))
+        return;
+
+    // {{{ EWMA
+    if (rs->seq == 0)
+    {
+        for (size_t i = 0; i < rs->config.num_ewma; ++i)
+            rs->ewma[i] = value;
+    }
+    else
+    {
+        const double dt_s = (double)(time_ns - rs->prev_time_ns) / 1E9;
+        for (size_t i = 0; i < rs->config.num_ewma; ++i)
+        {
+            const double alpha = 1 - exp(-dt_s / rs->config.ewma_tau_s[i]);
+            rs->ewma[i] += alpha * (value - rs->ewma[i]);
+        }
+    }
+    rs->prev_time_ns = time_ns;
+    // }}}
+
+    // {{{ window, sum, and histogram
+    if (circqueue_is_full(&rs->window))
+    {
+        double old_value = 0;
+        (void)circqueue_pop(&rs->window, &old_value);
+        rs->sum -= old_value;
+        --rs->buckets[rolling_stats_bucket(rs, old_value)];
+    }
+
+    (void)circqueue_push(&rs->window, &value);
+    rs->sum += value;
+    ++rs->buckets[rolling_stats_bucket(rs, value)];
+
+    // Re-add the sum once per window, so rounding errors do not accumulate.
+    if (++rs->pushes_since_resum == rs->config.window)
+    {
+        rs->pushes_since_resum = 0;
+        rs->sum = 0;
+        for (size_t i = 0; i < rs->window.num_elems; ++i)
+            rs->sum += *(const double*)circqueue_at(&rs->window, i);
+    }
+    // }}}
+
+    // {{{ monotonic deques
+    const uint64_t seq = rs->seq++;
+    const struct rolling_stats_entry entry = {seq, value};
+
+    // Remove the entries that left the window.
+    const struct rolling_stats_entry* front = nullptr;
+    while ((front = (const struct rolling_stats_entry*)circqueue_front(&rs->min_deque)) != nullptr &&
+           seq - front->seq >= rs->config.window)
+        (void)circqueue_pop(&rs->min_deque, nullptr);
+    while ((front = (const struct rolling_stats_entry*)circqueue_front(&rs->max_deque)) != nullptr &&
+           seq - front->seq >= rs->config.window)
+        (void)circqueue_pop(&rs->max_deque, nullptr);
+
+    // Remove the entries that can never be the min (or max) again.
+    const struct rolling_stats_entry* back = nullptr;
+    while ((back = (const struct rolling_stats_entry*)circqueue_back(&rs->min_deque)) != nullptr &&
+           back->value >= value)
+        (void)circqueue_pop_back(&rs->min_deque, nullptr);
+    while ((back = (const struct rolling_stats_entry*)circqueue_back(&rs->max_deque)) != nullptr &&
+           back->value <= value)
+        (void)circqueue_pop_back(&rs->max_deque, nullptr);
+
+    (void)circqueue_push(&rs->min_deque, &entry);
+    (void)circqueue_push(&rs->max_deque, &entry);
+    // }}}
+}
+
+/// the number of samples in the window
+static inline size_t
+rolling_stats_count(const struct rolling_stats* rs)
+{
+    return rs->window.num_elems;
+}
+
+/// Get the min of the window (NaN if empty)
+static inline double
+rolling_stats_min(const struct rolling_stats* rs)
+{
+    const struct rolling_stats_entry* front =
+        (const struct rolling_stats_entry*)circqueue_front(&rs->min_deque);
+    return (front != nullptr) ? front->value : NAN;
+}
+
+/// Get the max of the window (NaN if empty)
+static inline double
+rolling_stats_max(const struct rolling_stats* rs)
+{
+    const struct rolling_stats_entry* front =
+        (const struct rolling_stats_entry*)circqueue_front(&rs->max_deque);
+    return (front != nullptr) ? front->value : NAN;
+}
+
+/// Get the mean of the window (NaN if empty)
+static inline double
+rolling_stats_mean(const struct rolling_stats* rs)
+{
+    const size_t n = rolling_stats_count(rs);
+    return (n != 0) ? rs->sum / (double)n : NAN;
+}
+
+/// Get the EWMA with the time constant \c ewma_tau_s[i] (NaN if there are no samples)
+static inline double
+rolling_stats_ewma(const struct rolling_stats* rs, size_t i)
+{
+    return (rs->seq != 0 && i < rs->config.num_ewma) ? rs->ewma[i] : NAN;
+}
+
+/// Estimate the \a q quantile (within [0, 1]) of the window (NaN if empty)
+/**
+* The value is interpolated linearly within its bucket.
+*/
+static double
+rolling_stats_percentile(const struct rolling_stats* rs, double q)
+{
+    const size_t n = rolling_stats_count(rs);
+    if (n == 0)
+        return NAN;
+
+    const double min = rolling_stats_min(rs);
+    const double max = rolling_stats_max(rs);
+
+    if (!(q > 0))
+        return min;
+    if (q >= 1)
+        return max;
+
+    const double rank = q * (double)n;
+    double cumulative = 0;
+
+    for (size_t i = 0; i < rs->config.num_buckets; ++i)
+    {
+        const double count = (double)rs->buckets[i];
+        if (cumulative + count >= rank && count > 0)
+        {
+            double lo = rolling_stats_bucket_edge(rs, i);
+            double hi = rolling_stats_bucket_edge(rs, i + 1);
+            // The first and last buckets hold the values out of range.
+            if (lo < min || i == 0)
+                lo = min;
+            if (hi > max || i == rs->config.num_buckets - 1)
+                hi = max;
+            const double x = lo + (hi - lo) * ((rank - cumulative) / count);
+            return (x < min) ? min : (x > max) ? max : x;
+        }
+        cumulative += count;
+    }
+
+    return max;
+}
+
+// the min, max, mean, p50, p90, and p99
+#define ROLLING_STATS_NUM_WINDOW_VALUES 6
+
+/// the number of values written by \c rolling_stats_summary
+static inline size_t
+rolling_stats_num_summary(const struct rolling_stats* rs)
+{
+    return rs->config.num_ewma + ROLLING_STATS_NUM_WINDOW_VALUES;
+}
+
+/// Get the EWMAs, then the min, max, mean, p50, p90, and p99 of the window
+/**
+* \a values has room for \c rolling_stats_num_summary values.
+*/
+static void
+rolling_stats_summary(const struct rolling_stats* rs, double* values)
+{
+    for (size_t i = 0; i < rs->config.num_ewma; ++i)
+        *values++ = rolling_stats_ewma(rs, i);
+
+    *values++ = rolling_stats_min(rs);
+    *values++ = rolling_stats_max(rs);
+    *values++ = rolling_stats_mean(rs);
+    *values++ = rolling_stats_percentile(rs, 0.50);
+    *values++ = rolling_stats_percentile(rs, 0.90);
+    *values = rolling_stats_percentile(rs, 0.99);
+}
+
+#if defined(__cplusplus)
+#pragma GCC diagnostic pop
+#endif
+
+#if defined(__cplusplus)
+} // extern "C"
+#endif
@@ -0,0 +1,505 @@
+// SPDX-FileCopyrightText: Steven Ward
+// SPDX-License-Identifier: MPL-2.0
+
+/// Get the statistics of every network interface with one rtnetlink dump
+/**
+* \file
+* \author Steven Ward
+* One \c RTM_GETLINK dump request returns an \c RTM_NEWLINK message (with
+* \c IFLA_IFNAME and \c IFLA_STATS64) for every interface, so the counters
+* of all interfaces are read without opening a file per counter in /sys/class/net/.
+* The socket and the buffers are reused for every dump.
+* The receive buffer grows if a message would not fit in it (it is sized with \c MSG_PEEK | \c MSG_TRUNC),
+* so a dump is never silently truncated.
+* \c rtnl_link_rates measures the rates of the rx or tx counters between consecutive dumps.
+* \sa https://man7.org/linux/man-pages/man7/rtnetlink.7.html
+* \sa https://man7.org/linux/man-pages/man7/netlink.7.html
+* \sa https://docs.kernel.org/networking/statistics.html
+*/
+
+#pragma once
+
+#include "counter_rate.h"
+
+#include <err.h>
+#include <errno.h>
+#include <linux/if_link.h>
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+#include <net/if.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+#if defined(__cplusplus)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wold-style-cast"
+#pragma GCC diagnostic ignored "-Wuseless-cast"
+#endif
+
+// The initial size of the receive buffer (the kernel usually fills at most this much per recv; see NLMSG_GOODSIZE)
+#define RTNL_RECV_BUF_SIZE 32768
+
+/// The counters of a network interface
+struct rtnl_link
+{
+    int ifindex;
+    char name[IF_NAMESIZE];
+    struct rtnl_link_stats64 stats;
+};
+
+/// A netlink socket, and the links of the last dump
+struct rtnl_link_dumper
+{
+    int fd;
+    uint32_t seq;
+    char* buf;
+    size_t buf_cap;
+    struct rtnl_link* links;
+    size_t num_links;
+    size_t cap_links;
+};
+
+static void
+rtnl_link_dumper_close(struct rtnl_link_dumper* d)
+{
+    if (d->fd >= 0)
+        (void)close(d->fd);
+    d->fd = -1;
+    free(d->buf);
+    d->buf = nullptr;
+    d->buf_cap = 0;
+    free(d->links);
+    d->links = nullptr;
+    d->num_links = 0;
+    d->cap_links = 0;
+}
+
+/// Open a \c NETLINK_ROUTE socket
+/**
+* \retval 0 success
+* \retval -1 failure (a warning is printed)
+*/
+static int
+rtnl_link_dumper_open(struct rtnl_link_dumper* d)
+{
+    d->seq = 0;
+    d->buf = nullptr;
+    d->buf_cap = 0;
+    d->links = nullptr;
+    d->num_links = 0;
+    d->cap_links = 0;
+
+    d->fd = socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC, NETLINK_ROUTE);
+    if (d->fd < 0)
+    {
+        warn("socket");
+        return -1;
+    }
+
+    const struct sockaddr_nl addr = {.nl_family = AF_NETLINK, .nl_pad = 0, .nl_pid = 0, .nl_groups = 0};
+    if (bind(d->fd, (const struct sockaddr*)&addr, sizeof(addr)) < 0)
+    {
+        warn("bind");
+        rtnl_link_dumper_close(d);
+        return -1;
+    }
+
+    d->buf = (char*)malloc(RTNL_RECV_BUF_SIZE);
+    if (d->buf == nullptr)
+    {
+        warn("malloc");
+        rtnl_link_dumper_close(d);
+        return -1;
+    }
+    d->buf_cap = RTNL_RECV_BUF_SIZE;
+
+    return 0;
+}
+
+/// Parse an \c RTM_NEWLINK message, and append the link
+static int
+rtnl_link_dumper_add(struct rtnl_link_dumper* d, const struct nlmsghdr* nlh)
+{
+    if (nlh->nlmsg_len < NLMSG_LENGTH(sizeof(struct ifinfomsg)))
+        return 0;
+
+    const struct ifinfomsg* ifi = (const struct ifinfomsg*)NLMSG_DATA(nlh);
+
+    if (d->num_links == d->cap_links)
+    {
+        const size_t cap = (d->cap_links == 0) ? 16 : d->cap_links * 2;
+        struct rtnl_link* links = (struct rtnl_link*)realloc(d->links, cap * sizeof(*links));
+        if (links == nullptr)
+        {
+            warn("realloc");
+            return -1;
+        }
+        d->links = links;
+        d->cap_links = cap;
+    }
+
+    struct rtnl_link* link = &d->links[d->num_links];
+    (void)memset(link, 0, sizeof(*link));
+    link->ifindex = ifi->ifi_index;
+
+    bool has_stats = false;
+
+    const char* attr_ptr = (const char*)ifi + NLMSG_ALIGN(sizeof(*ifi));
+    size_t attrs_len = nlh->nlmsg_len - NLMSG_LENGTH(sizeof(*ifi));
+
+    while (attrs_len >= sizeof(struct rtattr))
+    {
+        const struct rtattr* rta = (const struct rtattr*)attr_ptr;
+        if (rta->rta_len < sizeof(struct rtattr) || rta->rta_len > attrs_len)
+            break;
+
+        const void* payload = attr_ptr + RTA_LENGTH(0);
+        const size_t payload_len = rta->rta_len - RTA_LENGTH(0);
+
+        switch (rta->rta_type)
+        {
+        case IFLA_IFNAME:
+            (void)memcpy(link->name, payload,
+                         (payload_len < sizeof(link->name)) ? payload_len : sizeof(link->name) - 1);
+            break;
+
+        case IFLA_STATS64:
+            // The payload is only 4-byte aligned.
+            (void)memcpy(&link->stats, payload,
+                         (payload_len < sizeof(link->stats)) ? payload_len : sizeof(link->stats));
+            has_stats = true;
+            break;
+
+        default:
+            break;
+        }
+
+        const size_t step = RTA_ALIGN(rta->rta_len);
+        if (step >= attrs_len)
+            break;
+        attr_ptr += step;
+        attrs_len -= step;
+    }
+
+    if (has_stats && link->name[0] != '\0')
+        ++d->num_links;
+
+    return 0;
+}
+
+/// Dump the links (and their statistics) of every network interface into \c d->links
+/**
+* \return the number of links, or \c -1 on failure (a warning is printed)
+*/
+static ssize_t
+rtnl_link_dump(struct rtnl_link_dumper* d)
+{
+    d->num_links = 0;
+
+    struct
+    {
+        struct nlmsghdr nlh;
+        struct ifinfomsg ifi;
+    } req;
+
+    (void)memset(&req, 0, sizeof(req));
+    req.nlh.nlmsg_len = NLMSG_LENGTH(sizeof(req.ifi));
+    req.nlh.nlmsg_type = RTM_GETLINK;
+    req.nlh.nlmsg_flags = NLM_F_REQUEST | NLM_F_DUMP;
+    req.nlh.nlmsg_seq = ++d->seq;
+    req.ifi.ifi_family = AF_UNSPEC;
+
+    if (send(d->fd, &req, req.nlh.nlmsg_len, 0) < 0)
+    {
+        warn("send");
+        return -1;
+    }
+
+    while (true)
+    {
+        // Get the size of the next message without removing it.
+        const ssize_t size = recv(d->fd, nullptr, 0, MSG_PEEK | MSG_TRUNC);
+        if (size < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            warn("recv");
+            return -1;
+        }
+
+        if ((size_t)size > d->buf_cap)
+        {
+            char* buf = (char*)realloc(d->buf, (size_t)size);
+            if (buf == nullptr)
+            {
+                warn("realloc");
+                return -1;
+            }
+            d->buf = buf;
+            d->buf_cap = (size_t)size;
+        }
+
+        // With MSG_TRUNC, the real length is returned even if the message was truncated.
+        const ssize_t n = recv(d->fd, d->buf, d->buf_cap, MSG_TRUNC);
+        if (n < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            warn("recv");
+            return -1;
+        }
+        if (n == 0)
+        {
+            warnx("recv: netlink socket closed");
+            return -1;
+        }
+        if ((size_t)n > d->buf_cap)
+        {
+            warnx("recv: netlink message truncated (%zd > %zu bytes)", n, d->buf_cap);
+            return -1;
+        }
+
+        const char* msg_ptr = d->buf;
+        size_t len = (size_t)n;
+
+        while (len >= sizeof(struct nlmsghdr))
+        {
+            const struct nlmsghdr* nlh = (const struct nlmsghdr*)msg_ptr;
+            if (nlh->nlmsg_len < sizeof(struct nlmsghdr) || nlh->nlmsg_len > len)
+                break;
+
+            // Ignore replies to older (abandoned) requests.
+            if (nlh->nlmsg_seq == d->seq)
+            {
+                if (nlh->nlmsg_type == NLMSG_DONE)
+                    return (ssize_t)d->num_links;
+
+                if (nlh->nlmsg_type == NLMSG_ERROR)
+                {
+                    const struct nlmsgerr* e = (const struct nlmsgerr*)NLMSG_DATA(nlh);
+                    errno = (nlh->nlmsg_len >= NLMSG_LENGTH(sizeof(*e))) ? -e->error : EPROTO;
+                    warn("RTM_GETLINK");
+                    return -1;
+                }
+
+                if (nlh->nlmsg_type == RTM_NEWLINK && rtnl_link_dumper_add(d, nlh) < 0)
+                    return -1;
+            }
+
+            const size_t step = NLMSG_ALIGN(nlh->nlmsg_len);
+            if (step >= len)
+                break;
+            msg_ptr += step;
+            len -= step;
+        }
+    }
+}
+
+/// Find the link with the interface index \a ifindex in \a links
+/**
+* The dump is in the order of the interface indexes, so \a hint (the position in the previous dump) is tried first.
+* \return the position of the link, or \a num_links if not found
+*/
+static inline size_t
+rtnl_link_find(const struct rtnl_link* links, size_t num_links, int ifindex, size_t hint)
+{
+    if (hint < num_links && links[hint].ifindex == ifindex)
+        return hint;
+
+    for (size_t i = 0; i < num_links; ++i)
+    {
+        if (links[i].ifindex == ifindex)
+            return i;
+    }
+
+    return num_links;
+}
+
+/// the direction of the counters of a link
+enum rtnl_link_dir
+{
+    RTNL_LINK_RX,
+    RTNL_LINK_TX,
+};
+
+// bytes, packets, errors, and dropped
+#define RTNL_LINK_NUM_RATES 4
+
+/// Get the bytes, packets, errors, and dropped counters (in the direction \a dir) of \a stats
+static inline void
+rtnl_link_counters(const struct rtnl_link_stats64* stats, enum rtnl_link_dir dir, uint64_t* counters)
+{
+    if (dir == RTNL_LINK_RX)
+    {
+        counters[0] = stats->rx_bytes;
+        counters[1] = stats->rx_packets;
+        counters[2] = stats->rx_errors;
+        counters[3] = stats->rx_dropped;
+    }
+    else
+    {
+        counters[0] = stats->tx_bytes;
+        counters[1] = stats->tx_packets;
+        counters[2] = stats->tx_errors;
+        counters[3] = stats->tx_dropped;
+    }
+}
+
+/// The rates of the links between consecutive dumps
+struct rtnl_link_rates
+{
+    struct rtnl_link_dumper dumper;
+    enum rtnl_link_dir dir;
+    bool primed;
+    uint64_t prev_time_ns;
+    struct rtnl_link* prev_links;
+    size_t num_prev_links;
+    size_t cap_prev_links;
+    char* text; // a line "NAME BYTES PACKETS ERRORS DROPPED" per selected link
+    size_t text_len;
+    size_t text_cap;
+    double sums[RTNL_LINK_NUM_RATES]; // over the selected links
+};
+
+static void
+rtnl_link_rates_close(struct rtnl_link_rates* r)
+{
+    rtnl_link_dumper_close(&r->dumper);
+    free(r->prev_links);
+    r->prev_links = nullptr;
+    r->num_prev_links = 0;
+    r->cap_prev_links = 0;
+    free(r->text);
+    r->text = nullptr;
+    r->text_len = 0;
+    r->text_cap = 0;
+}
+
+/// Open a \c NETLINK_ROUTE socket to measure the counters in the direction \a dir
+/**
+* \retval 0 success
+* \retval -1 failure (a warning is printed)
+*/
+static int
+rtnl_link_rates_open(struct rtnl_link_rates* r, enum rtnl_link_dir dir)
+{
+    (void)memset(r, 0, sizeof(*r));
+    r->dir = dir;
+    return rtnl_link_dumper_open(&r->dumper);
+}
+
+/// Dump the links, and measure the rates of the selected links since the previous dump
+/**
+* A link is selected if \a is_selected is null, or returns \c true for its name.
+* A link that was just added is measured from the next dump.
+* The measurement is in \c r->text (which has room for one more character) and \c r->sums.
+* \retval 1 success
+* \retval 0 there is no measurement yet (the first dump)
+* \retval -1 failure (a warning is printed)
+*/
+static int
+rtnl_link_rates_measure(struct rtnl_link_rates* r, uint64_t time_ns, bool (*is_selected)(const char* name))
+{
+    if (rtnl_link_dump(&r->dumper) < 0)
+        return -1;
+
+    const struct rtnl_link* links = r->dumper.links;
+    const size_t num_links = r->dumper.num_links;
+
+    // name, 4 rates, and a newline per link, and one more character
+    const size_t needed_cap = num_links * (IF_NAMESIZE + RTNL_LINK_NUM_RATES * 21 + 1) + 2;
+    if (r->text_cap < needed_cap)
+    {
+        char* text = (char*)realloc(r->text, needed_cap);
+        if (text == nullptr)
+        {
+            warn("realloc");
+            return -1;
+        }
+        r->text = text;
+        r->text_cap = needed_cap;
+    }
+
+    const bool measured = r->primed;
+
+    if (measured)
+    {
+        const uint64_t delta_time_ns = time_ns - r->prev_time_ns;
+
+        r->text_len = 0;
+        r->text[0] = '\0';
+        for (size_t k = 0; k < RTNL_LINK_NUM_RATES; ++k)
+            r->sums[k] = 0;
+
+        for (size_t i = 0; i < num_links; ++i)
+        {
+            const struct rtnl_link* link = &links[i];
+
+            if (is_selected != nullptr && !is_selected(link->name))
+                continue;
+
+            const size_t j = rtnl_link_find(r->prev_links, r->num_prev_links, link->ifindex, i);
+            if (j == r->num_prev_links)
+                continue;
+
+            uint64_t cur[RTNL_LINK_NUM_RATES];
+            uint64_t prev[RTNL_LINK_NUM_RATES];
+            rtnl_link_counters(&link->stats, r->dir, cur);
+            rtnl_link_counters(&r->prev_links[j].stats, r->dir, prev);
+
+            uintmax_t rates[RTNL_LINK_NUM_RATES];
+            for (size_t k = 0; k < RTNL_LINK_NUM_RATES; ++k)
+            {
+                rates[k] = counter_rate(cur[k], prev[k], delta_time_ns);
+                r->sums[k] += (double)rates[k];
+            }
+
+            const int line_len = snprintf(r->text + r->text_len, r->text_cap - r->text_len,
+                                          "%s %ju %ju %ju %ju\n", link->name,
+                                          rates[0], rates[1], rates[2], rates[3]);
+            if (line_len < 0 || (size_t)line_len >= r->text_cap - r->text_len)
+                break;
+            r->text_len += (size_t)line_len;
+        }
+    }
+
+    if (r->cap_prev_links < num_links)
+    {
+        struct rtnl_link* prev_links = (struct rtnl_link*)realloc(r->prev_links, num_links * sizeof(*prev_links));
+        if (prev_links == nullptr)
+        {
+            warn("realloc");
+            return -1;
+        }
+        r->prev_links = prev_links;
+        r->cap_prev_links = num_links;
+    }
+
+    if (num_links != 0)
+        (void)memcpy(r->prev_links, links, num_links * sizeof(*links));
+    r->num_prev_links = num_links;
+
+    r->prev_time_ns = time_ns;
+    r->primed = true;
+
+    return measured ? 1 : 0;
+}
+
+#if defined(__cplusplus)
+#pragma GCC diagnostic pop
+#endif
+
+#if defined(__cplusplus)
+} // extern "C"
+#endif
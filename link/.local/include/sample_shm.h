@@ -0,0 +1,369 @@
+// SPDX-FileCopyrightText: Steven Ward
+// SPDX-License-Identifier: MPL-2.0
+
+/// Shared-memory output of a sampling daemon: the latest sample and a ring of the last N samples, behind a seqlock
+/**
+* \file
+* \author Steven Ward
+* The file is mapped with \c mmap by one writer (the daemon) and any number of readers.
+* A sample is a \c CLOCK_MONOTONIC time (in nanoseconds) and a fixed number of \c double values.
+*
+* The layout (in the native byte order) is a 64-byte header and then the ring:
+* \code
+* uint64_t magic;        // SAMPLE_SHM_MAGIC (written last, so readers never see a partial header)
+* uint32_t num_values;   // values per sample
+* uint32_t capacity;     // samples in the ring
+* uint64_t seq;          // odd while the writer is writing
+* uint64_t count;        // samples written (the latest is at (count - 1) % capacity)
+* uint64_t reserved[4];
+* uint64_t ring[capacity][1 + num_values]; // time_ns, then the bits of the values
+* \endcode
+*
+* Readers do not lock and do not make syscalls: they copy what they need,
+* and retry if \c seq changed (or was odd) while copying.
+* Every word is accessed atomically, so a torn read is detected, not undefined.
+*
+* \sa https://en.wikipedia.org/wiki/Seqlock
+* \sa https://www.hpl.hp.com/techreports/2012/HPL-2012-68.pdf
+* \sa preader.h
+*/
+
+#pragma once
+
+#include <assert.h>
+#include <err.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+#if defined(__cplusplus)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wold-style-cast"
+#pragma GCC diagnostic ignored "-Wuseless-cast"
+#endif
+
+// "SAMPSHM1"
+#define SAMPLE_SHM_MAGIC UINT64_C(0x314d485350414d53)
+
+// A reader gives up after this many inconsistent copies (e.g. if the writer died while writing).
+#define SAMPLE_SHM_MAX_RETRIES 1000
+
+struct sample_shm_header
+{
+    uint64_t magic;
+    uint32_t num_values;
+    uint32_t capacity;
+    uint64_t seq;
+    uint64_t count;
+    uint64_t reserved[4];
+};
+
+static_assert(sizeof(struct sample_shm_header) == 64, "the header must be one cache line");
+
+/// A mapping of a shared-memory sample file
+/**
+* \c num_values and \c capacity are copies of the header fields (validated when the file was opened),
+* so a writer that changes the header can not make a reader index past the mapping.
+*/
+struct sample_shm
+{
+    int fd;
+    size_t size;
+    struct sample_shm_header* header;
+    uint64_t* ring;
+    size_t record_words; // 1 + num_values
+    uint32_t num_values;
+    uint32_t capacity;
+};
+
+/// Get the size (in bytes) of a file with \a num_values values per sample and \a capacity samples
+/**
+* \retval true success
+* \retval false the size does not fit in \c size_t (e.g. the header of a crafted file)
+*/
+static inline bool
+sample_shm_size(uint32_t num_values, uint32_t capacity, size_t* size)
+{
+    size_t words = 0;
+    size_t bytes = 0;
+
+    return !__builtin_mul_overflow(capacity, 1 + (uint64_t)num_values, &words) &&
+           !__builtin_mul_overflow(words, sizeof(uint64_t), &bytes) &&
+           !__builtin_add_overflow(bytes, sizeof(struct sample_shm_header), size);
+}
+
+/// Pause before a reader retries (so it does not starve the writer)
+static inline void
+sample_shm_pause()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#else
+    (void)sched_yield();
+#endif
+}
+
+static inline uint64_t
+sample_shm_double_to_word(double x)
+{
+    uint64_t w = 0;
+    (void)memcpy(&w, &x, sizeof(w));
+    return w;
+}
+
+static inline double
+sample_shm_word_to_double(uint64_t w)
+{
+    double x = 0;
+    (void)memcpy(&x, &w, sizeof(x));
+    return x;
+}
+
+static void
+sample_shm_close(struct sample_shm* shm)
+{
+    if (shm->header != nullptr)
+        (void)munmap((void*)shm->header, shm->size);
+    if (shm->fd >= 0)
+        (void)close(shm->fd);
+    shm->fd = -1;
+    shm->size = 0;
+    shm->header = nullptr;
+    shm->ring = nullptr;
+    shm->record_words = 0;
+    shm->num_values = 0;
+    shm->capacity = 0;
+}
+
+/// Create the file \a path (which must not exist) for the writer
+/**
+* \retval 0 success
+* \retval -1 failure (a warning is printed)
+*/
+static int
+sample_shm_create(struct sample_shm* shm, const char* path, uint32_t num_values, uint32_t capacity)
+{
+    shm->fd = -1;
+    shm->header = nullptr;
+    shm->size = 0;
+
+    if (num_values == 0 || capacity == 0 || !sample_shm_size(num_values, capacity, &shm->size))
+    {
+        warnx("sample_shm_create '%s': invalid size", path);
+        shm->size = 0;
+        return -1;
+    }
+
+    shm->fd = open(path, O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0o666);
+    if (shm->fd < 0)
+    {
+        warn("open '%s'", path);
+        return -1;
+    }
+
+    if (ftruncate(shm->fd, (off_t)shm->size) < 0)
+    {
+        warn("ftruncate '%s'", path);
+        sample_shm_close(shm);
+        return -1;
+    }
+
+    void* addr = mmap(nullptr, shm->size, PROT_READ | PROT_WRITE, MAP_SHARED, shm->fd, 0);
+    if (addr == MAP_FAILED)
+    {
+        warn("mmap '%s'", path);
+        sample_shm_close(shm);
+        return -1;
+    }
+
+    shm->header = (struct sample_shm_header*)addr;
+    shm->ring = (uint64_t*)(shm->header + 1);
+    shm->record_words = 1 + (size_t)num_values;
+    shm->num_values = num_values;
+    shm->capacity = capacity;
+
+    shm->header->num_values = num_values;
+    shm->header->capacity = capacity;
+    // The file is zero-filled, so seq and count are 0.
+    __atomic_store_n(&shm->header->magic, SAMPLE_SHM_MAGIC, __ATOMIC_RELEASE);
+
+    return 0;
+}
+
+/// Map the file \a path (read-only) for a reader
+/**
+* \retval 0 success
+* \retval -1 failure (a warning is printed)
+*/
+static int
+sample_shm_open(struct sample_shm* shm, const char* path)
+{
+    shm->header = nullptr;
+    shm->size = 0;
+
+    shm->fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (shm->fd < 0)
+    {
+        warn("open '%s'", path);
+        return -1;
+    }
+
+    struct stat statbuf;
+    if (fstat(shm->fd, &statbuf) < 0)
+    {
+        warn("fstat '%s'", path);
+        sample_shm_close(shm);
+        return -1;
+    }
+
+    if (statbuf.st_size < (off_t)sizeof(struct sample_shm_header))
+    {
+        warnx("'%s': not a sample file", path);
+        sample_shm_close(shm);
+        return -1;
+    }
+
+    shm->size = (size_t)statbuf.st_size;
+
+    void* addr = mmap(nullptr, shm->size, PROT_READ, MAP_SHARED, shm->fd, 0);
+    if (addr == MAP_FAILED)
+    {
+        warn("mmap '%s'", path);
+        shm->size = 0;
+        sample_shm_close(shm);
+        return -1;
+    }
+
+    shm->header = (struct sample_shm_header*)addr;
+
+    // Read the header fields once: the copies are validated and used from now on.
+    const uint64_t magic = __atomic_load_n(&shm->header->magic, __ATOMIC_ACQUIRE);
+    const uint32_t num_values = __atomic_load_n(&shm->header->num_values, __ATOMIC_RELAXED);
+    const uint32_t capacity = __atomic_load_n(&shm->header->capacity, __ATOMIC_RELAXED);
+    size_t needed_size = 0;
+
+    if (magic != SAMPLE_SHM_MAGIC || num_values == 0 || capacity == 0 ||
+        !sample_shm_size(num_values, capacity, &needed_size) || needed_size > shm->size)
+    {
+        warnx("'%s': not a sample file", path);
+        sample_shm_close(shm);
+        return -1;
+    }
+
+    shm->ring = (uint64_t*)(shm->header + 1);
+    shm->record_words = 1 + (size_t)num_values;
+    shm->num_values = num_values;
+    shm->capacity = capacity;
+
+    return 0;
+}
+
+/// Write a sample (\c num_values values) as the latest
+static void
+sample_shm_write(struct sample_shm* shm, uint64_t time_ns, const double* values)
+{
+    struct sample_shm_header* header = shm->header;
+
+    const uint64_t seq = __atomic_load_n(&header->seq, __ATOMIC_RELAXED);
+    __atomic_store_n(&header->seq, seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+
+    const uint64_t count = __atomic_load_n(&header->count, __ATOMIC_RELAXED);
+    uint64_t* record = shm->ring + (count % shm->capacity) * shm->record_words;
+
+    __atomic_store_n(&record[0], time_ns, __ATOMIC_RELAXED);
+    for (size_t i = 1; i < shm->record_words; ++i)
+    {
+        __atomic_store_n(&record[i], sample_shm_double_to_word(values[i - 1]), __ATOMIC_RELAXED);
+    }
+    __atomic_store_n(&header->count, count + 1, __ATOMIC_RELAXED);
+
+    __atomic_store_n(&header->seq, seq + 2, __ATOMIC_RELEASE);
+}
+
+/// Copy the last (at most \a n) samples, oldest first
+/**
+* \a times_ns has room for \a n times, and \a values has room for \a n * \c num_values values.
+* If \a count is not null, it is set to the number of samples written as of the copy (so the newest sample copied is the <code>*count</code>th).
+* \return the number of samples copied
+* \retval -1 no consistent copy was made (the writer might have died while writing)
+*/
+static ssize_t
+sample_shm_read_history(const struct sample_shm* shm, size_t n, uint64_t* times_ns, double* values,
+                        uint64_t* count)
+{
+    const struct sample_shm_header* header = shm->header;
+    const size_t num_values = shm->num_values;
+
+    for (int retry = 0; retry < SAMPLE_SHM_MAX_RETRIES; ++retry)
+    {
+        if (retry != 0)
+            sample_shm_pause();
+
+        const uint64_t seq0 = __atomic_load_n(&header->seq, __ATOMIC_ACQUIRE);
+        if (seq0 % 2 != 0)
+            continue;
+
+        const uint64_t cur_count = __atomic_load_n(&header->count, __ATOMIC_RELAXED);
+
+        size_t num_samples = n;
+        if (num_samples > shm->capacity)
+            num_samples = shm->capacity;
+        if (num_samples > cur_count)
+            num_samples = cur_count;
+
+        for (size_t j = 0; j < num_samples; ++j)
+        {
+            const uint64_t k = cur_count - num_samples + j;
+            const uint64_t* record = shm->ring + (k % shm->capacity) * shm->record_words;
+
+            times_ns[j] = __atomic_load_n(&record[0], __ATOMIC_RELAXED);
+            for (size_t i = 0; i < num_values; ++i)
+            {
+                values[j * num_values + i] =
+                    sample_shm_word_to_double(__atomic_load_n(&record[1 + i], __ATOMIC_RELAXED));
+            }
+        }
+
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&header->seq, __ATOMIC_RELAXED) == seq0)
+        {
+            if (count != nullptr)
+                *count = cur_count;
+            return (ssize_t)num_samples;
+        }
+    }
+
+    return -1;
+}
+
+/// Copy the latest sample
+/**
+* \a values has room for \c num_values values.
+* \retval true success
+* \retval false there is no sample yet, or no consistent copy was made
+*/
+static bool
+sample_shm_read_latest(const struct sample_shm* shm, uint64_t* time_ns, double* values)
+{
+    return sample_shm_read_history(shm, 1, time_ns, values, nullptr) == 1;
+}
+
+#if defined(__cplusplus)
+#pragma GCC diagnostic pop
+#endif
+
+#if defined(__cplusplus)
+} // extern "C"
+#endif
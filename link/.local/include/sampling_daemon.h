@@ -0,0 +1,204 @@
+// SPDX-FileCopyrightText: Steven Ward
+// SPDX-License-Identifier: MPL-2.0
+
+/// The signal handling and the output of the sampling daemons (e.g. cpuavgd)
+/**
+* \file
+* \author Steven Ward
+* SIGUSR1 and SIGUSR2 restart the deadlines of the timer (see deadline_timer.h).
+* SIGHUP, SIGINT, SIGPIPE, SIGQUIT, and SIGTERM end the daemon, which then removes its files.
+* The signals are blocked, except while waiting for the next deadline, so a measurement is never interrupted.
+* \sa deadline_timer.h
+* \sa sample_shm.h
+*/
+
+#pragma once
+
+#include <err.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+#if defined(__cplusplus)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wold-style-cast"
+#pragma GCC diagnostic ignored "-Wuseless-cast"
+#endif
+
+/// Set by a signal that ends the daemon
+static volatile sig_atomic_t sampling_daemon_done = 0;
+
+/// Set by a signal that restarts the deadlines (and initially)
+static volatile sig_atomic_t sampling_daemon_reset_timer = 1;
+
+// the files that are removed when the daemon ends
+static const char* sampling_daemon_dest_path = nullptr;
+static const char* sampling_daemon_shm_path = nullptr;
+
+static void
+sampling_daemon_signal_handler(int signum)
+{
+    switch (signum)
+    {
+    case SIGUSR1:
+    case SIGUSR2:
+        sampling_daemon_reset_timer = 1;
+        break;
+
+    default:
+        sampling_daemon_done = 1;
+        break;
+    }
+}
+
+static void
+sampling_daemon_atexit_cleanup()
+{
+    if (sampling_daemon_dest_path != nullptr && sampling_daemon_done)
+    {
+        if (remove(sampling_daemon_dest_path) < 0)
+            perror("remove");
+    }
+
+    if (sampling_daemon_shm_path != nullptr && sampling_daemon_done)
+    {
+        if (remove(sampling_daemon_shm_path) < 0)
+            perror("remove");
+    }
+}
+
+/// Remove the files \a dest_path and \a shm_path (either can be null) when a signal ends the daemon
+/**
+* \retval 0 success
+* \retval -1 failure (a warning is printed)
+*/
+static int
+sampling_daemon_remove_at_exit(const char* dest_path, const char* shm_path)
+{
+    sampling_daemon_dest_path = dest_path;
+    sampling_daemon_shm_path = shm_path;
+
+    if (atexit(sampling_daemon_atexit_cleanup) != 0)
+    {
+        warnx("atexit");
+        return -1;
+    }
+
+    return 0;
+}
+
+/// Handle the signals, and block every signal
+/**
+* \param[out] empty_mask the mask with which to wait (see \c deadline_timer_wait)
+* \param[out] orig_mask the original mask (to restore with \c sigprocmask)
+* \retval 0 success
+* \retval -1 failure (a warning is printed)
+*/
+static int
+sampling_daemon_handle_signals(sigset_t* empty_mask, sigset_t* orig_mask)
+{
+    struct sigaction signal_action;
+    (void)memset(&signal_action, 0, sizeof(signal_action));
+    signal_action.sa_flags = SA_RESTART;
+    signal_action.sa_handler = sampling_daemon_signal_handler;
+
+    if (sigfillset(&signal_action.sa_mask) < 0)
+    {
+        warn("sigfillset");
+        return -1;
+    }
+
+    const int signals_to_handle[] = {
+        SIGHUP,
+        SIGINT,
+        SIGPIPE,
+        SIGQUIT,
+        SIGTERM,
+        SIGUSR1,
+        SIGUSR2,
+    };
+
+    for (size_t i = 0; i < sizeof(signals_to_handle) / sizeof(signals_to_handle[0]); ++i)
+    {
+        if (sigaction(signals_to_handle[i], &signal_action, nullptr) < 0)
+        {
+            warn("sigaction");
+            return -1;
+        }
+    }
+
+    if (sigemptyset(empty_mask) < 0)
+    {
+        warn("sigemptyset");
+        return -1;
+    }
+
+    sigset_t full_mask;
+    if (sigfillset(&full_mask) < 0)
+    {
+        warn("sigfillset");
+        return -1;
+    }
+
+    // block everything and save current signal mask
+    if (sigprocmask(SIG_BLOCK, &full_mask, orig_mask) < 0)
+    {
+        warn("sigprocmask");
+        return -1;
+    }
+
+    return 0;
+}
+
+/// Write \a len bytes of \a buf to \a dest_fd (replacing the previous measurement), or to stdout if \a dest_fd is negative
+/**
+* \retval 0 success
+* \retval -1 failure (a warning is printed)
+*/
+static int
+sampling_daemon_write(int dest_fd, const char* buf, size_t len)
+{
+    if (dest_fd >= 0)
+    {
+        if (lseek(dest_fd, 0, SEEK_SET) < 0)
+        {
+            warn("lseek");
+            return -1;
+        }
+
+        if (write(dest_fd, buf, len) < 0)
+        {
+            warn("write");
+            return -1;
+        }
+
+        // Discard any leftover tail from a longer previous write.
+        if (ftruncate(dest_fd, (off_t)len) < 0)
+        {
+            warn("ftruncate");
+            return -1;
+        }
+    }
+    else if (fwrite(buf, 1, len, stdout) != len || fflush(stdout) == EOF)
+    {
+        warn("fwrite");
+        return -1;
+    }
+
+    return 0;
+}
+
+#if defined(__cplusplus)
+#pragma GCC diagnostic pop
+#endif
+
+#if defined(__cplusplus)
+} // extern "C"
+#endif
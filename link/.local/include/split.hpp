@@ -7,14 +7,19 @@
 * \author Steven Ward
 *
 * Note: Only \c std::string is supported.
+*
+* The overloads with a \c std::pmr::memory_resource (e.g. an \c arena) allocate the result and its strings from it.
 */
 
 #pragma once
 
 #include "ascii.hpp"
 
+#include <cstddef>
 #include <limits>
+#include <memory_resource>
 #include <string>
+#include <string_view>
 #include <vector>
 
 /*
@@ -26,50 +31,43 @@
 *   s.substr(i, j - i) == std::string(s.begin() + i, s.begin() + j)
 */
 
+namespace split_detail
+{
+
 /// split the string about the delimiter character
-/**
-* If \a limit is greater than \c 0, the result will have no more than \a limit strings.
-*/
-std::vector<std::string>
-split(const std::string& s, const char delim, const size_t limit = 0)
+template <typename Vector>
+void
+split(Vector& result, const std::string_view s, const char delim, const size_t limit)
 {
     const auto begin = s.cbegin();
     const auto end = s.cend();
-    using diff_t = std::string::difference_type;
-    std::string::size_type i = 0; // index of the front of a substring
-    std::string::size_type j = 0; // index of the back of a substring
-    std::vector<std::string> result;
+    using diff_t = std::string_view::difference_type;
+    std::string_view::size_type i = 0; // index of the front of a substring
+    std::string_view::size_type j = 0; // index of the back of a substring
 
-    while ((result.size() != limit - 1) && ((j = s.find(delim, i)) != std::string::npos))
+    while ((result.size() != limit - 1) && ((j = s.find(delim, i)) != std::string_view::npos))
     {
         result.emplace_back(begin + static_cast<diff_t>(i), begin + static_cast<diff_t>(j));
         i = j + 1;
     }
 
     result.emplace_back(begin + static_cast<diff_t>(i), end);
-
-    return result;
 }
 
 /// split the string about the delimiter string
-/**
-* If \a limit is greater than \c 0, the result will have no more than \a limit strings.
-*
-* If \a delim is empty, the result is a vector with \a s as its only element.
-*/
-std::vector<std::string>
-split(const std::string& s, const std::string& delim, const size_t limit = 0)
+template <typename Vector>
+void
+split(Vector& result, const std::string_view s, const std::string_view delim, const size_t limit)
 {
     const auto begin = s.cbegin();
     const auto end = s.cend();
-    using diff_t = std::string::difference_type;
-    std::string::size_type i = 0; // index of the front of a substring
-    std::string::size_type j = 0; // index of the back of a substring
-    std::vector<std::string> result;
+    using diff_t = std::string_view::difference_type;
+    std::string_view::size_type i = 0; // index of the front of a substring
+    std::string_view::size_type j = 0; // index of the back of a substring
 
     if (!delim.empty())
     {
-        while ((result.size() != limit - 1) && ((j = s.find(delim, i)) != std::string::npos))
+        while ((result.size() != limit - 1) && ((j = s.find(delim, i)) != std::string_view::npos))
         {
             result.emplace_back(begin + static_cast<diff_t>(i),
                                 begin + static_cast<diff_t>(j));
@@ -78,38 +76,31 @@ split(const std::string& s, const std::string& delim, const size_t limit = 0)
     }
 
     result.emplace_back(begin + static_cast<diff_t>(i), end);
-
-    return result;
 }
 
 /// split the string about characters in the delimiter set
-/**
-* If \a limit is greater than \c 0, the result will have no more than \a limit strings.
-*
-* If \a delim_set is empty, the result is a vector with \a s as its only element.
-*/
-std::vector<std::string>
-split_set(const std::string& s, const std::string& delim_set, const size_t limit = 0)
+template <typename Vector>
+void
+split_set(Vector& result, const std::string_view s, const std::string_view delim_set, const size_t limit)
 {
     const auto begin = s.cbegin();
     const auto end = s.cend();
-    using diff_t = std::string::difference_type;
-    std::string::size_type i = 0; // index of the front of a substring
-    std::string::size_type j = 0; // index of the back of a substring
-    std::vector<std::string> result;
+    using diff_t = std::string_view::difference_type;
+    std::string_view::size_type i = 0; // index of the front of a substring
+    std::string_view::size_type j = 0; // index of the back of a substring
 
     if (!delim_set.empty())
     {
-        while (((i = s.find_first_not_of(delim_set, j)) != std::string::npos) &&
+        while (((i = s.find_first_not_of(delim_set, j)) != std::string_view::npos) &&
                (result.size() != limit - 1) &&
-               ((j = s.find_first_of(delim_set, i)) != std::string::npos))
+               ((j = s.find_first_of(delim_set, i)) != std::string_view::npos))
         {
             result.emplace_back(begin + static_cast<diff_t>(i),
                                 begin + static_cast<diff_t>(j));
         }
     }
 
-    if (i != std::string::npos)
+    if (i != std::string_view::npos)
     {
         result.emplace_back(begin + static_cast<diff_t>(i), end);
     }
@@ -117,38 +108,31 @@ split_set(const std::string& s, const std::string& delim_set, const size_t limit
     {
         result.emplace_back();
     }
-
-    return result;
 }
 
 /// split the string about characters not in the delimiter set
-/**
-* If \a limit is greater than \c 0, the result will have no more than \a limit strings.
-*
-* If \a delim_set is empty, the result is a vector with \a s as its only element.
-*/
-std::vector<std::string>
-split_non_set(const std::string& s, const std::string& delim_set, const size_t limit = 0)
+template <typename Vector>
+void
+split_non_set(Vector& result, const std::string_view s, const std::string_view delim_set, const size_t limit)
 {
     const auto begin = s.cbegin();
     const auto end = s.cend();
-    using diff_t = std::string::difference_type;
-    std::string::size_type i = 0; // index of the front of a substring
-    std::string::size_type j = 0; // index of the back of a substring
-    std::vector<std::string> result;
+    using diff_t = std::string_view::difference_type;
+    std::string_view::size_type i = 0; // index of the front of a substring
+    std::string_view::size_type j = 0; // index of the back of a substring
 
     if (!delim_set.empty())
     {
-        while (((i = s.find_first_of(delim_set, j)) != std::string::npos) &&
+        while (((i = s.find_first_of(delim_set, j)) != std::string_view::npos) &&
                (result.size() != limit - 1) &&
-               ((j = s.find_first_not_of(delim_set, i)) != std::string::npos))
+               ((j = s.find_first_not_of(delim_set, i)) != std::string_view::npos))
         {
             result.emplace_back(begin + static_cast<diff_t>(i),
                                 begin + static_cast<diff_t>(j));
         }
     }
 
-    if (i != std::string::npos)
+    if (i != std::string_view::npos)
     {
         result.emplace_back(begin + static_cast<diff_t>(i), end);
     }
@@ -156,7 +140,97 @@ split_non_set(const std::string& s, const std::string& delim_set, const size_t l
     {
         result.emplace_back();
     }
+}
+
+}
+
+/// split the string about the delimiter character
+/**
+* If \a limit is greater than \c 0, the result will have no more than \a limit strings.
+*/
+std::vector<std::string>
+split(const std::string& s, const char delim, const size_t limit = 0)
+{
+    std::vector<std::string> result;
+    split_detail::split(result, s, delim, limit);
+    return result;
+}
 
+/// split the string about the delimiter character
+std::pmr::vector<std::pmr::string>
+split(const std::string_view s, const char delim, const size_t limit, std::pmr::memory_resource* const mr)
+{
+    std::pmr::vector<std::pmr::string> result(mr);
+    split_detail::split(result, s, delim, limit);
+    return result;
+}
+
+/// split the string about the delimiter string
+/**
+* If \a limit is greater than \c 0, the result will have no more than \a limit strings.
+*
+* If \a delim is empty, the result is a vector with \a s as its only element.
+*/
+std::vector<std::string>
+split(const std::string& s, const std::string& delim, const size_t limit = 0)
+{
+    std::vector<std::string> result;
+    split_detail::split(result, s, std::string_view{delim}, limit);
+    return result;
+}
+
+/// split the string about the delimiter string
+std::pmr::vector<std::pmr::string>
+split(const std::string_view s, const std::string_view delim, const size_t limit, std::pmr::memory_resource* const mr)
+{
+    std::pmr::vector<std::pmr::string> result(mr);
+    split_detail::split(result, s, delim, limit);
+    return result;
+}
+
+/// split the string about characters in the delimiter set
+/**
+* If \a limit is greater than \c 0, the result will have no more than \a limit strings.
+*
+* If \a delim_set is empty, the result is a vector with \a s as its only element.
+*/
+std::vector<std::string>
+split_set(const std::string& s, const std::string& delim_set, const size_t limit = 0)
+{
+    std::vector<std::string> result;
+    split_detail::split_set(result, s, delim_set, limit);
+    return result;
+}
+
+/// split the string about characters in the delimiter set
+std::pmr::vector<std::pmr::string>
+split_set(const std::string_view s, const std::string_view delim_set, const size_t limit, std::pmr::memory_resource* const mr)
+{
+    std::pmr::vector<std::pmr::string> result(mr);
+    split_detail::split_set(result, s, delim_set, limit);
+    return result;
+}
+
+/// split the string about characters not in the delimiter set
+/**
+* If \a limit is greater than \c 0, the result will have no more than \a limit strings.
+*
+* If \a delim_set is empty, the result is a vector with \a s as its only element.
+*/
+std::vector<std::string>
+split_non_set(const std::string& s, const std::string& delim_set, const size_t limit = 0)
+{
+    std::vector<std::string> result;
+    split_detail::split_non_set(result, s, delim_set, limit);
+    return result;
+}
+
+/// split the string about characters not in the delimiter set
+std::pmr::vector<std::pmr::string>
+split_non_set(const std::string_view s, const std::string_view delim_set, const size_t limit, std::pmr::memory_resource* const mr)
+{
+    std::pmr::vector<std::pmr::string> result(mr);
+    split_detail::split_non_set(result, s, delim_set, limit);
     return result;
 }
 
@@ -166,3 +240,10 @@ split(const std::string& s)
 {
     return split_set(s, ascii_whitespace_s);
 }
+
+/// split the string about ASCII whitespace characters
+std::pmr::vector<std::pmr::string>
+split(const std::string_view s, std::pmr::memory_resource* const mr)
+{
+    return split_set(s, ascii_whitespace_sv, 0, mr);
+}
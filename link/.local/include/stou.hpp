@@ -7,17 +7,40 @@
 * \author Steven Ward
 * \sa https://en.cppreference.com/w/cpp/string/basic_string/stoul
 * \sa https://en.cppreference.com/w/cpp/string/basic_string/stol
+* \sa parse_int.h
 */
 
 #pragma once
 
+#include "parse_int.h"
+
+#include <cerrno>
+#include <cstdint>
 #include <limits>
+#include <stdexcept>
 #include <string>
 
 unsigned int
 stou(const std::string& s, std::size_t* pos = nullptr, int base = 10)
 {
-    const unsigned long i = std::stoul(s, pos, base);
+    const char* const first = s.c_str();
+    const char* end = first;
+    uintmax_t i = 0;
+
+    // Like std::stoul, a negative base is invalid.
+    const int result = (base < 0) ? EINVAL :
+                       parse_umax(first, first + std::size(s), static_cast<unsigned int>(base),
+                                  &i, &end);
+
+    if (result == EINVAL)
+        throw std::invalid_argument("stou");
+
+    if (result == ERANGE)
+        throw std::out_of_range("stou");
+
+    if (pos != nullptr)
+        *pos = static_cast<std::size_t>(end - first);
+
     return (i > std::numeric_limits<unsigned int>::max()) ?
                std::numeric_limits<unsigned int>::max() :
                static_cast<unsigned int>(i);
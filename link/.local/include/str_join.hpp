@@ -5,22 +5,34 @@
 /**
 * \file
 * \author Steven Ward
+* If the range is a forward range, the length of the result is computed first, so the result is allocated once.
+* The \c str_join_to functions write into an output iterator, a fixed buffer, or a file descriptor, so the result is never allocated.
 */
 
 #pragma once
 
+#include "iov_writer.hpp"
+
+#include <algorithm>
 #include <concepts>
+#include <cstddef>
+#include <cstring>
+#include <iterator>
 #include <ranges>
+#include <span>
 #include <string>
 #include <string_view>
+#include <type_traits>
+
+namespace str_join_detail
+{
 
+/// Call \a f for each string of \a range_strings and each \a joiner between them
 template <std::ranges::input_range R>
 requires std::convertible_to<std::ranges::range_reference_t<R>, std::string_view>
-[[nodiscard]] static std::string
-str_join(R&& range_strings, std::string_view joiner)
+void
+for_each_piece(R&& range_strings, const std::string_view joiner, auto&& f)
 {
-    std::string result;
-
     bool first = true;
 
     for (std::string_view s : std::forward<R>(range_strings))
@@ -31,10 +43,100 @@ str_join(R&& range_strings, std::string_view joiner)
         }
         else
         {
-            result += joiner;
+            f(joiner);
         }
-        result += s;
+        f(s);
+    }
+}
+
+}
+
+template <std::ranges::input_range R>
+requires std::convertible_to<std::ranges::range_reference_t<R>, std::string_view>
+[[nodiscard]] static std::string
+str_join(R&& range_strings, std::string_view joiner)
+{
+    using namespace str_join_detail;
+
+    std::string result;
+
+    if constexpr (std::ranges::forward_range<R>)
+    {
+        size_t size = 0;
+        for_each_piece(range_strings, joiner, [&](const std::string_view piece) { size += std::size(piece); });
+
+        result.resize_and_overwrite(size, [&](char* p, const size_t n)
+        {
+            for_each_piece(range_strings, joiner, [&](const std::string_view piece)
+            {
+                (void)std::memcpy(p, std::data(piece), std::size(piece));
+                p += std::size(piece);
+            });
+            return n;
+        });
+    }
+    else
+    {
+        for_each_piece(std::forward<R>(range_strings), joiner,
+                       [&](const std::string_view piece) { result += piece; });
     }
 
     return result;
 }
+
+/// Join the strings into the output iterator \a out
+/**
+* \return the output iterator one past the last character written
+*/
+template <std::output_iterator<char> Out, std::ranges::input_range R>
+requires std::convertible_to<std::ranges::range_reference_t<R>, std::string_view>
+static Out
+str_join_to(Out out, R&& range_strings, std::string_view joiner)
+{
+    str_join_detail::for_each_piece(std::forward<R>(range_strings), joiner,
+        [&](const std::string_view piece) { out = std::ranges::copy(piece, out).out; });
+
+    return out;
+}
+
+/// Join the strings into the buffer \a buf
+/**
+* Like \c snprintf, the result is truncated if \a buf is too small (but it is not null-terminated).
+* \return the length of the joined strings (which is greater than <code>std::size(buf)</code> if the result was truncated)
+*/
+template <std::ranges::input_range R>
+requires std::convertible_to<std::ranges::range_reference_t<R>, std::string_view>
+static size_t
+str_join_to(const std::span<char> buf, R&& range_strings, std::string_view joiner)
+{
+    size_t size = 0;
+
+    str_join_detail::for_each_piece(std::forward<R>(range_strings), joiner,
+        [&](const std::string_view piece)
+        {
+            if (size < std::size(buf))
+                (void)std::memcpy(std::data(buf) + size, std::data(piece),
+                                  std::min(std::size(piece), std::size(buf) - size));
+            size += std::size(piece);
+        });
+
+    return size;
+}
+
+/// Join the strings and write them to the file descriptor \a fd with \c writev
+/**
+* The strings are not copied, so the elements of the range must not be temporaries.
+* \throw std::system_error if \c writev(2) fails
+*/
+template <std::ranges::forward_range R>
+requires std::convertible_to<std::ranges::range_reference_t<R>, std::string_view> &&
+         (std::is_lvalue_reference_v<std::ranges::range_reference_t<R>> ||
+          std::same_as<std::ranges::range_value_t<R>, std::string_view>)
+static void
+str_join_to(const int fd, R&& range_strings, std::string_view joiner)
+{
+    iov_writer writer{fd};
+    str_join_detail::for_each_piece(std::forward<R>(range_strings), joiner,
+                                    [&](const std::string_view piece) { writer.add(piece); });
+    writer.flush();
+}
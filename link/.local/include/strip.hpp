@@ -10,6 +10,9 @@
 *
 * The \c strip() functions use \c std::string member functions to find delimiters.
 * The \c trim() functions use <code><algorithm></code> functions to find delimiters.
+*
+* The \c strip_view() functions return a view into the string, so they do not allocate.
+* The \c strip_copy() overloads with a \c std::pmr::memory_resource (e.g. an \c arena) allocate the result from it.
 */
 
 #pragma once
@@ -19,7 +22,9 @@
 
 #include <algorithm>
 #include <functional>
+#include <memory_resource>
 #include <string>
+#include <string_view>
 
 // {{{ strip a character from a std::string
 
@@ -202,3 +207,139 @@ strip_copy(std::string s)
 }
 
 // }}}
+
+// {{{ strip a std::string_view without allocating
+
+[[nodiscard]] std::string_view
+rstrip_view(const std::string_view s, const char delim)
+{
+    return s.substr(0, s.find_last_not_of(delim) + 1);
+}
+
+[[nodiscard]] std::string_view
+lstrip_view(const std::string_view s, const char delim)
+{
+    return s.substr(std::min(s.find_first_not_of(delim), s.size()));
+}
+
+[[nodiscard]] std::string_view
+rstrip_view(const std::string_view s, const std::string_view delim_set)
+{
+    return s.substr(0, s.find_last_not_of(delim_set) + 1);
+}
+
+[[nodiscard]] std::string_view
+lstrip_view(const std::string_view s, const std::string_view delim_set)
+{
+    return s.substr(std::min(s.find_first_not_of(delim_set), s.size()));
+}
+
+[[nodiscard]] std::string_view
+rstrip_view(const std::string_view s, const unary_predicate_wrapper<char>& pred)
+{
+    return {s.begin(), std::find_if_not(s.rbegin(), s.rend(), pred).base()};
+}
+
+[[nodiscard]] std::string_view
+lstrip_view(const std::string_view s, const unary_predicate_wrapper<char>& pred)
+{
+    return {std::find_if_not(s.begin(), s.end(), pred), s.end()};
+}
+
+[[nodiscard]] std::string_view
+rstrip_view(const std::string_view s)
+{
+    return rstrip_view(s, is_whitespace_pred);
+}
+
+[[nodiscard]] std::string_view
+lstrip_view(const std::string_view s)
+{
+    return lstrip_view(s, is_whitespace_pred);
+}
+
+template <typename... Delim>
+requires (sizeof...(Delim) <= 1)
+[[nodiscard]] std::string_view
+strip_view(const std::string_view s, const Delim&... delim)
+{
+    return lstrip_view(rstrip_view(s, delim...), delim...);
+}
+
+// }}}
+
+// {{{ strip a std::string_view into a string allocated from a memory resource
+
+std::pmr::string
+rstrip_copy(const std::string_view s, const char delim, std::pmr::memory_resource* const mr)
+{
+    return std::pmr::string(rstrip_view(s, delim), mr);
+}
+
+std::pmr::string
+lstrip_copy(const std::string_view s, const char delim, std::pmr::memory_resource* const mr)
+{
+    return std::pmr::string(lstrip_view(s, delim), mr);
+}
+
+std::pmr::string
+strip_copy(const std::string_view s, const char delim, std::pmr::memory_resource* const mr)
+{
+    return std::pmr::string(strip_view(s, delim), mr);
+}
+
+std::pmr::string
+rstrip_copy(const std::string_view s, const std::string_view delim_set, std::pmr::memory_resource* const mr)
+{
+    return std::pmr::string(rstrip_view(s, delim_set), mr);
+}
+
+std::pmr::string
+lstrip_copy(const std::string_view s, const std::string_view delim_set, std::pmr::memory_resource* const mr)
+{
+    return std::pmr::string(lstrip_view(s, delim_set), mr);
+}
+
+std::pmr::string
+strip_copy(const std::string_view s, const std::string_view delim_set, std::pmr::memory_resource* const mr)
+{
+    return std::pmr::string(strip_view(s, delim_set), mr);
+}
+
+std::pmr::string
+rstrip_copy(const std::string_view s, const unary_predicate_wrapper<char>& pred, std::pmr::memory_resource* const mr)
+{
+    return std::pmr::string(rstrip_view(s, pred), mr);
+}
+
+std::pmr::string
+lstrip_copy(const std::string_view s, const unary_predicate_wrapper<char>& pred, std::pmr::memory_resource* const mr)
+{
+    return std::pmr::string(lstrip_view(s, pred), mr);
+}
+
+std::pmr::string
+strip_copy(const std::string_view s, const unary_predicate_wrapper<char>& pred, std::pmr::memory_resource* const mr)
+{
+    return std::pmr::string(strip_view(s, pred), mr);
+}
+
+std::pmr::string
+rstrip_copy(const std::string_view s, std::pmr::memory_resource* const mr)
+{
+    return std::pmr::string(rstrip_view(s), mr);
+}
+
+std::pmr::string
+lstrip_copy(const std::string_view s, std::pmr::memory_resource* const mr)
+{
+    return std::pmr::string(lstrip_view(s), mr);
+}
+
+std::pmr::string
+strip_copy(const std::string_view s, std::pmr::memory_resource* const mr)
+{
+    return std::pmr::string(strip_view(s), mr);
+}
+
+// }}}
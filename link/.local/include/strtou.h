@@ -6,12 +6,16 @@
 * \file
 * \author Steven Ward
 * \sa https://en.cppreference.com/w/c/string/byte/strtoul
+* \sa parse_int.h
 */
 
 #pragma once
 
+#include "parse_int.h"
+
 #include <limits.h>
-#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
 
 #if defined(__cplusplus)
 extern "C" {
@@ -20,7 +24,8 @@ extern "C" {
 static unsigned int
 strtou(const char* s)
 {
-    const unsigned long i = strtoul(s, nullptr, 0);
+    uintmax_t i = 0;
+    (void)parse_umax(s, s + strlen(s), 0, &i, nullptr);
     return (i > UINT_MAX) ? UINT_MAX : (unsigned int)i;
 }
 
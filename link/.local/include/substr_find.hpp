@@ -0,0 +1,112 @@
+// SPDX-FileCopyrightText: Steven Ward
+// SPDX-License-Identifier: MPL-2.0
+
+/// Find a substring within a string
+/**
+* \file
+* \author Steven Ward
+* Candidate positions are found by comparing the first and last characters of the needle with a block of the haystack at once.
+* Only the candidates are compared with \c memcmp.
+* \sa http://0x80.pl/articles/simd-strfind.html
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+/// Find the first occurrence of \a needle in \a haystack at or after \a pos
+/**
+* This is like <code>std::string_view::find</code>.
+* \return the position of the first occurrence, or \c std::string_view::npos if there is none
+*/
+[[nodiscard]] static size_t
+substr_find(const std::string_view haystack,
+            const std::string_view needle,
+            size_t pos = 0) noexcept
+{
+    const size_t n = std::size(needle);
+    const size_t size = std::size(haystack);
+
+    if (pos > size || n > size - pos)
+        return std::string_view::npos;
+
+    if (n == 0)
+        return pos;
+
+    const char* const data = std::data(haystack);
+
+    if (n == 1)
+    {
+        const auto* const found = static_cast<const char*>(
+            std::memchr(data + pos, needle[0], size - pos));
+        return found != nullptr ? static_cast<size_t>(found - data) : std::string_view::npos;
+    }
+
+    // Called for every candidate position i
+    const auto matches = [&](const size_t i)
+    {
+        // The first and last characters already match.
+        return std::memcmp(data + i + 1, std::data(needle) + 1, n - 2) == 0;
+    };
+
+#if defined(__AVX2__)
+    {
+        const __m256i first = _mm256_set1_epi8(needle.front());
+        const __m256i last = _mm256_set1_epi8(needle.back());
+
+        for (; pos + n - 1 + sizeof(__m256i) <= size; pos += sizeof(__m256i))
+        {
+            const __m256i block_first = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + pos));
+            const __m256i block_last = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + pos + n - 1));
+            auto mask = static_cast<uint32_t>(_mm256_movemask_epi8(
+                _mm256_and_si256(_mm256_cmpeq_epi8(block_first, first),
+                                 _mm256_cmpeq_epi8(block_last, last))));
+
+            for (; mask != 0; mask &= mask - 1)
+            {
+                const size_t i = pos + static_cast<size_t>(__builtin_ctz(mask));
+                if (matches(i))
+                    return i;
+            }
+        }
+    }
+#endif
+
+#if defined(__SSE2__)
+    {
+        const __m128i first = _mm_set1_epi8(needle.front());
+        const __m128i last = _mm_set1_epi8(needle.back());
+
+        for (; pos + n - 1 + sizeof(__m128i) <= size; pos += sizeof(__m128i))
+        {
+            const __m128i block_first = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + pos));
+            const __m128i block_last = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + pos + n - 1));
+            auto mask = static_cast<uint32_t>(_mm_movemask_epi8(
+                _mm_and_si128(_mm_cmpeq_epi8(block_first, first),
+                              _mm_cmpeq_epi8(block_last, last))));
+
+            for (; mask != 0; mask &= mask - 1)
+            {
+                const size_t i = pos + static_cast<size_t>(__builtin_ctz(mask));
+                if (matches(i))
+                    return i;
+            }
+        }
+    }
+#endif
+
+    for (; pos + n <= size; ++pos)
+    {
+        if (data[pos] == needle.front() && data[pos + n - 1] == needle.back() && matches(pos))
+            return pos;
+    }
+
+    return std::string_view::npos;
+}
@@ -5,22 +5,117 @@
 /**
 * \file
 * \author Steven Ward
+* The string is compacted in place in a single pass, so each character is moved at most once.
+* \sa substr_find.hpp
+* \sa substr_replace.hpp
 */
 
 #pragma once
 
+#include "substr_find.hpp"
+
+#include <cstddef>
+#include <cstring>
+#include <initializer_list>
+#include <span>
 #include <string>
+#include <string_view>
+#include <vector>
 
 /// remove all occurrences of \a sub from \a s
+/**
+* The occurrences are found from left to right, and they do not overlap.
+* \pre \a sub does not refer to the contents of \a s
+*/
 void
-substr_remove(std::string& s, const std::string& sub)
+substr_remove(std::string& s, const std::string_view sub)
 {
     if (s.empty() || sub.empty())
         return;
 
-    std::string::size_type loc = 0;
-    while ((loc = s.find(sub, loc)) != std::string::npos)
+    size_t write = substr_find(s, sub);
+    if (write == std::string::npos)
+        return;
+
+    size_t read = write + std::size(sub);
+
+    for (size_t loc = 0; (loc = substr_find(s, sub, read)) != std::string::npos;
+         read = loc + std::size(sub))
     {
-        s.erase(loc, sub.size());
+        (void)std::memmove(s.data() + write, s.data() + read, loc - read);
+        write += loc - read;
     }
+
+    (void)std::memmove(s.data() + write, s.data() + read, std::size(s) - read);
+    s.resize(write + std::size(s) - read);
+}
+
+/// remove all occurrences of every substring of \a subs from \a s in one pass
+/**
+* At each position, the longest substring that occurs there is removed.
+* \pre no substring of \a subs refers to the contents of \a s
+*/
+void
+substr_remove(std::string& s, const std::span<const std::string_view> subs)
+{
+    if (s.empty())
+        return;
+
+    // the position of the next occurrence of each substring
+    std::vector<size_t> next(std::size(subs), std::string::npos);
+
+    for (size_t j = 0; j < std::size(subs); ++j)
+    {
+        if (!subs[j].empty())
+            next[j] = substr_find(s, subs[j]);
+    }
+
+    size_t write = 0;
+    size_t read = 0;
+
+    while (true)
+    {
+        // Find the earliest (then the longest) occurrence.
+        size_t best = std::size(subs);
+        for (size_t j = 0; j < std::size(subs); ++j)
+        {
+            if (next[j] == std::string::npos)
+                continue;
+
+            if (best == std::size(subs) || next[j] < next[best] ||
+                (next[j] == next[best] && std::size(subs[j]) > std::size(subs[best])))
+            {
+                best = j;
+            }
+        }
+
+        if (best == std::size(subs))
+            break;
+
+        const size_t loc = next[best];
+        if (write != read)
+            (void)std::memmove(s.data() + write, s.data() + read, loc - read);
+        write += loc - read;
+        read = loc + std::size(subs[best]);
+
+        // Occurrences that overlap the removed substring are skipped.
+        for (size_t j = 0; j < std::size(subs); ++j)
+        {
+            if (next[j] != std::string::npos && next[j] < read)
+                next[j] = substr_find(s, subs[j], read);
+        }
+    }
+
+    if (write == read)
+        return;
+
+    (void)std::memmove(s.data() + write, s.data() + read, std::size(s) - read);
+    s.resize(write + std::size(s) - read);
+}
+
+/// remove all occurrences of every substring of \a subs from \a s in one pass
+void
+substr_remove(std::string& s, const std::initializer_list<std::string_view> subs)
+{
+    substr_remove(s, std::span(subs.begin(), subs.size()));
 }
@@ -0,0 +1,76 @@
+// SPDX-FileCopyrightText: Steven Ward
+// SPDX-License-Identifier: MPL-2.0
+
+/// Replace all occurrences of a substring within a string
+/**
+* \file
+* \author Steven Ward
+* If the replacement is not longer than the substring, the string is compacted in place in a single pass.
+* Otherwise, the result is built in a string that is allocated once.
+* \sa substr_find.hpp
+* \sa substr_remove.hpp
+*/
+
+#pragma once
+
+#include "substr_find.hpp"
+
+#include <cstddef>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <utility>
+
+/// replace all occurrences of \a sub in \a s with \a rep
+/**
+* The occurrences are found from left to right, and they do not overlap.
+* \pre neither \a sub nor \a rep refers to the contents of \a s
+*/
+void
+substr_replace(std::string& s, const std::string_view sub, const std::string_view rep)
+{
+    if (s.empty() || sub.empty())
+        return;
+
+    size_t loc = substr_find(s, sub);
+    if (loc == std::string::npos)
+        return;
+
+    if (std::size(rep) <= std::size(sub))
+    {
+        size_t write = loc;
+        size_t read = loc;
+
+        do
+        {
+            (void)std::memmove(s.data() + write, s.data() + read, loc - read);
+            write += loc - read;
+            (void)std::memcpy(s.data() + write, std::data(rep), std::size(rep));
+            write += std::size(rep);
+            read = loc + std::size(sub);
+        }
+        while ((loc = substr_find(s, sub, read)) != std::string::npos);
+
+        (void)std::memmove(s.data() + write, s.data() + read, std::size(s) - read);
+        s.resize(write + std::size(s) - read);
+        return;
+    }
+
+    // Count the occurrences to allocate the result once.
+    size_t count = 0;
+    for (size_t i = loc; i != std::string::npos; i = substr_find(s, sub, i + std::size(sub)))
+        ++count;
+
+    std::string result;
+    result.reserve(std::size(s) + count * (std::size(rep) - std::size(sub)));
+
+    size_t read = 0;
+    for (; loc != std::string::npos; loc = substr_find(s, sub, read))
+    {
+        (void)result.append(s, read, loc - read).append(rep);
+        read = loc + std::size(sub);
+    }
+
+    (void)result.append(s, read);
+    s = std::move(result);
+}
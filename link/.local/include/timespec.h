@@ -30,6 +30,28 @@ timespec_to_sec(const struct timespec* ts)
     return (double)ts->tv_sec + copysign((double)ts->tv_nsec, (double)ts->tv_sec) / 1E9;
 }
 
+static struct timespec
+msec_to_timespec(unsigned int msec)
+{
+    return (struct timespec){
+        .tv_sec = msec / 1000U,
+        .tv_nsec = (msec % 1000U) * 1'000'000L,
+    };
+}
+
+// https://cgit.freedesktop.org/libbsd/tree/include/bsd/sys/time.h#n82
+static void
+timespecadd(const struct timespec* t0, const struct timespec* t1, struct timespec* sum)
+{
+    sum->tv_sec = t0->tv_sec + t1->tv_sec;
+    sum->tv_nsec = t0->tv_nsec + t1->tv_nsec;
+    if (sum->tv_nsec >= 1'000'000'000L)
+    {
+        sum->tv_sec++;
+        sum->tv_nsec -= 1'000'000'000L;
+    }
+}
+
 // https://cgit.freedesktop.org/libbsd/tree/include/bsd/sys/time.h#n92
 static void
 timespecsub(const struct timespec* t1, const struct timespec* t0, struct timespec* diff)
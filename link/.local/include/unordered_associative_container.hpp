@@ -5,6 +5,8 @@
 /**
 * \file
 * \author Steven Ward
+* A type derived from a standard unordered container satisfies the concept,
+* as does a type with the same interface (e.g. \c flat_hash_map).
 * \sa https://en.cppreference.com/w/cpp/named_req/UnorderedAssociativeContainer
 * \sa https://eel.is/c++draft/unord.req
 */
@@ -12,9 +14,46 @@
 #pragma once
 
 #include <concepts>
+#include <cstddef>
 #include <unordered_map>
 #include <unordered_set>
 
+namespace unordered_associative_container_detail
+{
+
+/// the interface of an Unordered Associative Container (that is not derived from a standard one)
+template <typename Container>
+concept unordered_associative_interface =
+    std::forward_iterator<typename Container::iterator> &&
+    std::forward_iterator<typename Container::const_iterator> &&
+    requires (Container c, const Container cc, const typename Container::key_type& key,
+              const typename Container::value_type& value, typename Container::size_type n)
+    {
+        typename Container::hasher;
+        typename Container::key_equal;
+        { cc.hash_function() } -> std::same_as<typename Container::hasher>;
+        { cc.key_eq() } -> std::same_as<typename Container::key_equal>;
+        { c.insert(value) };
+        { c.erase(key) } -> std::same_as<typename Container::size_type>;
+        { c.find(key) } -> std::same_as<typename Container::iterator>;
+        { cc.find(key) } -> std::same_as<typename Container::const_iterator>;
+        { cc.count(key) } -> std::same_as<typename Container::size_type>;
+        { cc.contains(key) } -> std::same_as<bool>;
+        { c.equal_range(key) };
+        { cc.bucket_count() } -> std::same_as<typename Container::size_type>;
+        { cc.load_factor() } -> std::same_as<float>;
+        { cc.max_load_factor() } -> std::same_as<float>;
+        { c.rehash(n) };
+        { c.reserve(n) };
+        { c.clear() };
+        { cc.size() } -> std::same_as<typename Container::size_type>;
+        { cc.empty() } -> std::same_as<bool>;
+        { cc.cbegin() } -> std::same_as<typename Container::const_iterator>;
+        { cc.cend() } -> std::same_as<typename Container::const_iterator>;
+    };
+
+}
+
 template <typename Container>
 concept UnorderedAssociativeContainer =
     std::derived_from<Container,
@@ -24,4 +63,5 @@ concept UnorderedAssociativeContainer =
                       std::unordered_multimap<typename Container::key_type,
                                               typename Container::mapped_type>> ||
     std::derived_from<Container, std::unordered_set<typename Container::key_type>> ||
-    std::derived_from<Container, std::unordered_multiset<typename Container::key_type>>;
+    std::derived_from<Container, std::unordered_multiset<typename Container::key_type>> ||
+    unordered_associative_container_detail::unordered_associative_interface<Container>;
@@ -0,0 +1,322 @@
+// SPDX-FileCopyrightText: Steven Ward
+// SPDX-License-Identifier: MPL-2.0
+
+/// Validate UTF-8 strings and find runs of ASCII characters
+/**
+* \file
+* \author Steven Ward
+* The vectorized validator uses the lookup algorithm from simdjson and simdutf.
+* \sa https://arxiv.org/abs/2010.03090
+* \sa https://github.com/simdutf/simdutf/blob/master/src/generic/utf8_validation/utf8_lookup4_algorithm.h
+* \sa https://github.com/simdjson/simdjson/blob/master/src/generic/stage1/utf8_lookup4_algorithm.h
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+/// Get the number of leading ASCII bytes in \a s
+/**
+* \return the index of the first byte of \a s with its high bit set, or the size of \a s
+*/
+[[nodiscard]] static size_t
+ascii_prefix_len(const std::string_view s) noexcept
+{
+    const auto* const p = reinterpret_cast<const uint8_t*>(std::data(s));
+    const size_t len = std::size(s);
+    size_t i = 0;
+
+#if defined(__SSE2__)
+    for (; i + sizeof(__m128i) <= len; i += sizeof(__m128i))
+    {
+        const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i));
+        if (const auto mask = static_cast<unsigned int>(_mm_movemask_epi8(chunk)); mask != 0)
+            return i + static_cast<size_t>(__builtin_ctz(mask));
+    }
+#else
+    for (; i + sizeof(uint64_t) <= len; i += sizeof(uint64_t))
+    {
+        uint64_t word = 0;
+        (void)std::memcpy(&word, p + i, sizeof(word));
+        if (const uint64_t mask = word & UINT64_C(0x8080808080808080); mask != 0)
+            // Presume little-endian
+            return i + static_cast<size_t>(__builtin_ctzll(mask)) / 8;
+    }
+#endif
+
+    for (; i < len; ++i)
+    {
+        if (p[i] >= 0x80)
+            return i;
+    }
+
+    return len;
+}
+
+/// Determine if \a s is valid UTF-8 (scalar version)
+/**
+* Overlong encodings, surrogates, and code points above U+10FFFF are invalid.
+* \sa https://www.unicode.org/versions/Unicode15.0.0/ch03.pdf#G7404 (Table 3-7)
+*/
+[[nodiscard]] static bool
+utf8_valid_scalar(const std::string_view s) noexcept
+{
+    const auto* const p = reinterpret_cast<const uint8_t*>(std::data(s));
+    const size_t len = std::size(s);
+    size_t i = 0;
+
+    while (i < len)
+    {
+        const uint8_t b0 = p[i];
+
+        if (b0 < 0x80)
+        {
+            ++i;
+            continue;
+        }
+
+        size_t n = 0; // number of continuation bytes
+        uint8_t lo = 0x80; // lower bound of the 2nd byte
+        uint8_t hi = 0xBF; // upper bound of the 2nd byte
+
+        if (b0 >= 0xC2 && b0 <= 0xDF) { n = 1; }
+        else if (b0 == 0xE0) { n = 2; lo = 0xA0; }
+        else if (b0 >= 0xE1 && b0 <= 0xEC) { n = 2; }
+        else if (b0 == 0xED) { n = 2; hi = 0x9F; }
+        else if (b0 >= 0xEE && b0 <= 0xEF) { n = 2; }
+        else if (b0 == 0xF0) { n = 3; lo = 0x90; }
+        else if (b0 >= 0xF1 && b0 <= 0xF3) { n = 3; }
+        else if (b0 == 0xF4) { n = 3; hi = 0x8F; }
+        else { return false; }
+
+        if (len - i <= n)
+            return false;
+
+        if (p[i + 1] < lo || p[i + 1] > hi)
+            return false;
+
+        for (size_t j = 2; j <= n; ++j)
+        {
+            if ((p[i + j] & 0xC0) != 0x80)
+                return false;
+        }
+
+        i += n + 1;
+    }
+
+    return true;
+}
+
+#if defined(__SSSE3__)
+
+namespace utf8_valid_detail
+{
+
+// Error bits for the 1st and 2nd bytes of each pair of adjacent bytes
+inline constexpr uint8_t TOO_SHORT = 1U << 0; // 11______ 0_______ or 11______ 11______
+inline constexpr uint8_t TOO_LONG = 1U << 1; // 0_______ 10______
+inline constexpr uint8_t OVERLONG_3 = 1U << 2; // 11100000 100_____
+inline constexpr uint8_t TOO_LARGE = 1U << 3; // 11110100 1001____ and greater
+inline constexpr uint8_t SURROGATE = 1U << 4; // 11101101 101_____
+inline constexpr uint8_t OVERLONG_2 = 1U << 5; // 1100000_ 10______
+inline constexpr uint8_t TOO_LARGE_1000 = 1U << 6; // 11110101 1000____ and greater
+inline constexpr uint8_t OVERLONG_4 = 1U << 6; // 11110000 1000____
+inline constexpr uint8_t TWO_CONTS = 1U << 7; // 10______ 10______
+inline constexpr uint8_t CARRY = TOO_SHORT | TOO_LONG | TWO_CONTS;
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wconversion"
+#pragma GCC diagnostic ignored "-Wsign-conversion"
+
+[[nodiscard]] static inline __m128i
+set_u8x16(const uint8_t (&a)[16]) noexcept
+{
+    // _mm_setr_epi8 takes char
+    return _mm_setr_epi8(a[0], a[1], a[2], a[3], a[4], a[5], a[6], a[7],
+                         a[8], a[9], a[10], a[11], a[12], a[13], a[14], a[15]);
+}
+
+#pragma GCC diagnostic pop
+
+[[nodiscard]] static inline __m128i
+high_nibbles(const __m128i x) noexcept
+{
+    return _mm_and_si128(_mm_srli_epi16(x, 4), _mm_set1_epi8(0x0F));
+}
+
+/// Get the error bits of every pair of adjacent bytes
+[[nodiscard]] static inline __m128i
+check_special_cases(const __m128i input, const __m128i prev1) noexcept
+{
+    const __m128i byte_1_high_table = set_u8x16({
+        // 0_______ ________ <ASCII in byte 1>
+        TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG,
+        TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG,
+        // 10______ ________ <continuation in byte 1>
+        TWO_CONTS, TWO_CONTS, TWO_CONTS, TWO_CONTS,
+        // 1100____ ________ <two byte lead in byte 1>
+        TOO_SHORT | OVERLONG_2,
+        // 1101____ ________ <two byte lead in byte 1>
+        TOO_SHORT,
+        // 1110____ ________ <three byte lead in byte 1>
+        TOO_SHORT | OVERLONG_3 | SURROGATE,
+        // 1111____ ________ <four+ byte lead in byte 1>
+        TOO_SHORT | TOO_LARGE | TOO_LARGE_1000 | OVERLONG_4,
+    });
+
+    const __m128i byte_1_low_table = set_u8x16({
+        // ____0000 ________
+        CARRY | OVERLONG_3 | OVERLONG_2 | OVERLONG_4,
+        // ____0001 ________
+        CARRY | OVERLONG_2,
+        // ____001_ ________
+        CARRY,
+        CARRY,
+        // ____0100 ________
+        CARRY | TOO_LARGE,
+        // ____0101 ________
+        CARRY | TOO_LARGE | TOO_LARGE_1000,
+        // ____011_ ________
+        CARRY | TOO_LARGE | TOO_LARGE_1000,
+        CARRY | TOO_LARGE | TOO_LARGE_1000,
+        // ____1___ ________
+        CARRY | TOO_LARGE | TOO_LARGE_1000,
+        CARRY | TOO_LARGE | TOO_LARGE_1000,
+        CARRY | TOO_LARGE | TOO_LARGE_1000,
+        CARRY | TOO_LARGE | TOO_LARGE_1000,
+        CARRY | TOO_LARGE | TOO_LARGE_1000,
+        // ____1101 ________
+        CARRY | TOO_LARGE | TOO_LARGE_1000 | SURROGATE,
+        CARRY | TOO_LARGE | TOO_LARGE_1000,
+        CARRY | TOO_LARGE | TOO_LARGE_1000,
+    });
+
+    const __m128i byte_2_high_table = set_u8x16({
+        // ________ 0_______ <ASCII in byte 2>
+        TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT,
+        TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT,
+        // ________ 1000____
+        TOO_LONG | OVERLONG_2 | TWO_CONTS | OVERLONG_3 | TOO_LARGE_1000 | OVERLONG_4,
+        // ________ 1001____
+        TOO_LONG | OVERLONG_2 | TWO_CONTS | OVERLONG_3 | TOO_LARGE,
+        // ________ 101_____
+        TOO_LONG | OVERLONG_2 | TWO_CONTS | SURROGATE | TOO_LARGE,
+        TOO_LONG | OVERLONG_2 | TWO_CONTS | SURROGATE | TOO_LARGE,
+        // ________ 11______ <lead in byte 2>
+        TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT,
+    });
+
+    const __m128i byte_1_high = _mm_shuffle_epi8(byte_1_high_table, high_nibbles(prev1));
+    const __m128i byte_1_low = _mm_shuffle_epi8(byte_1_low_table,
+                                                _mm_and_si128(prev1, _mm_set1_epi8(0x0F)));
+    const __m128i byte_2_high = _mm_shuffle_epi8(byte_2_high_table, high_nibbles(input));
+
+    return _mm_and_si128(_mm_and_si128(byte_1_high, byte_1_low), byte_2_high);
+}
+
+/// Get the error bits of a 16-byte block
+[[nodiscard]] static inline __m128i
+check_block(const __m128i input, const __m128i prev_input) noexcept
+{
+    const __m128i prev1 = _mm_alignr_epi8(input, prev_input, 16 - 1);
+    const __m128i prev2 = _mm_alignr_epi8(input, prev_input, 16 - 2);
+    const __m128i prev3 = _mm_alignr_epi8(input, prev_input, 16 - 3);
+
+    const __m128i special_cases = check_special_cases(input, prev1);
+
+    // Only 111_____ will be >= 0x80
+    const __m128i is_third_byte = _mm_subs_epu8(prev2, _mm_set1_epi8(0xE0 - 0x80));
+    // Only 1111____ will be >= 0x80
+    const __m128i is_fourth_byte = _mm_subs_epu8(prev3, _mm_set1_epi8(0xF0 - 0x80));
+
+    const __m128i must23_80 = _mm_and_si128(_mm_or_si128(is_third_byte, is_fourth_byte),
+                                            _mm_set1_epi8(static_cast<char>(0x80)));
+
+    return _mm_xor_si128(must23_80, special_cases);
+}
+
+/// Get the bytes at the end of the block that begin an incomplete sequence
+[[nodiscard]] static inline __m128i
+is_incomplete(const __m128i input) noexcept
+{
+    // If the last byte is >= 0xC0, the last 2 bytes are >= 0xE0, or the last 3 bytes are >= 0xF0,
+    // then the sequence continues into the next block.
+    const __m128i max_value = set_u8x16({
+        0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+        0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xF0 - 1, 0xE0 - 1, 0xC0 - 1,
+    });
+    return _mm_subs_epu8(input, max_value);
+}
+
+} // namespace utf8_valid_detail
+
+/// Determine if \a s is valid UTF-8 (SSSE3 version)
+/**
+* 16 bytes are checked per iteration.
+* Blocks of ASCII characters only need to check for an incomplete sequence at the end of the previous block.
+*/
+[[nodiscard]] static bool
+utf8_valid_ssse3(const std::string_view s) noexcept
+{
+    using namespace utf8_valid_detail;
+
+    const auto* const p = reinterpret_cast<const uint8_t*>(std::data(s));
+    const size_t len = std::size(s);
+
+    __m128i error = _mm_setzero_si128();
+    __m128i prev_input = _mm_setzero_si128();
+    __m128i prev_incomplete = _mm_setzero_si128();
+
+    const auto check_next_block = [&](const __m128i input)
+    {
+        if (_mm_movemask_epi8(input) == 0)
+        {
+            // All ASCII: the previous block must not have ended mid-sequence.
+            error = _mm_or_si128(error, prev_incomplete);
+        }
+        else
+        {
+            error = _mm_or_si128(error, check_block(input, prev_input));
+            prev_incomplete = is_incomplete(input);
+        }
+        prev_input = input;
+    };
+
+    size_t i = 0;
+    for (; i + sizeof(__m128i) <= len; i += sizeof(__m128i))
+    {
+        check_next_block(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i)));
+    }
+
+    if (i < len)
+    {
+        // Pad the tail with NUL (i.e. ASCII) bytes.
+        alignas(16) uint8_t tail[sizeof(__m128i)] = {};
+        (void)std::memcpy(tail, p + i, len - i);
+        check_next_block(_mm_load_si128(reinterpret_cast<const __m128i*>(tail)));
+    }
+
+    error = _mm_or_si128(error, prev_incomplete);
+
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(error, _mm_setzero_si128())) == 0xFFFF;
+}
+
+#endif
+
+/// Determine if \a s is valid UTF-8
+[[nodiscard]] static bool
+utf8_valid(const std::string_view s) noexcept
+{
+#if defined(__SSSE3__)
+    return utf8_valid_ssse3(s);
+#else
+    return utf8_valid_scalar(s);
+#endif
+}
@@ -14,18 +14,80 @@
 
 #pragma once
 
+#include "utf8_valid.hpp"
+
 #include <cstdlib>
 #include <stdexcept>
 #include <string>
+#include <string_view>
 #include <utf8proc.h>
 
-/// Get the number of columns needed to represent a UTF-8 string
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+/// Get the number of columns needed to represent an ASCII string
+/**
+* This matches the result of \c utf8width_utf8proc for ASCII strings.
+* Because of \c UTF8PROC_STRIPCC, HT, LF, VT, FF, CR, and CRLF are converted to a space, and all other control characters are removed.
+* \pre \a s has no NUL characters.
+* \pre \a s has no non-ASCII characters.
+*/
+[[nodiscard]] static size_t
+ascii_width(const std::string_view s) noexcept
+{
+    const char* const p = std::data(s);
+    const size_t len = std::size(s);
+    size_t num_cols = 0;
+    size_t i = 0;
+
+#if defined(__SSE2__)
+    for (; i + sizeof(__m128i) <= len; i += sizeof(__m128i))
+    {
+        const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i));
+
+        // Every byte is ASCII, so signed comparisons are safe.
+        const __m128i is_print = _mm_and_si128(_mm_cmpgt_epi8(chunk, _mm_set1_epi8(0x1F)),
+                                               _mm_cmplt_epi8(chunk, _mm_set1_epi8(0x7F)));
+        const __m128i is_space = _mm_and_si128(_mm_cmpgt_epi8(chunk, _mm_set1_epi8(0x08)),
+                                               _mm_cmplt_epi8(chunk, _mm_set1_epi8(0x0E)));
+
+        const auto col_mask = static_cast<unsigned int>(
+            _mm_movemask_epi8(_mm_or_si128(is_print, is_space)));
+        const auto cr_mask = static_cast<unsigned int>(
+            _mm_movemask_epi8(_mm_cmpeq_epi8(chunk, _mm_set1_epi8('\r'))));
+        auto lf_mask = static_cast<unsigned int>(
+            _mm_movemask_epi8(_mm_cmpeq_epi8(chunk, _mm_set1_epi8('\n'))));
+
+        // Include the first byte of the next chunk.
+        if (i + sizeof(__m128i) < len && p[i + sizeof(__m128i)] == '\n')
+            lf_mask |= 1U << sizeof(__m128i);
+
+        // CRLF is one column.
+        num_cols += static_cast<size_t>(__builtin_popcount(col_mask) -
+                                        __builtin_popcount(cr_mask & (lf_mask >> 1)));
+    }
+#endif
+
+    for (; i < len; ++i)
+    {
+        const char c = p[i];
+
+        if (c >= 0x20 && c < 0x7F)
+            ++num_cols;
+        else if (c >= '\t' && c <= '\r' && !(c == '\r' && i + 1 < len && p[i + 1] == '\n'))
+            ++num_cols;
+    }
+
+    return num_cols;
+}
+
+/// Get the number of columns needed to represent a UTF-8 string, using only utf8proc
 size_t
-utf8width(const std::string& s)
+utf8width_utf8proc(const std::string_view s)
 {
     // https://juliastrings.github.io/utf8proc/doc/utf8proc_8h.html#a0a18a541ba5bedeb5c3e150024063c2d
     static constexpr unsigned int options = 0
-        | UTF8PROC_NULLTERM
         | UTF8PROC_STABLE
         | UTF8PROC_COMPOSE
         //| UTF8PROC_IGNORE // removes 00AD
@@ -39,8 +101,8 @@ utf8width(const std::string& s)
 
     uint8_t* dst = nullptr;
 
-    const ssize_t dstlen = utf8proc_map(reinterpret_cast<const uint8_t*>(s.c_str()),
-                                        static_cast<ssize_t>(s.size()), &dst,
+    const ssize_t dstlen = utf8proc_map(reinterpret_cast<const uint8_t*>(std::data(s)),
+                                        static_cast<ssize_t>(std::size(s)), &dst,
                                         static_cast<utf8proc_option_t>(options));
 
     if (dstlen < 0)
@@ -67,3 +129,96 @@ utf8width(const std::string& s)
 
     return num_cols;
 }
+
+/// Get the number of columns needed to represent the code point \a codepoint
+/**
+* This matches the options of \c utf8width_utf8proc without mapping the string.
+* Because of \c UTF8PROC_STRIPMARK, \c UTF8PROC_STRIPNA, and \c UTF8PROC_STRIPCC, marks, unassigned code points, and control characters are removed, except NEL, which is converted to a space.
+* Composing does not change the width, because the marks are stripped.
+*/
+[[nodiscard]] static size_t
+codepoint_width(const int32_t codepoint) noexcept
+{
+    // NEL is a newline sequence, so it is converted to a space.
+    if (codepoint == 0x85)
+        return 1;
+
+    const utf8proc_category_t category = utf8proc_category(codepoint);
+
+    if (category == UTF8PROC_CATEGORY_MN || category == UTF8PROC_CATEGORY_MC ||
+        category == UTF8PROC_CATEGORY_ME || category == UTF8PROC_CATEGORY_CN ||
+        category == UTF8PROC_CATEGORY_CC)
+        return 0;
+
+    return static_cast<size_t>(utf8proc_charwidth(codepoint));
+}
+
+/// Get the number of columns needed to represent a valid UTF-8 string, one code point at a time
+/**
+* Nothing is allocated.
+* \pre \a s is valid UTF-8.
+*/
+[[nodiscard]] static size_t
+utf8width_codepoints(const std::string_view s)
+{
+    const auto* p = reinterpret_cast<const uint8_t*>(std::data(s));
+    const auto* const end = p + std::size(s);
+    size_t num_cols = 0;
+
+    while (p < end)
+    {
+        int32_t codepoint = 0;
+
+        const ssize_t bytes_read = utf8proc_iterate(p, end - p, &codepoint);
+
+        if (bytes_read < 0)
+            throw std::runtime_error(utf8proc_errmsg(bytes_read));
+
+        num_cols += codepoint_width(codepoint);
+        p += bytes_read;
+    }
+
+    return num_cols;
+}
+
+/// Get the number of columns needed to represent a UTF-8 string
+/**
+* The string is read up to the first NUL character.
+* Runs of ASCII characters are counted directly.
+* The runs of non-ASCII characters are measured one code point at a time (see \c codepoint_width).
+*/
+size_t
+utf8width(const std::string& s)
+{
+    const std::string_view sv{s.c_str()};
+
+    if (!utf8_valid(sv))
+        throw std::runtime_error(utf8proc_errmsg(UTF8PROC_ERROR_INVALIDUTF8));
+
+    size_t num_cols = 0;
+    size_t i = 0;
+
+    while (i < std::size(sv))
+    {
+        const size_t ascii_len = ascii_prefix_len(sv.substr(i));
+
+        if (i + ascii_len == std::size(sv))
+        {
+            num_cols += ascii_width(sv.substr(i));
+            break;
+        }
+
+        num_cols += ascii_width(sv.substr(i, ascii_len));
+        i += ascii_len;
+
+        // Find the next ASCII character after the non-ASCII run.
+        size_t j = i + 1;
+        while (j < std::size(sv) && static_cast<unsigned char>(sv[j]) >= 0x80)
+            ++j;
+
+        num_cols += utf8width_codepoints(sv.substr(i, j - i));
+        i = j;
+    }
+
+    return num_cols;
+}
@@ -0,0 +1,827 @@
+// SPDX-FileCopyrightText: Steven Ward
+// SPDX-License-Identifier: MPL-2.0
+
+#include "preader.h"
+#include "proc_stat_idle.h"
+#include "rolling_stats.h"
+#include "sample_shm.h"
+#include "strtou.h"
+#include "ts_to_ns.h"
+
+#include <assert.h>
+#include <dirent.h>
+#include <err.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/signalfd.h>
+#include <sys/stat.h>
+#include <sys/timerfd.h>
+#include <time.h>
+#include <unistd.h>
+
+const char* const program_author = "Steven Ward";
+const char* const program_version = "1.2.0";
+const char* const program_license = "MPL-2.0";
+
+constexpr unsigned int default_interval_msec = 2000;
+constexpr unsigned int default_shm_capacity = 256;
+constexpr unsigned int default_window_size = 0;
+char default_net_iface[NAME_MAX + 1] = {'\0'};
+
+bool done = false;
+
+uint64_t
+get_monotonic_ns()
+{
+    struct timespec now_ts;
+
+    if (clock_gettime(CLOCK_MONOTONIC, &now_ts) < 0)
+    {
+        err(EXIT_FAILURE, "clock_gettime");
+    }
+
+    return ts_to_ns(&now_ts);
+}
+
+// {{{ sources
+
+struct source;
+
+/// Sample \a src, and get the measurement
+/**
+* \retval 1 success
+* \retval 0 there is no measurement yet (the first sample)
+* \retval -1 failure
+*/
+typedef int (*sample_fn)(struct source* src, double* value);
+
+struct source_type
+{
+    const char* name;
+    bool is_net;      // measures the network interface
+    const char* path; // the file in /sys/class/net/IFACE/statistics/ if is_net
+    sample_fn sample;
+    int precision; // digits after the decimal point in the text output
+    // the histogram of the rolling statistics
+    double hist_lo;
+    double hist_hi;
+    bool hist_log;
+    const char* description;
+};
+
+struct source
+{
+    const struct source_type* type;
+    unsigned int interval_msec;
+    uint64_t interval_ns;
+    uint64_t next_deadline_ns;
+
+    const char* dest_path;
+    int dest_fd;
+
+    const char* shm_path;
+    struct sample_shm shm;
+
+    char path[PATH_MAX];
+    struct preader reader;
+
+    bool primed;
+    uint64_t prev[2];
+
+    struct rolling_stats stats; // if window_size != 0
+};
+
+/// Sample the CPU ticks, and get the CPU usage
+int
+sample_cpu(struct source* src, double* value)
+{
+    uint64_t idle = 0;
+    uint64_t sum = 0;
+
+    if (proc_stat_idle(&src->reader, &idle, &sum) < 0)
+    {
+        return -1;
+    }
+
+    const uint64_t prev_idle = src->prev[0];
+    const uint64_t prev_sum = src->prev[1];
+
+    src->prev[0] = idle;
+    src->prev[1] = sum;
+
+    if (!src->primed)
+    {
+        src->primed = true;
+        return 0;
+    }
+
+    double cpu_usage = 0;
+
+    if (sum - prev_sum != 0)
+    {
+        cpu_usage = 1 - (double)(idle - prev_idle) / (double)(sum - prev_sum);
+    }
+
+    *value = cpu_usage;
+    return 1;
+}
+
+/// Sample a byte counter, and get the rate in bytes/second
+int
+sample_net_bytes(struct source* src, double* value)
+{
+    const uint64_t now_ns = get_monotonic_ns();
+
+    uint64_t bytes = 0;
+
+    if (preader_read_u64(&src->reader, &bytes) < 0)
+    {
+        return -1;
+    }
+
+    const uint64_t prev_now_ns = src->prev[0];
+    const uint64_t prev_bytes = src->prev[1];
+
+    src->prev[0] = now_ns;
+    src->prev[1] = bytes;
+
+    if (!src->primed)
+    {
+        src->primed = true;
+        return 0;
+    }
+
+    uintmax_t bytes_per_s = 0;
+
+    // The counter is reset if the link goes down and up.
+    if (now_ns != prev_now_ns && bytes >= prev_bytes)
+    {
+        // round to nearest int
+        bytes_per_s = (uintmax_t)((double)(bytes - prev_bytes) * 1E9 /
+                                  (double)(now_ns - prev_now_ns) + 0.5);
+    }
+
+    *value = (double)bytes_per_s;
+    return 1;
+}
+
+const struct source_type source_types[] = {
+    {"cpu", false, "/proc/stat", sample_cpu, 6, 0, 1, false, "average CPU usage, within the interval [0, 1]"},
+    {"rx", true, "rx_bytes", sample_net_bytes, 0, 1, 1E11, true, "network receive speed (bytes/second)"},
+    {"tx", true, "tx_bytes", sample_net_bytes, 0, 1, 1E11, true, "network transmit speed (bytes/second)"},
+};
+
+constexpr size_t num_source_types = sizeof(source_types) / sizeof(source_types[0]);
+
+constexpr size_t max_sources = 16;
+
+// {{{ rolling statistics
+
+// like the load averages
+constexpr size_t num_ewma = 3;
+const double ewma_tau_s[num_ewma] = {60, 300, 900};
+
+constexpr size_t hist_num_buckets = 256;
+
+// the measurement, the EWMAs, and the window statistics
+constexpr size_t max_measurement_values = 1 + num_ewma + ROLLING_STATS_NUM_WINDOW_VALUES;
+
+unsigned int window_size = default_window_size;
+
+// }}}
+
+struct source sources[max_sources];
+size_t num_sources = 0;
+
+/// Parse \a spec (NAME[:MSEC[:FILE[:SHM]]]), and add the source
+void
+add_source(char* spec)
+{
+    if (num_sources == max_sources)
+    {
+        errx(EXIT_FAILURE, "too many sources (max %zu)", max_sources);
+    }
+
+    const char* name = strsep(&spec, ":");
+    const char* msec_str = strsep(&spec, ":");
+    const char* file = strsep(&spec, ":");
+    const char* shm_file = spec;
+
+    const struct source_type* type = nullptr;
+    for (size_t i = 0; i < num_source_types; ++i)
+    {
+        if (strcmp(name, source_types[i].name) == 0)
+        {
+            type = &source_types[i];
+            break;
+        }
+    }
+
+    if (type == nullptr)
+    {
+        errx(EXIT_FAILURE, "invalid source: '%s'", name);
+    }
+
+    struct source* src = &sources[num_sources++];
+    (void)memset(src, 0, sizeof(*src));
+    src->type = type;
+    src->dest_fd = -1;
+    src->shm.fd = -1;
+
+    if (msec_str != nullptr && *msec_str != '\0')
+    {
+        src->interval_msec = strtou(msec_str);
+        if (src->interval_msec == 0)
+        {
+            errx(EXIT_FAILURE, "invalid interval: '%s'", msec_str);
+        }
+    }
+
+    if (file != nullptr && *file != '\0')
+    {
+        src->dest_path = file;
+    }
+
+    if (shm_file != nullptr && *shm_file != '\0')
+    {
+        src->shm_path = shm_file;
+    }
+}
+
+/// Write the measurement of \a src, or append it to \a out_buf (for stdout)
+void
+write_measurement(struct source* src, uint64_t now_ns, double value,
+                  char* out_buf, size_t out_buf_size, size_t* out_len)
+{
+    double values[max_measurement_values] = {value};
+    size_t num_values = 1;
+
+    if (window_size != 0)
+    {
+        rolling_stats_push(&src->stats, now_ns, value);
+        rolling_stats_summary(&src->stats, values + 1);
+        num_values += rolling_stats_num_summary(&src->stats);
+    }
+
+    if (src->shm_path != nullptr)
+    {
+        sample_shm_write(&src->shm, now_ns, values);
+    }
+
+    char buf[max_measurement_values * 32] = {'\0'};
+    size_t len = 0;
+
+    for (size_t i = 0; i < num_values; ++i)
+    {
+        const int n = snprintf(buf + len, sizeof(buf) - len, "%s%.*f",
+                               (i == 0) ? "" : " ", src->type->precision, values[i]);
+        if (n > 0 && (size_t)n < sizeof(buf) - len)
+        {
+            len += (size_t)n;
+        }
+    }
+
+    if (src->dest_path != nullptr)
+    {
+        if (lseek(src->dest_fd, 0, SEEK_SET) < 0)
+        {
+            err(EXIT_FAILURE, "lseek");
+        }
+
+        if (write(src->dest_fd, buf, len) < 0)
+        {
+            err(EXIT_FAILURE, "write");
+        }
+
+        // Discard any leftover tail from a longer previous write.
+        if (ftruncate(src->dest_fd, (off_t)len) < 0)
+        {
+            err(EXIT_FAILURE, "ftruncate");
+        }
+    }
+    else
+    {
+        const int m = snprintf(out_buf + *out_len, out_buf_size - *out_len,
+                               "%s %s\n", src->type->name, buf);
+        if (m > 0 && (size_t)m < out_buf_size - *out_len)
+        {
+            *out_len += (size_t)m;
+        }
+    }
+}
+
+// }}}
+
+void
+atexit_cleanup()
+{
+    for (size_t i = 0; i < num_sources; ++i)
+    {
+        struct source* src = &sources[i];
+
+        preader_close(&src->reader);
+        rolling_stats_free(&src->stats);
+
+        if (src->dest_fd >= 0)
+        {
+            (void)close(src->dest_fd);
+            src->dest_fd = -1;
+
+            if (done && remove(src->dest_path) < 0)
+            {
+                perror("remove");
+            }
+        }
+
+        if (src->shm.fd >= 0)
+        {
+            sample_shm_close(&src->shm);
+
+            if (done && remove(src->shm_path) < 0)
+            {
+                perror("remove");
+            }
+        }
+    }
+}
+
+int
+scandir_filter(const struct dirent* dirent)
+{
+    // Exclude these names
+    return strcmp(dirent->d_name, ".") != 0 &&
+           strcmp(dirent->d_name, "..") != 0 &&
+           strcmp(dirent->d_name, "lo") != 0;
+}
+
+void
+set_default_net_iface()
+{
+    struct dirent** namelist = nullptr;
+    int n = 0;
+
+    n = scandir("/sys/class/net/", &namelist, scandir_filter, alphasort);
+    if (n <= 0)
+    {
+        // Only the network sources need it.
+        return;
+    }
+
+    (void)strncpy(default_net_iface, namelist[0]->d_name, sizeof(default_net_iface));
+    default_net_iface[sizeof(default_net_iface) - 1] = '\0';
+
+    while (n--)
+    {
+        free(namelist[n]);
+    }
+    free((void*)namelist);
+}
+
+void
+print_version()
+{
+    printf("%s %s\n", program_invocation_short_name, program_version);
+    printf("License: %s\n", program_license);
+    printf("Written by %s\n", program_author);
+}
+
+void
+print_usage()
+{
+    printf("Usage: %s [OPTION]... -s SOURCE...\n", program_invocation_short_name);
+    printf("\n");
+    printf("Continuously measure several sources, each at its own regular interval, and write the measurements to stdout or temporary files.\n");
+    printf("\n");
+    printf("All sources are sampled by one loop woken by one timer.\n");
+    printf("The deadlines of all sources are multiples of their intervals from the same start time, so sources whose intervals are multiples of each other are sampled in the same wakeup.\n");
+    printf("\n");
+    printf("Measurements written to stdout are prefixed with the name of the source.\n");
+    printf("\n");
+
+    printf("SOURCES\n");
+    for (size_t i = 0; i < num_source_types; ++i)
+    {
+        printf("  %-8s %s\n", source_types[i].name, source_types[i].description);
+    }
+    printf("\n");
+
+    printf("OPTIONS\n");
+    printf("  -V       Print the version information, then exit.\n");
+    printf("\n");
+    printf("  -h       Print this message, then exit.\n");
+    printf("\n");
+    printf("  -i MSEC  Specify the default interval (in milliseconds) between measurements.\n");
+    printf("           MSEC must be a positive integer.\n");
+    printf("           The default value is %u.\n", default_interval_msec);
+    printf("\n");
+    printf("  -n NET   Specify the network interface.\n");
+    printf("           NET is a name found in /sys/class/net/.\n");
+    printf("           The default value is \"%s\".\n", default_net_iface);
+    printf("\n");
+    printf("  -N NUM   Specify the number of measurements kept in every shared-memory file.\n");
+    printf("           NUM must be a positive integer.\n");
+    printf("           The default value is %u.\n", default_shm_capacity);
+    printf("\n");
+    printf("  -s NAME[:MSEC[:FILE[:SHM]]]\n");
+    printf("           Measure the source NAME.\n");
+    printf("           MSEC is the interval of this source (the default interval if omitted).\n");
+    printf("           FILE is the temporary output file of this source (stdout if omitted).\n");
+    printf("           FILE must not exist when this daemon starts.\n");
+    printf("           FILE is truncated before every measurement is written.\n");
+    printf("           FILE is removed when this daemon exits successfully.\n");
+    printf("           SHM is the shared-memory file of this source (see sample_shm.h).\n");
+    printf("           SHM must not exist when this daemon starts.\n");
+    printf("           SHM is removed when this daemon exits successfully.\n");
+    printf("           This option may be given up to %zu times.\n", max_sources);
+    printf("\n");
+    printf("  -w NUM   Also compute rolling statistics of every source.\n");
+    printf("           Every measurement is followed by %zu EWMAs (with time constants of", num_ewma);
+    for (size_t i = 0; i < num_ewma; ++i)
+    {
+        printf(" %gs", ewma_tau_s[i]);
+    }
+    printf("),\n");
+    printf("           and the min, max, mean, p50, p90, and p99 of the last NUM measurements.\n");
+    printf("           The percentiles are estimated with a histogram of %zu buckets.\n", hist_num_buckets);
+    printf("           The shared-memory files hold these values too.\n");
+    printf("           The default value is %u (disabled).\n", default_window_size);
+    printf("\n");
+    printf("SIGUSR1 and SIGUSR2 restart the intervals of all sources.\n");
+    printf("\n");
+}
+
+/// Arm \a timer_fd to expire at the earliest deadline
+void
+arm_timer(int timer_fd)
+{
+    uint64_t deadline_ns = UINT64_MAX;
+
+    for (size_t i = 0; i < num_sources; ++i)
+    {
+        if (sources[i].next_deadline_ns < deadline_ns)
+        {
+            deadline_ns = sources[i].next_deadline_ns;
+        }
+    }
+
+    const struct itimerspec its = {
+        .it_interval = {0, 0},
+        .it_value = {
+            .tv_sec = (time_t)(deadline_ns / UINT64_C(1'000'000'000)),
+            .tv_nsec = (long)(deadline_ns % UINT64_C(1'000'000'000)),
+        },
+    };
+
+    if (timerfd_settime(timer_fd, TFD_TIMER_ABSTIME, &its, nullptr) < 0)
+    {
+        err(EXIT_FAILURE, "timerfd_settime");
+    }
+}
+
+/// Start the intervals of all sources at \a start_ns
+void
+reset_deadlines(uint64_t start_ns)
+{
+    for (size_t i = 0; i < num_sources; ++i)
+    {
+        sources[i].next_deadline_ns = start_ns + sources[i].interval_ns;
+    }
+}
+
+int
+main([[maybe_unused]] int argc, [[maybe_unused]] char* argv[])
+{
+    set_default_net_iface();
+    unsigned int interval_msec = default_interval_msec;
+    char* net_iface = default_net_iface;
+    unsigned int shm_capacity = default_shm_capacity;
+
+    int oc = 0;
+    const char* short_options = "+:Vhi:N:n:s:w:";
+    while ((oc = getopt(argc, argv, short_options)) != -1)
+    {
+        switch (oc)
+        {
+        case 'V':
+            print_version();
+            return EXIT_SUCCESS;
+
+        case 'h':
+            print_usage();
+            return EXIT_SUCCESS;
+
+        case 'i':
+            interval_msec = strtou(optarg);
+            if (interval_msec == 0)
+            {
+                errx(EXIT_FAILURE, "invalid interval: %u", interval_msec);
+            }
+            break;
+
+        case 'N':
+            shm_capacity = strtou(optarg);
+            if (shm_capacity == 0)
+            {
+                errx(EXIT_FAILURE, "invalid number of measurements: %u", shm_capacity);
+            }
+            break;
+
+        case 'n':
+            net_iface = optarg;
+            break;
+
+        case 's':
+            add_source(optarg);
+            break;
+
+        case 'w':
+            window_size = strtou(optarg);
+            break;
+
+        default:
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    if (num_sources == 0)
+    {
+        errx(EXIT_FAILURE, "no source was given");
+    }
+
+    // Only the network sources need a network interface.
+    for (size_t i = 0; i < num_sources; ++i)
+    {
+        if (sources[i].type->is_net)
+        {
+            if (strchr(net_iface, '/') != nullptr || *net_iface == '\0')
+            {
+                errx(EXIT_FAILURE, "invalid network interface: '%s'", net_iface);
+            }
+            break;
+        }
+    }
+
+    assert(atexit(atexit_cleanup) == 0);
+
+    constexpr mode_t new_mask = 0o133; // rw-r--r--
+    (void)umask(new_mask);
+
+    for (size_t i = 0; i < num_sources; ++i)
+    {
+        struct source* src = &sources[i];
+
+        if (src->interval_msec == 0)
+        {
+            src->interval_msec = interval_msec;
+        }
+        src->interval_ns = (uint64_t)src->interval_msec * UINT64_C(1'000'000);
+
+        int n = 0;
+        if (src->type->is_net)
+        {
+            n = snprintf(src->path, sizeof(src->path), "/sys/class/net/%s/statistics/%s", net_iface, src->type->path);
+        }
+        else
+        {
+            n = snprintf(src->path, sizeof(src->path), "%s", src->type->path);
+        }
+        if (n < 0 || (size_t)n >= sizeof(src->path))
+        {
+            errx(EXIT_FAILURE, "snprintf");
+        }
+
+        // Opened once and re-read every tick
+        if (preader_open(&src->reader, src->path) < 0)
+        {
+            exit(EXIT_FAILURE);
+        }
+
+        if (src->dest_path != nullptr)
+        {
+            // Opened once and kept open for the life of the daemon: writing
+            // through this fd every tick (below) is immune to dest_path being
+            // later replaced with a symlink, since a fd is bound to the
+            // underlying inode, not the path.
+            src->dest_fd = open(src->dest_path, O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0o666);
+            if (src->dest_fd < 0)
+            {
+                err(EXIT_FAILURE, "%s", src->dest_path);
+            }
+        }
+
+        size_t num_values = 1;
+
+        if (window_size != 0)
+        {
+            struct rolling_stats_config config = {
+                .window = window_size,
+                .num_ewma = num_ewma,
+                .ewma_tau_s = {0},
+                .num_buckets = hist_num_buckets,
+                .hist_lo = src->type->hist_lo,
+                .hist_hi = src->type->hist_hi,
+                .hist_log = src->type->hist_log,
+            };
+            (void)memcpy(config.ewma_tau_s, ewma_tau_s, sizeof(ewma_tau_s));
+
+            if (rolling_stats_init(&src->stats, &config) < 0)
+            {
+                errx(EXIT_FAILURE, "rolling_stats_init");
+            }
+            num_values += rolling_stats_num_summary(&src->stats);
+        }
+
+        if (src->shm_path != nullptr &&
+            sample_shm_create(&src->shm, src->shm_path, (uint32_t)num_values, shm_capacity) < 0)
+        {
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    // The signals are received with a signalfd instead of a handler.
+    sigset_t signal_mask;
+    if (sigemptyset(&signal_mask) < 0)
+    {
+        err(EXIT_FAILURE, "sigemptyset");
+    }
+
+    constexpr int signals_to_handle[] = {
+        SIGHUP,
+        SIGINT,
+        SIGPIPE,
+        SIGQUIT,
+        SIGTERM,
+        SIGUSR1,
+        SIGUSR2,
+    };
+
+    constexpr size_t num_signals_to_handle =
+        sizeof(signals_to_handle) / sizeof(signals_to_handle[0]);
+    for (size_t i = 0; i < num_signals_to_handle; ++i)
+    {
+        if (sigaddset(&signal_mask, signals_to_handle[i]) < 0)
+        {
+            err(EXIT_FAILURE, "sigaddset");
+        }
+    }
+
+    sigset_t orig_mask;
+    if (sigprocmask(SIG_BLOCK, &signal_mask, &orig_mask) < 0)
+    {
+        err(EXIT_FAILURE, "sigprocmask");
+    }
+
+    const int signal_fd = signalfd(-1, &signal_mask, SFD_NONBLOCK | SFD_CLOEXEC);
+    if (signal_fd < 0)
+    {
+        err(EXIT_FAILURE, "signalfd");
+    }
+
+    const int timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (timer_fd < 0)
+    {
+        err(EXIT_FAILURE, "timerfd_create");
+    }
+
+    const int epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (epoll_fd < 0)
+    {
+        err(EXIT_FAILURE, "epoll_create1");
+    }
+
+    const int watched_fds[] = {signal_fd, timer_fd};
+    for (size_t i = 0; i < sizeof(watched_fds) / sizeof(watched_fds[0]); ++i)
+    {
+        struct epoll_event event = {.events = EPOLLIN, .data = {.fd = watched_fds[i]}};
+        if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, watched_fds[i], &event) < 0)
+        {
+            err(EXIT_FAILURE, "epoll_ctl");
+        }
+    }
+
+    // Enough for one line per source
+    char out_buf[max_sources * (max_measurement_values * 32 + 16)];
+
+    // The first sample of every source is not a measurement.
+    for (size_t i = 0; i < num_sources; ++i)
+    {
+        double value = 0;
+        if (sources[i].type->sample(&sources[i], &value) < 0)
+        {
+            errx(EXIT_FAILURE, "error scanning '%s'", sources[i].path);
+        }
+    }
+
+    reset_deadlines(get_monotonic_ns());
+    arm_timer(timer_fd);
+
+    while (!done)
+    {
+        struct epoll_event events[2];
+        const int num_events = epoll_wait(epoll_fd, events, 2, -1);
+        if (num_events < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            err(EXIT_FAILURE, "epoll_wait");
+        }
+
+        bool timer_expired = false;
+
+        for (int e = 0; e < num_events; ++e)
+        {
+            if (events[e].data.fd == signal_fd)
+            {
+                struct signalfd_siginfo siginfo;
+                while (read(signal_fd, &siginfo, sizeof(siginfo)) == (ssize_t)sizeof(siginfo))
+                {
+                    switch (siginfo.ssi_signo)
+                    {
+                    case SIGUSR1:
+                    case SIGUSR2:
+                        reset_deadlines(get_monotonic_ns());
+                        arm_timer(timer_fd);
+                        break;
+
+                    default:
+                        done = true;
+                        break;
+                    }
+                }
+            }
+            else if (events[e].data.fd == timer_fd)
+            {
+                uint64_t num_expirations = 0;
+                if (read(timer_fd, &num_expirations, sizeof(num_expirations)) < 0 &&
+                    errno != EAGAIN)
+                {
+                    err(EXIT_FAILURE, "read");
+                }
+                timer_expired = true;
+            }
+        }
+
+        if (done || !timer_expired)
+        {
+            continue;
+        }
+
+        const uint64_t now_ns = get_monotonic_ns();
+        size_t out_len = 0;
+
+        for (size_t i = 0; i < num_sources; ++i)
+        {
+            struct source* src = &sources[i];
+
+            if (src->next_deadline_ns > now_ns)
+            {
+                continue;
+            }
+
+            double value = 0;
+            const int result = src->type->sample(src, &value);
+            if (result < 0)
+            {
+                errx(EXIT_FAILURE, "error scanning '%s'", src->path);
+            }
+
+            if (result > 0)
+            {
+                write_measurement(src, now_ns, value, out_buf, sizeof(out_buf), &out_len);
+            }
+
+            // Skip the deadlines that were missed, but keep the alignment.
+            src->next_deadline_ns +=
+                ((now_ns - src->next_deadline_ns) / src->interval_ns + 1) * src->interval_ns;
+        }
+
+        if (out_len != 0 && (fwrite(out_buf, 1, out_len, stdout) != out_len ||
+                             fflush(stdout) == EOF))
+        {
+            err(EXIT_FAILURE, "fwrite");
+        }
+
+        arm_timer(timer_fd);
+    }
+
+    (void)close(epoll_fd);
+    (void)close(timer_fd);
+    (void)close(signal_fd);
+
+    if (sigprocmask(SIG_SETMASK, &orig_mask, nullptr) < 0)
+    {
+        err(EXIT_FAILURE, "sigprocmask");
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,628 @@
+// SPDX-FileCopyrightText: Steven Ward
+// SPDX-License-Identifier: MPL-2.0
+
+#include "circqueue.h"
+#include "deadline_timer.h"
+#include "meter.h"
+#include "parse_int.h"
+#include "sample_shm.h"
+#include "strtou.h"
+
+#include <err.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <locale.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <wchar.h>
+
+const char* const program_author = "Steven Ward";
+const char* const program_version = "1.0.0";
+const char* const program_license = "MPL-2.0";
+
+constexpr unsigned int default_interval_msec = 1000;
+constexpr size_t default_meter_width = 10;
+constexpr size_t max_meter_width = 1000;
+constexpr size_t max_meters = 16;
+
+// {{{ meters
+
+enum meter_type
+{
+    METER_BAR,   // left_blocks_meter
+    METER_RBAR,  // right_blocks_meter
+    METER_LINE,  // ver_lines_meter
+    METER_SPARK, // lower_blocks of the last WIDTH values
+    NUM_METER_TYPES,
+};
+
+const char* const meter_type_names[NUM_METER_TYPES] = {"bar", "rbar", "line", "spark"};
+
+struct meter
+{
+    enum meter_type type;
+    size_t index; // of the value in a sample
+    size_t width;
+    double max;        // the value that fills the meter
+    double value;      // the latest value, within [0, 1]
+    circqueue history; // double (sparklines only)
+};
+
+struct meter meters[max_meters];
+size_t num_meters = 0;
+
+/// Parse \a s (which must be only an unsigned integer) that is at most \a max
+/**
+* \retval true success
+* \retval false \a s is not an unsigned integer, or it is greater than \a max
+*/
+bool
+parse_size(const char* s, size_t max, size_t* value)
+{
+    const char* const last = s + strlen(s);
+    const char* end = nullptr;
+    uint64_t x = 0;
+
+    if (parse_uint_max(s, last, 0, max, &x, &end) != 0 || end != last)
+    {
+        return false;
+    }
+
+    *value = (size_t)x;
+    return true;
+}
+
+/// Parse \a spec (TYPE[:INDEX[:WIDTH[:MAX]]]), and add the meter
+void
+add_meter(char* spec)
+{
+    if (num_meters == max_meters)
+    {
+        errx(EXIT_FAILURE, "too many meters (max %zu)", max_meters);
+    }
+
+    const char* type_str = strsep(&spec, ":");
+    const char* index_str = strsep(&spec, ":");
+    const char* width_str = strsep(&spec, ":");
+    const char* max_str = spec;
+
+    struct meter* m = &meters[num_meters++];
+    (void)memset(m, 0, sizeof(*m));
+    m->type = NUM_METER_TYPES;
+    m->width = default_meter_width;
+    m->max = 1;
+
+    for (size_t i = 0; i < NUM_METER_TYPES; ++i)
+    {
+        if (strcmp(type_str, meter_type_names[i]) == 0)
+        {
+            m->type = (enum meter_type)i;
+            break;
+        }
+    }
+
+    if (m->type == NUM_METER_TYPES)
+    {
+        errx(EXIT_FAILURE, "invalid meter type: '%s'", type_str);
+    }
+
+    if (index_str != nullptr && *index_str != '\0')
+    {
+        if (!parse_size(index_str, UINT32_MAX - 1, &m->index))
+        {
+            errx(EXIT_FAILURE, "invalid meter index: '%s'", index_str);
+        }
+    }
+
+    if (width_str != nullptr && *width_str != '\0')
+    {
+        if (!parse_size(width_str, max_meter_width, &m->width) || m->width == 0)
+        {
+            errx(EXIT_FAILURE, "invalid meter width: '%s'", width_str);
+        }
+    }
+
+    if (max_str != nullptr && *max_str != '\0')
+    {
+        m->max = strtod(max_str, nullptr);
+        if (!(m->max > 0) || !isfinite(m->max))
+        {
+            errx(EXIT_FAILURE, "invalid meter max: '%s'", max_str);
+        }
+    }
+
+    if (m->type == METER_SPARK)
+    {
+        m->history = circqueue_init(m->width, sizeof(double));
+        if (m->history.buf == nullptr)
+        {
+            err(EXIT_FAILURE, "calloc");
+        }
+    }
+}
+
+/// Update every meter with a sample of \a num_values values
+void
+update_meters(const double* values, size_t num_values)
+{
+    for (size_t i = 0; i < num_meters; ++i)
+    {
+        struct meter* m = &meters[i];
+
+        double x = (m->index < num_values) ? values[m->index] / m->max : 0;
+
+        // e.g. the fields of an offline CPU are NaN
+        if (!isfinite(x))
+        {
+            x = 0;
+        }
+        clamp(&x);
+        m->value = x;
+
+        if (m->type == METER_SPARK)
+        {
+            (void)circqueue_push_overwrite_if_full(&m->history, &x);
+        }
+    }
+}
+
+/// the number of wide characters of a rendering (the meters, the spaces between them, and a newline)
+size_t
+rendering_len()
+{
+    size_t len = 0;
+
+    for (size_t i = 0; i < num_meters; ++i)
+    {
+        len += meters[i].width + 1;
+    }
+
+    return len;
+}
+
+/// Render every meter into \a out (which has room for \c rendering_len wide characters)
+void
+render_meters(wchar_t* out)
+{
+    for (size_t i = 0; i < num_meters; ++i)
+    {
+        const struct meter* m = &meters[i];
+
+        switch (m->type)
+        {
+        case METER_BAR:
+            left_blocks_meter(m->value, out, m->width);
+            break;
+
+        case METER_RBAR:
+            right_blocks_meter(m->value, out, m->width);
+            break;
+
+        case METER_LINE:
+            ver_lines_meter(m->value, out, m->width);
+            break;
+
+        case METER_SPARK:
+        {
+            // oldest first, right-aligned
+            const size_t num_blank = m->width - m->history.num_elems;
+
+            for (size_t j = 0; j < num_blank; ++j)
+            {
+                out[j] = SPACE;
+            }
+
+            for (size_t j = 0; j < m->history.num_elems; ++j)
+            {
+                out[num_blank + j] = lower_blocks_1(*(const double*)circqueue_at(&m->history, j));
+            }
+            break;
+        }
+
+        case NUM_METER_TYPES:
+        default:
+            break;
+        }
+
+        out += m->width;
+        *out++ = (i + 1 < num_meters) ? SPACE : L'\n';
+    }
+}
+
+// }}}
+
+// {{{ output
+
+wchar_t* rendering = nullptr;
+wchar_t* prev_rendering = nullptr;
+size_t rendering_size = 0; // wide characters
+char* mb_rendering = nullptr;
+size_t mb_rendering_size = 0;
+bool has_prev_rendering = false;
+
+/// Allocate the buffers of the renderings (once)
+void
+alloc_renderings()
+{
+    rendering_size = rendering_len();
+
+    rendering = (wchar_t*)calloc(rendering_size + 1, sizeof(*rendering));
+    prev_rendering = (wchar_t*)calloc(rendering_size + 1, sizeof(*prev_rendering));
+
+    mb_rendering_size = rendering_size * MB_CUR_MAX + 1;
+    mb_rendering = (char*)malloc(mb_rendering_size);
+
+    if (rendering == nullptr || prev_rendering == nullptr || mb_rendering == nullptr)
+    {
+        err(EXIT_FAILURE, "malloc");
+    }
+}
+
+void
+free_renderings()
+{
+    free(rendering);
+    free(prev_rendering);
+    free(mb_rendering);
+}
+
+/// Render the meters, and write them to stdout if they changed
+void
+write_meters()
+{
+    render_meters(rendering);
+
+    if (has_prev_rendering && wmemcmp(rendering, prev_rendering, rendering_size) == 0)
+    {
+        return;
+    }
+
+    const size_t len = wcstombs(mb_rendering, rendering, mb_rendering_size);
+    if (len == (size_t)-1)
+    {
+        err(EXIT_FAILURE, "wcstombs");
+    }
+
+    for (size_t written = 0; written < len;)
+    {
+        const ssize_t n = write(STDOUT_FILENO, mb_rendering + written, len - written);
+        if (n < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            err(EXIT_FAILURE, "write");
+        }
+        written += (size_t)n;
+    }
+
+    (void)wmemcpy(prev_rendering, rendering, rendering_size);
+    has_prev_rendering = true;
+}
+
+// }}}
+
+/// Render the samples read from \a fd (records of \a num_values doubles) until EOF
+void
+run_stream(int fd, size_t num_values)
+{
+    const size_t record_size = num_values * sizeof(double);
+    const size_t buf_size = record_size * 64;
+
+    // double, so the records are aligned
+    double* buf = (double*)malloc(buf_size);
+    if (buf == nullptr)
+    {
+        err(EXIT_FAILURE, "malloc");
+    }
+
+    size_t len = 0;
+
+    while (true)
+    {
+        const ssize_t n = read(fd, (char*)buf + len, buf_size - len);
+        if (n < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            err(EXIT_FAILURE, "read");
+        }
+        if (n == 0)
+        {
+            break;
+        }
+        len += (size_t)n;
+
+        const size_t num_records = len / record_size;
+
+        // A burst of samples is rendered once.
+        for (size_t i = 0; i < num_records; ++i)
+        {
+            update_meters(buf + i * num_values, num_values);
+        }
+
+        if (num_records != 0)
+        {
+            write_meters();
+
+            // Keep a partial record.
+            len -= num_records * record_size;
+            (void)memmove(buf, (const char*)buf + num_records * record_size, len);
+        }
+    }
+
+    free(buf);
+}
+
+/// Render the samples of the shared-memory file \a shm, checked every \a interval_msec
+void
+run_shm(const struct sample_shm* shm, unsigned int interval_msec)
+{
+    const size_t num_values = shm->num_values;
+
+    // Enough samples to fill every sparkline
+    size_t max_history = 1;
+    for (size_t i = 0; i < num_meters; ++i)
+    {
+        if (max_history < meters[i].width)
+        {
+            max_history = meters[i].width;
+        }
+    }
+
+    uint64_t* times_ns = (uint64_t*)malloc(max_history * sizeof(*times_ns));
+    double* values = (double*)malloc(max_history * num_values * sizeof(*values));
+    if (times_ns == nullptr || values == nullptr)
+    {
+        err(EXIT_FAILURE, "malloc");
+    }
+
+    // The first check is now, and the next ones are at the deadlines.
+    struct deadline_timer timer = {-1, {0, 0}, {0, 0}};
+    if (deadline_timer_open(&timer, interval_msec, interval_msec) < 0 ||
+        deadline_timer_start(&timer) < 0)
+    {
+        exit(EXIT_FAILURE);
+    }
+
+    uint64_t prev_count = 0;
+
+    while (true)
+    {
+        if (__atomic_load_n(&shm->header->count, __ATOMIC_ACQUIRE) != prev_count)
+        {
+            // More samples could be written before the copy is made,
+            // so the samples are counted as of the copy.
+            uint64_t count = 0;
+            const ssize_t num_samples = sample_shm_read_history(shm, max_history, times_ns, values, &count);
+            if (num_samples < 0)
+            {
+                errx(EXIT_FAILURE, "no consistent sample was read");
+            }
+
+            // Only the samples written since the previous check
+            size_t first = 0;
+            if (count - prev_count < (uint64_t)num_samples)
+            {
+                first = (size_t)num_samples - (size_t)(count - prev_count);
+            }
+
+            for (size_t i = first; i < (size_t)num_samples; ++i)
+            {
+                update_meters(values + i * num_values, num_values);
+            }
+
+            write_meters();
+            prev_count = count;
+        }
+
+        // Missed deadlines are not made up.
+        if (deadline_timer_wait(&timer, nullptr) < 0)
+        {
+            exit(EXIT_FAILURE);
+        }
+    }
+}
+
+void
+print_version()
+{
+    printf("%s %s\n", program_invocation_short_name, program_version);
+    printf("License: %s\n", program_license);
+    printf("Written by %s\n", program_author);
+}
+
+void
+print_usage()
+{
+    printf("Usage: %s [OPTION]... -e METER...\n", program_invocation_short_name);
+    printf("\n");
+    printf("Continuously read samples, and print a line of meters (using Unicode block characters) whenever it changes.\n");
+    printf("\n");
+    printf("A sample is a record of real numbers (values).\n");
+    printf("By default, the samples are read from stdin (or a FIFO) as native-endian doubles (binary64), until EOF.\n");
+    printf("Alternatively, they are read from a shared-memory file written by a sampling daemon (see sample_shm.h).\n");
+    printf("\n");
+    printf("Every line is rendered into preallocated buffers, and is only written if it differs from the previous line, so one process serves every refresh of a status bar.\n");
+    printf("\n");
+
+    printf("METERS\n");
+    printf("  bar      filled from the left\n");
+    printf("  rbar     filled from the right\n");
+    printf("  line     a vertical line, positioned from the left\n");
+    printf("  spark    a sparkline of the last WIDTH values (the latest at the right)\n");
+    printf("\n");
+
+    printf("OPTIONS\n");
+    printf("  -V       Print the version information, then exit.\n");
+    printf("\n");
+    printf("  -h       Print this message, then exit.\n");
+    printf("\n");
+    printf("  -e TYPE[:INDEX[:WIDTH[:MAX]]]\n");
+    printf("           Add a meter of the type TYPE.\n");
+    printf("           INDEX is the position of its value in a sample (0 if omitted).\n");
+    printf("           WIDTH is its width in characters (%zu if omitted), at most %zu.\n", default_meter_width, max_meter_width);
+    printf("           MAX is the value that fills it (1 if omitted).\n");
+    printf("           Values that are not finite are shown as 0.\n");
+    printf("           This option may be given up to %zu times.\n", max_meters);
+    printf("\n");
+    printf("  -p FIFO  Read the samples from FIFO instead of stdin.\n");
+    printf("           FIFO is opened for reading and writing, so it is not closed when a writer exits.\n");
+    printf("\n");
+    printf("  -k NUM   Specify the number of values in a sample read from stdin or a FIFO.\n");
+    printf("           The default value is the greatest INDEX + 1.\n");
+    printf("\n");
+    printf("  -m FILE  Read the samples from the shared-memory file FILE.\n");
+    printf("\n");
+    printf("  -i MSEC  Specify the interval (in milliseconds) between checks of the shared-memory file.\n");
+    printf("           MSEC must be a positive integer.\n");
+    printf("           The default value is %u.\n", default_interval_msec);
+    printf("\n");
+}
+
+int
+main([[maybe_unused]] int argc, [[maybe_unused]] char* argv[])
+{
+    unsigned int interval_msec = default_interval_msec;
+    unsigned int num_values = 0;
+    const char* fifo_path = nullptr;
+    const char* shm_path = nullptr;
+
+    int oc = 0;
+    const char* short_options = "+:Vhe:i:k:m:p:";
+    while ((oc = getopt(argc, argv, short_options)) != -1)
+    {
+        switch (oc)
+        {
+        case 'V':
+            print_version();
+            return EXIT_SUCCESS;
+
+        case 'h':
+            print_usage();
+            return EXIT_SUCCESS;
+
+        case 'e':
+            add_meter(optarg);
+            break;
+
+        case 'i':
+            interval_msec = strtou(optarg);
+            if (interval_msec == 0)
+            {
+                errx(EXIT_FAILURE, "invalid interval: %u", interval_msec);
+            }
+            break;
+
+        case 'k':
+            num_values = strtou(optarg);
+            if (num_values == 0)
+            {
+                errx(EXIT_FAILURE, "invalid number of values: %u", num_values);
+            }
+            break;
+
+        case 'm':
+            shm_path = optarg;
+            break;
+
+        case 'p':
+            fifo_path = optarg;
+            break;
+
+        default:
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    if (num_meters == 0)
+    {
+        errx(EXIT_FAILURE, "no meter was given");
+    }
+
+    if (fifo_path != nullptr && shm_path != nullptr)
+    {
+        errx(EXIT_FAILURE, "options -p and -m are mutually exclusive");
+    }
+
+    // The block characters are encoded in the locale's encoding (e.g. UTF-8).
+    if (setlocale(LC_ALL, "") == nullptr)
+    {
+        errx(EXIT_FAILURE, "setlocale");
+    }
+
+    // A single-byte encoding (e.g. of the C or POSIX locale) can not encode them.
+    if (MB_CUR_MAX <= 1)
+    {
+        errx(EXIT_FAILURE, "the locale's encoding can not encode the block characters (e.g. set LC_ALL to a UTF-8 locale)");
+    }
+
+    size_t max_index = 0;
+    for (size_t i = 0; i < num_meters; ++i)
+    {
+        if (max_index < meters[i].index)
+        {
+            max_index = meters[i].index;
+        }
+    }
+
+    alloc_renderings();
+
+    if (shm_path != nullptr)
+    {
+        struct sample_shm shm = {-1, 0, nullptr, nullptr, 0, 0, 0};
+        if (sample_shm_open(&shm, shm_path) < 0)
+        {
+            exit(EXIT_FAILURE);
+        }
+
+        if (max_index >= shm.num_values)
+        {
+            errx(EXIT_FAILURE, "'%s' has %u values per sample", shm_path, shm.num_values);
+        }
+
+        run_shm(&shm, interval_msec);
+    }
+
+    if (num_values == 0)
+    {
+        num_values = (unsigned int)max_index + 1;
+    }
+
+    int fd = STDIN_FILENO;
+
+    if (fifo_path != nullptr)
+    {
+        fd = open(fifo_path, O_RDWR | O_CLOEXEC);
+        if (fd < 0)
+        {
+            err(EXIT_FAILURE, "%s", fifo_path);
+        }
+    }
+
+    run_stream(fd, num_values);
+
+    if (fd != STDIN_FILENO)
+    {
+        (void)close(fd);
+    }
+
+    for (size_t i = 0; i < num_meters; ++i)
+    {
+        if (meters[i].history.buf != nullptr)
+        {
+            circqueue_free(&meters[i].history);
+        }
+    }
+    free_renderings();
+
+    return EXIT_SUCCESS;
+}
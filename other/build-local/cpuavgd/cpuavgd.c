@@ -2,14 +2,17 @@
 // SPDX-License-Identifier: MPL-2.0
 
 #include "acfile.h"
-#include "pscanf.h"
+#include "deadline_timer.h"
+#include "preader.h"
+#include "proc_stat_idle.h"
+#include "sample_shm.h"
+#include "sampling_daemon.h"
 #include "strtou.h"
-#include "timeval.h"
+#include "ts_to_ns.h"
 
-#include <assert.h>
 #include <err.h>
-#include <errno.h>
 #include <fcntl.h>
+#include <math.h>
 #include <signal.h>
 #include <stdbool.h>
 #include <stdint.h>
@@ -17,76 +20,278 @@
 #include <stdlib.h>
 #include <string.h>
 #include <sys/stat.h>
-#include <sys/time.h>
+#include <time.h>
 #include <unistd.h>
 
-// {{{ Copied from my slstatus
-// https://github.com/planet36/slstatus/blob/main/components/cpu.c
+// {{{ per-core and per-state ticks
 
+// The columns of a "cpu" line in /proc/stat
+// (guest and guest_nice are already counted in user and nice)
+enum cpu_state
+{
+    CPU_USER,
+    CPU_NICE,
+    CPU_SYSTEM,
+    CPU_IDLE,
+    CPU_IOWAIT,
+    CPU_IRQ,
+    CPU_SOFTIRQ,
+    CPU_STEAL,
+    NUM_CPU_STATES,
+};
+
+struct cpu_ticks
+{
+    bool present; // offline CPUs are omitted from /proc/stat
+    uint64_t ticks[NUM_CPU_STATES];
+};
+
+/// The ticks of every CPU
+/**
+* Slot 0 is the aggregate "cpu" line, and slot N+1 is the "cpuN" line.
+*/
+struct cpu_table
+{
+    struct cpu_ticks* cpus;
+    size_t len;
+};
+
+/// Grow \a table to at least \a len slots (new slots are not present)
 int
-calc_idle(uintmax_t* idle, uintmax_t* sum)
+cpu_table_reserve(struct cpu_table* table, size_t len)
 {
-    uintmax_t a[6];
+    if (len <= table->len)
+    {
+        return 0;
+    }
 
-    // cpu user nice system idle iowait irq softirq
-    if (pscanf("/proc/stat", "%*s %ju %ju %ju %ju %*s %ju %ju",
-               &a[0], &a[1], &a[2], &a[3], &a[4], &a[5]) != 6)
+    struct cpu_ticks* cpus = (struct cpu_ticks*)realloc(table->cpus, len * sizeof(*cpus));
+    if (cpus == nullptr)
     {
+        warn("realloc");
         return -1;
     }
 
-    *idle = a[3];
-    *sum = a[0] + a[1] + a[2] + a[3] + a[4] + a[5];
-
+    (void)memset(cpus + table->len, 0, (len - table->len) * sizeof(*cpus));
+    table->cpus = cpus;
+    table->len = len;
     return 0;
 }
 
-// }}}
+/// Scan every "cpu" line of /proc/stat (in one pass over one read) into \a table
+int
+scan_cpu_table(struct preader* stat_reader, struct cpu_table* table)
+{
+    if (preader_read(stat_reader) < 0)
+    {
+        return -1;
+    }
 
-const char* const program_author = "Steven Ward";
-const char* const program_version = "1.1.2";
-const char* const program_license = "MPL-2.0";
+    for (size_t i = 0; i < table->len; ++i)
+    {
+        table->cpus[i].present = false;
+    }
 
-constexpr unsigned int default_init_delay_msec = 2000;
-constexpr unsigned int default_interval_msec = 2000;
+    const char* p = stat_reader->buf;
+    const char* const last = p + stat_reader->len;
 
-const char* dest_path = nullptr;
+    // The "cpu" lines are first.
+    while (last - p > 3 && memcmp(p, "cpu", 3) == 0)
+    {
+        p += 3;
+
+        size_t slot = 0;
+
+        if (*p != ' ')
+        {
+            uint64_t cpu_num = 0;
+            if (!scan_u64(&p, last, &cpu_num))
+            {
+                return -1;
+            }
+            slot = (size_t)cpu_num + 1;
+        }
+
+        if (cpu_table_reserve(table, slot + 1) < 0)
+        {
+            return -1;
+        }
+
+        struct cpu_ticks* cpu = &table->cpus[slot];
+
+        for (size_t i = 0; i < NUM_CPU_STATES; ++i)
+        {
+            if (!scan_u64(&p, last, &cpu->ticks[i]))
+            {
+                return -1;
+            }
+        }
+
+        cpu->present = true;
+
+        if (!scan_next_line(&p, last))
+        {
+            break;
+        }
+    }
+
+    return (table->len > 0 && table->cpus[0].present) ? 0 : -1;
+}
+
+/// Get the CPU usage (as in \c proc_stat_idle, iowait is excluded)
+double
+core_usage(const struct cpu_ticks* prev, const struct cpu_ticks* cur)
+{
+    uint64_t delta[NUM_CPU_STATES];
+    for (size_t i = 0; i < NUM_CPU_STATES; ++i)
+    {
+        delta[i] = cur->ticks[i] - prev->ticks[i];
+    }
+
+    const uint64_t sum = delta[CPU_USER] + delta[CPU_NICE] + delta[CPU_SYSTEM] +
+                         delta[CPU_IDLE] + delta[CPU_IRQ] + delta[CPU_SOFTIRQ];
+
+    if (sum == 0)
+    {
+        return 0;
+    }
+
+    return 1 - (double)delta[CPU_IDLE] / (double)sum;
+}
 
-volatile sig_atomic_t done = 0;
-volatile sig_atomic_t reset_alarm = 1;
+// The fields of a CPU in per-core mode
+#define NUM_CPU_FIELDS 7
 
+/// Get the usage of a CPU, and the fractions of the ticks in user (including nice), system, iowait, irq, softirq, and steal
 void
-signal_handler(int signum)
+cpu_fractions(const struct cpu_ticks* prev, const struct cpu_ticks* cur, double fields[NUM_CPU_FIELDS])
 {
-    switch (signum)
+    uint64_t delta[NUM_CPU_STATES];
+    uint64_t total = 0;
+    for (size_t i = 0; i < NUM_CPU_STATES; ++i)
     {
-    case SIGALRM:
-        // no op
-        break;
-
-    case SIGUSR1:
-    case SIGUSR2:
-        reset_alarm = 1;
-        break;
-
-    default:
-        done = 1;
-        break;
+        delta[i] = cur->ticks[i] - prev->ticks[i];
+        total += delta[i];
     }
+
+    const double scale = (total != 0) ? 1 / (double)total : 0;
+
+    fields[0] = core_usage(prev, cur);
+    fields[1] = (double)(delta[CPU_USER] + delta[CPU_NICE]) * scale;
+    fields[2] = (double)delta[CPU_SYSTEM] * scale;
+    fields[3] = (double)delta[CPU_IOWAIT] * scale;
+    fields[4] = (double)delta[CPU_IRQ] * scale;
+    fields[5] = (double)delta[CPU_SOFTIRQ] * scale;
+    fields[6] = (double)delta[CPU_STEAL] * scale;
 }
 
+/// Format a line for every CPU present in \a prev and \a cur
+/**
+* Each line is the name of the CPU and its fields (see \c cpu_fractions).
+* \return the length of the string written to \a buf
+*/
+size_t
+format_cpu_table(const struct cpu_table* prev, const struct cpu_table* cur,
+                 char* buf, size_t buf_size)
+{
+    size_t len = 0;
+
+    for (size_t slot = 0; slot < cur->len && slot < prev->len; ++slot)
+    {
+        const struct cpu_ticks* p = &prev->cpus[slot];
+        const struct cpu_ticks* c = &cur->cpus[slot];
+
+        if (!p->present || !c->present)
+        {
+            continue;
+        }
+
+        double fields[NUM_CPU_FIELDS];
+        cpu_fractions(p, c, fields);
+
+        int n = 0;
+        if (slot == 0)
+        {
+            n = snprintf(buf + len, buf_size - len, "cpu");
+        }
+        else
+        {
+            n = snprintf(buf + len, buf_size - len, "cpu%zu", slot - 1);
+        }
+
+        if (n < 0 || (size_t)n >= buf_size - len)
+        {
+            break;
+        }
+        len += (size_t)n;
+
+        n = snprintf(buf + len, buf_size - len,
+                     " %.6f %.6f %.6f %.6f %.6f %.6f %.6f\n",
+                     fields[0], fields[1], fields[2], fields[3],
+                     fields[4], fields[5], fields[6]);
+
+        if (n < 0 || (size_t)n >= buf_size - len)
+        {
+            break;
+        }
+        len += (size_t)n;
+    }
+
+    return len;
+}
+
+/// Get the fields of the first \a num_slots slots (NaN if a CPU is not present)
 void
-atexit_cleanup()
+cpu_table_values(const struct cpu_table* prev, const struct cpu_table* cur,
+                 size_t num_slots, double* values)
 {
-    if (dest_path != nullptr && done)
+    for (size_t slot = 0; slot < num_slots; ++slot)
     {
-        if (remove(dest_path) < 0)
+        double* fields = values + slot * NUM_CPU_FIELDS;
+
+        if (slot < cur->len && slot < prev->len &&
+            prev->cpus[slot].present && cur->cpus[slot].present)
         {
-            perror("remove");
+            cpu_fractions(&prev->cpus[slot], &cur->cpus[slot], fields);
+        }
+        else
+        {
+            for (size_t i = 0; i < NUM_CPU_FIELDS; ++i)
+            {
+                fields[i] = NAN;
+            }
         }
     }
 }
 
+// }}}
+
+const char* const program_author = "Steven Ward";
+const char* const program_version = "1.4.0";
+const char* const program_license = "MPL-2.0";
+
+constexpr unsigned int default_init_delay_msec = 2000;
+constexpr unsigned int default_interval_msec = 2000;
+constexpr unsigned int default_shm_capacity = 256;
+
+const char* dest_path = nullptr;
+const char* shm_path = nullptr;
+
+bool per_core = false;
+
+uint64_t
+get_monotonic_ns()
+{
+    struct timespec now_ts;
+
+    if (clock_gettime(CLOCK_MONOTONIC, &now_ts) < 0)
+    {
+        err(EXIT_FAILURE, "clock_gettime");
+    }
+
+    return ts_to_ns(&now_ts);
+}
+
 void
 print_version()
 {
@@ -104,12 +309,23 @@ print_usage()
     printf("\n");
     printf("CPU usage is a real number within the interval [0, 1].\n");
     printf("\n");
+    printf("In per-core mode, every measurement is a line for the aggregate CPU, then a line for every online CPU:\n");
+    printf("  NAME USAGE USER SYSTEM IOWAIT IRQ SOFTIRQ STEAL\n");
+    printf("USAGE is computed as in the default mode (iowait is excluded).\n");
+    printf("The others are the fractions of all ticks spent in each state (USER includes nice).\n");
+    printf("On stdout, measurements are separated by an empty line.\n");
+    printf("\n");
+    printf("The shared-memory file (see sample_shm.h) holds the usage in the default mode.\n");
+    printf("In per-core mode, it holds the 7 fields of every CPU slot (the aggregate CPU, then cpu0, cpu1, ...) that existed when this daemon started; the fields of an offline CPU are NaN.\n");
+    printf("\n");
 
     printf("OPTIONS\n");
     printf("  -V       Print the version information, then exit.\n");
     printf("\n");
     printf("  -h       Print this message, then exit.\n");
     printf("\n");
+    printf("  -c       Measure every CPU, and the time spent in each state (per-core mode).\n");
+    printf("\n");
     printf("  -f FILE  Specify the temporary output file.\n");
     printf("           FILE must not exist when this daemon starts.\n");
     printf("           FILE is truncated before every measurement is written.\n");
@@ -119,6 +335,14 @@ print_usage()
     printf("           MSEC must be a positive integer.\n");
     printf("           The default value is %u.\n", default_interval_msec);
     printf("\n");
+    printf("  -m FILE  Also write every measurement to the shared-memory file FILE.\n");
+    printf("           FILE must not exist when this daemon starts.\n");
+    printf("           FILE is removed when this daemon exits successfully.\n");
+    printf("\n");
+    printf("  -N NUM   Specify the number of measurements kept in the shared-memory file.\n");
+    printf("           NUM must be a positive integer.\n");
+    printf("           The default value is %u.\n", default_shm_capacity);
+    printf("\n");
 }
 
 int
@@ -126,9 +350,10 @@ main([[maybe_unused]] int argc, [[maybe_unused]] char* argv[])
 {
     unsigned int init_delay_msec = default_init_delay_msec;
     unsigned int interval_msec = default_interval_msec;
+    unsigned int shm_capacity = default_shm_capacity;
 
     int oc = 0;
-    const char* short_options = "+:Vhf:i:";
+    const char* short_options = "+:Vhcf:i:m:N:";
     while ((oc = getopt(argc, argv, short_options)) != -1)
     {
         switch (oc)
@@ -141,6 +366,10 @@ main([[maybe_unused]] int argc, [[maybe_unused]] char* argv[])
             print_usage();
             return EXIT_SUCCESS;
 
+        case 'c':
+            per_core = true;
+            break;
+
         case 'f':
             dest_path = optarg;
             break;
@@ -156,12 +385,27 @@ main([[maybe_unused]] int argc, [[maybe_unused]] char* argv[])
             init_delay_msec = interval_msec;
             break;
 
+        case 'm':
+            shm_path = optarg;
+            break;
+
+        case 'N':
+            shm_capacity = strtou(optarg);
+            if (shm_capacity == 0)
+            {
+                errx(EXIT_FAILURE, "invalid number of measurements: %u", shm_capacity);
+            }
+            break;
+
         default:
             exit(EXIT_FAILURE);
         }
     }
 
-    assert(atexit(atexit_cleanup) == 0);
+    if (sampling_daemon_remove_at_exit(dest_path, shm_path) < 0)
+    {
+        exit(EXIT_FAILURE);
+    }
 
     ACFD(dest_fd) = -1;
 
@@ -181,137 +425,192 @@ main([[maybe_unused]] int argc, [[maybe_unused]] char* argv[])
         }
     }
 
-    struct sigaction signal_action;
-    (void)memset(&signal_action, 0, sizeof(signal_action));
-    signal_action.sa_flags = SA_RESTART;
-    signal_action.sa_handler = signal_handler;
-
-    if (sigfillset(&signal_action.sa_mask) < 0)
-    {
-        err(EXIT_FAILURE, "sigfillset");
-    }
-
-    constexpr int signals_to_handle[] = {
-        SIGALRM,
-        SIGHUP,
-        SIGINT,
-        SIGPIPE,
-        SIGQUIT,
-        SIGTERM,
-        SIGUSR1,
-        SIGUSR2,
-    };
-
-    constexpr size_t num_signals_to_handle =
-        sizeof(signals_to_handle) / sizeof(signals_to_handle[0]);
-    for (size_t i = 0; i < num_signals_to_handle; ++i)
-    {
-        if (sigaction(signals_to_handle[i], &signal_action, nullptr) < 0)
-        {
-            err(EXIT_FAILURE, "sigaction");
-        }
-    }
-
     sigset_t empty_mask;
-    if (sigemptyset(&empty_mask) < 0)
+    sigset_t orig_mask;
+    if (sampling_daemon_handle_signals(&empty_mask, &orig_mask) < 0)
     {
-        err(EXIT_FAILURE, "sigemptyset");
+        exit(EXIT_FAILURE);
     }
 
-    sigset_t full_mask;
-    if (sigfillset(&full_mask) < 0)
+    struct deadline_timer timer = {-1, {0, 0}, {0, 0}};
+    if (deadline_timer_open(&timer, init_delay_msec, interval_msec) < 0)
     {
-        err(EXIT_FAILURE, "sigfillset");
+        exit(EXIT_FAILURE);
     }
 
-    sigset_t orig_mask;
-    // block everything and save current signal mask
-    if (sigprocmask(SIG_BLOCK, &full_mask, &orig_mask) < 0)
+    struct preader stat_reader;
+    if (preader_open(&stat_reader, "/proc/stat") < 0)
     {
-        err(EXIT_FAILURE, "sigprocmask");
+        exit(EXIT_FAILURE);
     }
 
-    const struct timeval init_delay = msec_to_timeval(init_delay_msec);
-    const struct timeval interval = msec_to_timeval(interval_msec);
+    bool first_iteration = true;
+    uint64_t prev_idle_ticks = 0;
+    uint64_t prev_sum_ticks = 0;
 
-    const struct itimerval itv = {
-        .it_interval = interval,
-        .it_value = init_delay, // If zero, the alarm is disabled.
-    };
+    // per-core mode
+    struct cpu_table prev_table = {nullptr, 0};
+    struct cpu_table cur_table = {nullptr, 0};
+    char* table_buf = nullptr;
+    size_t table_buf_size = 0;
 
-    bool first_iteration = true;
-    uintmax_t prev_idle_ticks = 0;
-    uintmax_t prev_sum_ticks = 0;
+    // Created when the number of values is known (after the first scan)
+    struct sample_shm shm = {-1, 0, nullptr, nullptr, 0, 0, 0};
+    size_t shm_num_slots = 0;
+    double* shm_values = nullptr;
 
     do
     {
-        if (reset_alarm)
+        if (sampling_daemon_reset_timer)
         {
-            if (setitimer(ITIMER_REAL, &itv, nullptr) < 0)
+            if (deadline_timer_start(&timer) < 0)
             {
-                err(EXIT_FAILURE, "setitimer");
+                exit(EXIT_FAILURE);
             }
-            reset_alarm = 0;
+            sampling_daemon_reset_timer = 0;
         }
 
-        uintmax_t idle_ticks = 0;
-        uintmax_t sum_ticks = 0;
-
-        if (calc_idle(&idle_ticks, &sum_ticks) < 0)
+        if (per_core)
         {
-            errx(EXIT_FAILURE, "error scanning /proc/stat");
-        }
+            if (scan_cpu_table(&stat_reader, &cur_table) < 0)
+            {
+                errx(EXIT_FAILURE, "error scanning /proc/stat");
+            }
 
-        if (first_iteration)
-        {
-            first_iteration = false;
+            if (cpu_table_reserve(&prev_table, cur_table.len) < 0)
+            {
+                exit(EXIT_FAILURE);
+            }
+
+            // name, 7 fields, and a newline per CPU, and the empty line
+            const size_t needed_buf_size = cur_table.len * 96 + 2;
+            if (table_buf_size < needed_buf_size)
+            {
+                char* buf = (char*)realloc(table_buf, needed_buf_size);
+                if (buf == nullptr)
+                {
+                    err(EXIT_FAILURE, "realloc");
+                }
+                table_buf = buf;
+                table_buf_size = needed_buf_size;
+            }
+
+            if (first_iteration)
+            {
+                first_iteration = false;
+
+                if (shm_path != nullptr)
+                {
+                    shm_num_slots = cur_table.len;
+
+                    shm_values = (double*)malloc(shm_num_slots * NUM_CPU_FIELDS * sizeof(*shm_values));
+                    if (shm_values == nullptr)
+                    {
+                        err(EXIT_FAILURE, "malloc");
+                    }
+
+                    if (sample_shm_create(&shm, shm_path,
+                                          (uint32_t)(shm_num_slots * NUM_CPU_FIELDS),
+                                          shm_capacity) < 0)
+                    {
+                        exit(EXIT_FAILURE);
+                    }
+                }
+            }
+            else
+            {
+                if (shm_path != nullptr)
+                {
+                    cpu_table_values(&prev_table, &cur_table, shm_num_slots, shm_values);
+                    sample_shm_write(&shm, get_monotonic_ns(), shm_values);
+                }
+
+                size_t len = format_cpu_table(&prev_table, &cur_table,
+                                              table_buf, table_buf_size);
+                if (dest_path == nullptr)
+                {
+                    table_buf[len++] = '\n';
+                }
+                if (sampling_daemon_write(dest_fd, table_buf, len) < 0)
+                {
+                    exit(EXIT_FAILURE);
+                }
+            }
+
+            const struct cpu_table tmp = prev_table;
+            prev_table = cur_table;
+            cur_table = tmp;
         }
         else
         {
-            double cpu_usage = 0;
+            uint64_t idle_ticks = 0;
+            uint64_t sum_ticks = 0;
 
-            if (sum_ticks - prev_sum_ticks != 0)
+            if (proc_stat_idle(&stat_reader, &idle_ticks, &sum_ticks) < 0)
             {
-                cpu_usage = 1 - (double)(idle_ticks - prev_idle_ticks) /
-                                (double)(sum_ticks - prev_sum_ticks);
+                errx(EXIT_FAILURE, "error scanning /proc/stat");
             }
 
-            char dest_buf[32] = {'\0'};
-            const int dest_len = snprintf(dest_buf, sizeof(dest_buf), "%.6f", cpu_usage);
+            if (first_iteration)
+            {
+                first_iteration = false;
 
-            if (dest_path != nullptr)
+                if (shm_path != nullptr && sample_shm_create(&shm, shm_path, 1, shm_capacity) < 0)
+                {
+                    exit(EXIT_FAILURE);
+                }
+            }
+            else
             {
-                if (lseek(dest_fd, 0, SEEK_SET) < 0)
+                double cpu_usage = 0;
+
+                if (sum_ticks - prev_sum_ticks != 0)
                 {
-                    err(EXIT_FAILURE, "lseek");
+                    cpu_usage = 1 - (double)(idle_ticks - prev_idle_ticks) /
+                                    (double)(sum_ticks - prev_sum_ticks);
                 }
 
-                if (write(dest_fd, dest_buf, (size_t)dest_len) < 0)
+                if (shm_path != nullptr)
                 {
-                    err(EXIT_FAILURE, "write");
+                    sample_shm_write(&shm, get_monotonic_ns(), &cpu_usage);
                 }
 
-                // Discard any leftover tail from a longer previous write.
-                if (ftruncate(dest_fd, (off_t)dest_len) < 0)
+                char dest_buf[32] = {'\0'};
+                int dest_len = snprintf(dest_buf, sizeof(dest_buf), "%.6f", cpu_usage);
+
+                if (dest_path == nullptr)
                 {
-                    err(EXIT_FAILURE, "ftruncate");
+                    dest_buf[dest_len++] = '\n';
+                }
+                if (sampling_daemon_write(dest_fd, dest_buf, (size_t)dest_len) < 0)
+                {
+                    exit(EXIT_FAILURE);
                 }
             }
-            else if (puts(dest_buf) < 0)
-            {
-                err(EXIT_FAILURE, "puts");
-            }
-        }
 
-        prev_idle_ticks = idle_ticks;
-        prev_sum_ticks = sum_ticks;
+            prev_idle_ticks = idle_ticks;
+            prev_sum_ticks = sum_ticks;
+        }
 
-        if (!done)
+        if (!sampling_daemon_done)
         {
-            (void)sigsuspend(&empty_mask);
+            // Wait for the next deadline (or a signal) with the signals unblocked.
+            // Missed deadlines are not made up: the rates use the actual elapsed time.
+            if (deadline_timer_wait(&timer, &empty_mask) < 0)
+            {
+                exit(EXIT_FAILURE);
+            }
         }
     }
-    while (!done);
+    while (!sampling_daemon_done);
+
+    deadline_timer_close(&timer);
+    preader_close(&stat_reader);
+    free(prev_table.cpus);
+    free(cur_table.cpus);
+    free(table_buf);
+    free(shm_values);
+    sample_shm_close(&shm);
 
     if (sigprocmask(SIG_SETMASK, &orig_mask, nullptr) < 0)
     {
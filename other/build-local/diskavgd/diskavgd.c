@@ -0,0 +1,554 @@
+// SPDX-FileCopyrightText: Steven Ward
+// SPDX-License-Identifier: MPL-2.0
+
+#include "acfile.h"
+#include "counter_rate.h"
+#include "deadline_timer.h"
+#include "name_patterns.h"
+#include "preader.h"
+#include "sample_shm.h"
+#include "sampling_daemon.h"
+#include "strtou.h"
+#include "ts_to_ns.h"
+
+#include <err.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+// {{{ disk statistics
+// https://docs.kernel.org/admin-guide/iostats.html
+
+// The counters of a block device
+struct disk
+{
+    unsigned int major;
+    unsigned int minor;
+    char name[32]; // DISK_NAME_LEN
+    bool is_partition;
+    uint64_t reads;
+    uint64_t read_bytes;
+    uint64_t writes;
+    uint64_t write_bytes;
+    uint64_t io_ticks_ms; // time spent doing I/O
+};
+
+struct disk_table
+{
+    struct disk* disks;
+    size_t num_disks;
+    size_t cap_disks;
+};
+
+/// Find the device \a major:\a minor in \a t
+/**
+* The devices are usually in the same order every time, so \a hint (the position in the current table) is tried first.
+* \return the position of the device, or \c t->num_disks if not found
+*/
+size_t
+disk_find(const struct disk_table* t, unsigned int major, unsigned int minor, size_t hint)
+{
+    if (hint < t->num_disks && t->disks[hint].major == major && t->disks[hint].minor == minor)
+    {
+        return hint;
+    }
+
+    for (size_t i = 0; i < t->num_disks; ++i)
+    {
+        if (t->disks[i].major == major && t->disks[i].minor == minor)
+        {
+            return i;
+        }
+    }
+
+    return t->num_disks;
+}
+
+/// Is the device \a major:\a minor a partition?
+bool
+disk_is_partition(unsigned int major, unsigned int minor)
+{
+    char path[64] = {'\0'};
+    (void)snprintf(path, sizeof(path), "/sys/dev/block/%u:%u/partition", major, minor);
+    return access(path, F_OK) == 0;
+}
+
+/// Scan /proc/diskstats into \a t
+/**
+* Whether a device is a partition is only looked up (in /sys) when the device is not in \a prev.
+* \retval 0 success
+* \retval -1 failure
+*/
+int
+scan_diskstats(struct preader* reader, struct disk_table* t, const struct disk_table* prev)
+{
+    if (preader_read(reader) < 0)
+    {
+        return -1;
+    }
+
+    const char* p = reader->buf;
+    const char* const last = p + reader->len;
+
+    t->num_disks = 0;
+
+    while (p < last)
+    {
+        // major minor name reads reads_merged read_sectors read_ms
+        //   writes writes_merged write_sectors write_ms in_flight io_ticks ...
+        uint64_t major = 0;
+        uint64_t minor = 0;
+
+        if (!scan_u64(&p, last, &major) || !scan_u64(&p, last, &minor))
+        {
+            return -1;
+        }
+
+        scan_skip_blanks(&p, last);
+        const char* name = p;
+        if (!scan_skip_field(&p, last))
+        {
+            return -1;
+        }
+        const size_t name_len = (size_t)(p - name);
+
+        uint64_t a[10];
+
+        for (size_t i = 0; i < 10; ++i)
+        {
+            if (!scan_u64(&p, last, &a[i]))
+            {
+                return -1;
+            }
+        }
+
+        if (t->num_disks == t->cap_disks)
+        {
+            const size_t cap = (t->cap_disks == 0) ? 16 : t->cap_disks * 2;
+            struct disk* disks = (struct disk*)realloc(t->disks, cap * sizeof(*disks));
+            if (disks == nullptr)
+            {
+                warn("realloc");
+                return -1;
+            }
+            t->disks = disks;
+            t->cap_disks = cap;
+        }
+
+        struct disk* d = &t->disks[t->num_disks];
+
+        d->major = (unsigned int)major;
+        d->minor = (unsigned int)minor;
+
+        const size_t n = (name_len < sizeof(d->name)) ? name_len : sizeof(d->name) - 1;
+        (void)memcpy(d->name, name, n);
+        d->name[n] = '\0';
+
+        // A sector is always 512 bytes here, regardless of the device.
+        // The sectors are converted before the rates are computed, so the byte rates are not rounded to 512.
+        d->reads = a[0];
+        d->read_bytes = a[2] * 512;
+        d->writes = a[4];
+        d->write_bytes = a[6] * 512;
+        d->io_ticks_ms = a[9];
+
+        const size_t j = disk_find(prev, d->major, d->minor, t->num_disks);
+        d->is_partition = (j < prev->num_disks) ? prev->disks[j].is_partition
+                                                : disk_is_partition(d->major, d->minor);
+
+        ++t->num_disks;
+
+        if (!scan_next_line(&p, last))
+        {
+            break;
+        }
+    }
+
+    return 0;
+}
+
+// }}}
+
+const char* const program_author = "Steven Ward";
+const char* const program_version = "1.0.0";
+const char* const program_license = "MPL-2.0";
+
+constexpr unsigned int default_init_delay_msec = 1000;
+constexpr unsigned int default_interval_msec = 1000;
+constexpr unsigned int default_shm_capacity = 256;
+
+const char* dest_path = nullptr;
+const char* shm_path = nullptr;
+
+bool partitions = false;
+struct name_patterns disk_patterns;
+
+/// Is the device \a d selected by the partition option, and the include and exclude patterns?
+bool
+disk_is_selected(const struct disk* d)
+{
+    if (d->is_partition && !partitions)
+    {
+        return false;
+    }
+
+    return name_patterns_match(&disk_patterns, d->name);
+}
+
+void
+print_version()
+{
+    printf("%s %s\n", program_invocation_short_name, program_version);
+    printf("License: %s\n", program_license);
+    printf("Written by %s\n", program_author);
+}
+
+void
+print_usage()
+{
+    printf("Usage: %s [OPTION]...\n", program_invocation_short_name);
+    printf("\n");
+    printf("Continuously measure the average disk throughput at a regular interval, and write the measurement to stdout or a temporary file.\n");
+    printf("\n");
+    printf("Every measurement is a line for every selected block device in /proc/diskstats:\n");
+    printf("  NAME READS WRITES READ_BYTES WRITE_BYTES UTIL\n");
+    printf("READS and WRITES are the completed I/O operations per second.\n");
+    printf("READ_BYTES and WRITE_BYTES are bytes/second.\n");
+    printf("UTIL is the fraction of time the device was doing I/O, within the interval [0, 1].\n");
+    printf("On stdout, measurements are separated by an empty line.\n");
+    printf("\n");
+    printf("The shared-memory file (see sample_shm.h) holds the sums of the 4 rates, and the max UTIL, over the selected devices.\n");
+    printf("\n");
+
+    printf("OPTIONS\n");
+    printf("  -V       Print the version information, then exit.\n");
+    printf("\n");
+    printf("  -h       Print this message, then exit.\n");
+    printf("\n");
+    printf("  -p       Also measure partitions.\n");
+    printf("\n");
+    printf("  -I GLOB  Measure only the devices whose names match GLOB.\n");
+    printf("           This option may be given up to %d times.\n", NAME_PATTERNS_MAX);
+    printf("\n");
+    printf("  -X GLOB  Do not measure the devices whose names match GLOB.\n");
+    printf("           This option may be given up to %d times.\n", NAME_PATTERNS_MAX);
+    printf("           Exclusion takes precedence over inclusion.\n");
+    printf("           If neither -I nor -X is given, loop and ram devices are excluded.\n");
+    printf("\n");
+    printf("  -f FILE  Specify the temporary output file.\n");
+    printf("           FILE must not exist when this daemon starts.\n");
+    printf("           FILE is truncated before every measurement is written.\n");
+    printf("           FILE is removed when this daemon exits successfully.\n");
+    printf("\n");
+    printf("  -i MSEC  Specify the interval (in milliseconds) between measurements.\n");
+    printf("           MSEC must be a positive integer.\n");
+    printf("           The default value is %u.\n", default_interval_msec);
+    printf("\n");
+    printf("  -m FILE  Also write every measurement to the shared-memory file FILE.\n");
+    printf("           FILE must not exist when this daemon starts.\n");
+    printf("           FILE is removed when this daemon exits successfully.\n");
+    printf("\n");
+    printf("  -N NUM   Specify the number of measurements kept in the shared-memory file.\n");
+    printf("           NUM must be a positive integer.\n");
+    printf("           The default value is %u.\n", default_shm_capacity);
+    printf("\n");
+}
+
+int
+main([[maybe_unused]] int argc, [[maybe_unused]] char* argv[])
+{
+    unsigned int init_delay_msec = default_init_delay_msec;
+    unsigned int interval_msec = default_interval_msec;
+    unsigned int shm_capacity = default_shm_capacity;
+
+    int oc = 0;
+    const char* short_options = "+:VhpI:X:f:i:m:N:";
+    while ((oc = getopt(argc, argv, short_options)) != -1)
+    {
+        switch (oc)
+        {
+        case 'V':
+            print_version();
+            return EXIT_SUCCESS;
+
+        case 'h':
+            print_usage();
+            return EXIT_SUCCESS;
+
+        case 'p':
+            partitions = true;
+            break;
+
+        case 'I':
+            if (name_patterns_add(&disk_patterns, optarg, false) < 0)
+            {
+                exit(EXIT_FAILURE);
+            }
+            break;
+
+        case 'X':
+            if (name_patterns_add(&disk_patterns, optarg, true) < 0)
+            {
+                exit(EXIT_FAILURE);
+            }
+            break;
+
+        case 'f':
+            dest_path = optarg;
+            break;
+
+        case 'i':
+            interval_msec = strtou(optarg);
+            if (interval_msec == 0)
+            {
+                errx(EXIT_FAILURE, "invalid interval: %u", interval_msec);
+            }
+
+            // There is no option for specifying the initial delay.
+            init_delay_msec = interval_msec;
+            break;
+
+        case 'm':
+            shm_path = optarg;
+            break;
+
+        case 'N':
+            shm_capacity = strtou(optarg);
+            if (shm_capacity == 0)
+            {
+                errx(EXIT_FAILURE, "invalid number of measurements: %u", shm_capacity);
+            }
+            break;
+
+        default:
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    if (disk_patterns.num_include == 0 && disk_patterns.num_exclude == 0)
+    {
+        if (name_patterns_add(&disk_patterns, "loop*", true) < 0)
+        {
+            exit(EXIT_FAILURE);
+        }
+        if (name_patterns_add(&disk_patterns, "ram*", true) < 0)
+        {
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    // Opened once and re-read every tick
+    struct preader diskstats_reader;
+    if (preader_open(&diskstats_reader, "/proc/diskstats") < 0)
+    {
+        exit(EXIT_FAILURE);
+    }
+
+    if (sampling_daemon_remove_at_exit(dest_path, shm_path) < 0)
+    {
+        exit(EXIT_FAILURE);
+    }
+
+    ACFD(dest_fd) = -1;
+
+    if (dest_path != nullptr)
+    {
+        constexpr mode_t new_mask = 0o133; // rw-r--r--
+        (void)umask(new_mask);
+
+        // Opened once and kept open for the life of the daemon: writing
+        // through this fd every tick (below) is immune to dest_path being
+        // later replaced with a symlink, since a fd is bound to the
+        // underlying inode, not the path.
+        dest_fd = open(dest_path, O_WRONLY | O_CREAT | O_EXCL, 0o666);
+        if (dest_fd < 0)
+        {
+            err(EXIT_FAILURE, "%s", dest_path);
+        }
+    }
+
+    struct sample_shm shm = {-1, 0, nullptr, nullptr, 0, 0, 0};
+
+    // reads, writes, read bytes, write bytes, and util
+    constexpr uint32_t num_values = 5;
+
+    if (shm_path != nullptr && sample_shm_create(&shm, shm_path, num_values, shm_capacity) < 0)
+    {
+        exit(EXIT_FAILURE);
+    }
+
+    sigset_t empty_mask;
+    sigset_t orig_mask;
+    if (sampling_daemon_handle_signals(&empty_mask, &orig_mask) < 0)
+    {
+        exit(EXIT_FAILURE);
+    }
+
+    struct deadline_timer timer = {-1, {0, 0}, {0, 0}};
+    if (deadline_timer_open(&timer, init_delay_msec, interval_msec) < 0)
+    {
+        exit(EXIT_FAILURE);
+    }
+
+    bool first_iteration = true;
+    uint64_t prev_now_ns = 0;
+    struct disk_table prev_table = {nullptr, 0, 0};
+    struct disk_table cur_table = {nullptr, 0, 0};
+    char* disks_buf = nullptr;
+    size_t disks_buf_size = 0;
+
+    do
+    {
+        if (sampling_daemon_reset_timer)
+        {
+            if (deadline_timer_start(&timer) < 0)
+            {
+                exit(EXIT_FAILURE);
+            }
+            sampling_daemon_reset_timer = 0;
+        }
+
+        struct timespec now_ts;
+
+        if (clock_gettime(CLOCK_MONOTONIC, &now_ts) < 0)
+        {
+            err(EXIT_FAILURE, "clock_gettime");
+        }
+
+        const uint64_t now_ns = ts_to_ns(&now_ts);
+
+        if (scan_diskstats(&diskstats_reader, &cur_table, &prev_table) < 0)
+        {
+            errx(EXIT_FAILURE, "error scanning /proc/diskstats");
+        }
+
+        // name, 4 rates, util, and a newline per device, and the empty line
+        const size_t needed_buf_size = cur_table.num_disks * (32 + 4 * 21 + 10) + 2;
+        if (disks_buf_size < needed_buf_size)
+        {
+            char* buf = (char*)realloc(disks_buf, needed_buf_size);
+            if (buf == nullptr)
+            {
+                err(EXIT_FAILURE, "realloc");
+            }
+            disks_buf = buf;
+            disks_buf_size = needed_buf_size;
+        }
+
+        if (first_iteration)
+        {
+            first_iteration = false;
+        }
+        else
+        {
+            const uint64_t delta_time_ns = now_ns - prev_now_ns;
+            double values[num_values] = {0, 0, 0, 0, 0};
+            size_t len = 0;
+
+            for (size_t i = 0; i < cur_table.num_disks; ++i)
+            {
+                const struct disk* cur = &cur_table.disks[i];
+
+                if (!disk_is_selected(cur))
+                {
+                    continue;
+                }
+
+                // A device that was just added is measured from the next tick.
+                const size_t j = disk_find(&prev_table, cur->major, cur->minor, i);
+                if (j == prev_table.num_disks)
+                {
+                    continue;
+                }
+
+                const struct disk* prev = &prev_table.disks[j];
+
+                const uintmax_t rates[4] = {
+                    counter_rate(cur->reads, prev->reads, delta_time_ns),
+                    counter_rate(cur->writes, prev->writes, delta_time_ns),
+                    counter_rate(cur->read_bytes, prev->read_bytes, delta_time_ns),
+                    counter_rate(cur->write_bytes, prev->write_bytes, delta_time_ns),
+                };
+
+                double util = 0;
+                if (delta_time_ns != 0 && cur->io_ticks_ms >= prev->io_ticks_ms)
+                {
+                    util = (double)(cur->io_ticks_ms - prev->io_ticks_ms) * 1E6 / (double)delta_time_ns;
+                    if (util > 1)
+                    {
+                        util = 1;
+                    }
+                }
+
+                for (size_t k = 0; k < 4; ++k)
+                {
+                    values[k] += (double)rates[k];
+                }
+                if (values[4] < util)
+                {
+                    values[4] = util;
+                }
+
+                const int line_len = snprintf(disks_buf + len, disks_buf_size - len,
+                                              "%s %ju %ju %ju %ju %.6f\n", cur->name,
+                                              rates[0], rates[1], rates[2], rates[3], util);
+                if (line_len < 0 || (size_t)line_len >= disks_buf_size - len)
+                {
+                    break;
+                }
+                len += (size_t)line_len;
+            }
+
+            if (shm_path != nullptr)
+            {
+                sample_shm_write(&shm, now_ns, values);
+            }
+
+            if (dest_path == nullptr)
+            {
+                disks_buf[len++] = '\n';
+            }
+            if (sampling_daemon_write(dest_fd, disks_buf, len) < 0)
+            {
+                exit(EXIT_FAILURE);
+            }
+        }
+
+        const struct disk_table tmp = prev_table;
+        prev_table = cur_table;
+        cur_table = tmp;
+        prev_now_ns = now_ns;
+
+        if (!sampling_daemon_done)
+        {
+            // Wait for the next deadline (or a signal) with the signals unblocked.
+            // Missed deadlines are not made up: the rates use the actual elapsed time.
+            if (deadline_timer_wait(&timer, &empty_mask) < 0)
+            {
+                exit(EXIT_FAILURE);
+            }
+        }
+    }
+    while (!sampling_daemon_done);
+
+    deadline_timer_close(&timer);
+    preader_close(&diskstats_reader);
+    free(prev_table.disks);
+    free(cur_table.disks);
+    free(disks_buf);
+    sample_shm_close(&shm);
+
+    if (sigprocmask(SIG_SETMASK, &orig_mask, nullptr) < 0)
+    {
+        err(EXIT_FAILURE, "sigprocmask");
+    }
+
+    return EXIT_SUCCESS;
+}
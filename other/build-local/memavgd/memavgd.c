@@ -0,0 +1,348 @@
+// SPDX-FileCopyrightText: Steven Ward
+// SPDX-License-Identifier: MPL-2.0
+
+#include "acfile.h"
+#include "deadline_timer.h"
+#include "preader.h"
+#include "sample_shm.h"
+#include "sampling_daemon.h"
+#include "strtou.h"
+#include "ts_to_ns.h"
+
+#include <err.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+// {{{ memory usage
+
+// The fields of /proc/meminfo that are measured
+enum meminfo_field
+{
+    MEM_TOTAL,
+    MEM_AVAILABLE,
+    SWAP_TOTAL,
+    SWAP_FREE,
+    NUM_MEMINFO_FIELDS,
+};
+
+const char* const meminfo_keys[NUM_MEMINFO_FIELDS] = {
+    "MemTotal:",
+    "MemAvailable:",
+    "SwapTotal:",
+    "SwapFree:",
+};
+
+/// Scan the measured fields (in kibibytes) of /proc/meminfo
+/**
+* \retval 0 success
+* \retval -1 failure (e.g. a field is missing)
+*/
+int
+scan_meminfo(struct preader* reader, uint64_t fields[NUM_MEMINFO_FIELDS])
+{
+    if (preader_read(reader) < 0)
+    {
+        return -1;
+    }
+
+    const char* p = reader->buf;
+    const char* const last = p + reader->len;
+    size_t num_found = 0;
+
+    while (p < last && num_found < NUM_MEMINFO_FIELDS)
+    {
+        // MemTotal:        6158152 kB
+        for (size_t i = 0; i < NUM_MEMINFO_FIELDS; ++i)
+        {
+            const size_t key_len = strlen(meminfo_keys[i]);
+
+            if ((size_t)(last - p) > key_len && memcmp(p, meminfo_keys[i], key_len) == 0)
+            {
+                p += key_len;
+                if (!scan_u64(&p, last, &fields[i]))
+                {
+                    return -1;
+                }
+                ++num_found;
+                break;
+            }
+        }
+
+        if (!scan_next_line(&p, last))
+        {
+            break;
+        }
+    }
+
+    // MemAvailable exists since Linux 3.14.
+    return (num_found == NUM_MEMINFO_FIELDS) ? 0 : -1;
+}
+
+/// Get the fraction of \a total that is not \a available
+double
+used_fraction(uint64_t available, uint64_t total)
+{
+    if (total == 0 || available >= total)
+    {
+        return 0;
+    }
+
+    return 1 - (double)available / (double)total;
+}
+
+// }}}
+
+const char* const program_author = "Steven Ward";
+const char* const program_version = "1.0.0";
+const char* const program_license = "MPL-2.0";
+
+constexpr unsigned int default_init_delay_msec = 1000;
+constexpr unsigned int default_interval_msec = 1000;
+constexpr unsigned int default_shm_capacity = 256;
+
+const char* dest_path = nullptr;
+const char* shm_path = nullptr;
+
+uint64_t
+get_monotonic_ns()
+{
+    struct timespec now_ts;
+
+    if (clock_gettime(CLOCK_MONOTONIC, &now_ts) < 0)
+    {
+        err(EXIT_FAILURE, "clock_gettime");
+    }
+
+    return ts_to_ns(&now_ts);
+}
+
+void
+print_version()
+{
+    printf("%s %s\n", program_invocation_short_name, program_version);
+    printf("License: %s\n", program_license);
+    printf("Written by %s\n", program_author);
+}
+
+void
+print_usage()
+{
+    printf("Usage: %s [OPTION]...\n", program_invocation_short_name);
+    printf("\n");
+    printf("Continuously measure the memory usage at a regular interval, and write the measurement to stdout or a temporary file.\n");
+    printf("\n");
+    printf("Every measurement is a line:\n");
+    printf("  USED SWAP AVAILABLE\n");
+    printf("USED is the fraction of memory that is not available (1 - MemAvailable / MemTotal).\n");
+    printf("SWAP is the fraction of swap that is used (0 if there is no swap).\n");
+    printf("Each is a real number within the interval [0, 1].\n");
+    printf("AVAILABLE is MemAvailable (in bytes).\n");
+    printf("\n");
+    printf("The shared-memory file (see sample_shm.h) holds USED, SWAP, and AVAILABLE.\n");
+    printf("\n");
+
+    printf("OPTIONS\n");
+    printf("  -V       Print the version information, then exit.\n");
+    printf("\n");
+    printf("  -h       Print this message, then exit.\n");
+    printf("\n");
+    printf("  -f FILE  Specify the temporary output file.\n");
+    printf("           FILE must not exist when this daemon starts.\n");
+    printf("           FILE is truncated before every measurement is written.\n");
+    printf("           FILE is removed when this daemon exits successfully.\n");
+    printf("\n");
+    printf("  -i MSEC  Specify the interval (in milliseconds) between measurements.\n");
+    printf("           MSEC must be a positive integer.\n");
+    printf("           The default value is %u.\n", default_interval_msec);
+    printf("\n");
+    printf("  -m FILE  Also write every measurement to the shared-memory file FILE.\n");
+    printf("           FILE must not exist when this daemon starts.\n");
+    printf("           FILE is removed when this daemon exits successfully.\n");
+    printf("\n");
+    printf("  -N NUM   Specify the number of measurements kept in the shared-memory file.\n");
+    printf("           NUM must be a positive integer.\n");
+    printf("           The default value is %u.\n", default_shm_capacity);
+    printf("\n");
+}
+
+int
+main([[maybe_unused]] int argc, [[maybe_unused]] char* argv[])
+{
+    unsigned int init_delay_msec = default_init_delay_msec;
+    unsigned int interval_msec = default_interval_msec;
+    unsigned int shm_capacity = default_shm_capacity;
+
+    int oc = 0;
+    const char* short_options = "+:Vhf:i:m:N:";
+    while ((oc = getopt(argc, argv, short_options)) != -1)
+    {
+        switch (oc)
+        {
+        case 'V':
+            print_version();
+            return EXIT_SUCCESS;
+
+        case 'h':
+            print_usage();
+            return EXIT_SUCCESS;
+
+        case 'f':
+            dest_path = optarg;
+            break;
+
+        case 'i':
+            interval_msec = strtou(optarg);
+            if (interval_msec == 0)
+            {
+                errx(EXIT_FAILURE, "invalid interval: %u", interval_msec);
+            }
+
+            // There is no option for specifying the initial delay.
+            init_delay_msec = interval_msec;
+            break;
+
+        case 'm':
+            shm_path = optarg;
+            break;
+
+        case 'N':
+            shm_capacity = strtou(optarg);
+            if (shm_capacity == 0)
+            {
+                errx(EXIT_FAILURE, "invalid number of measurements: %u", shm_capacity);
+            }
+            break;
+
+        default:
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    // Opened once and re-read every tick
+    struct preader meminfo_reader;
+    if (preader_open(&meminfo_reader, "/proc/meminfo") < 0)
+    {
+        exit(EXIT_FAILURE);
+    }
+
+    if (sampling_daemon_remove_at_exit(dest_path, shm_path) < 0)
+    {
+        exit(EXIT_FAILURE);
+    }
+
+    ACFD(dest_fd) = -1;
+
+    if (dest_path != nullptr)
+    {
+        constexpr mode_t new_mask = 0o133; // rw-r--r--
+        (void)umask(new_mask);
+
+        // Opened once and kept open for the life of the daemon: writing
+        // through this fd every tick (below) is immune to dest_path being
+        // later replaced with a symlink, since a fd is bound to the
+        // underlying inode, not the path.
+        dest_fd = open(dest_path, O_WRONLY | O_CREAT | O_EXCL, 0o666);
+        if (dest_fd < 0)
+        {
+            err(EXIT_FAILURE, "%s", dest_path);
+        }
+    }
+
+    struct sample_shm shm = {-1, 0, nullptr, nullptr, 0, 0, 0};
+
+    // used, swap, and available
+    constexpr uint32_t num_values = 3;
+
+    if (shm_path != nullptr && sample_shm_create(&shm, shm_path, num_values, shm_capacity) < 0)
+    {
+        exit(EXIT_FAILURE);
+    }
+
+    sigset_t empty_mask;
+    sigset_t orig_mask;
+    if (sampling_daemon_handle_signals(&empty_mask, &orig_mask) < 0)
+    {
+        exit(EXIT_FAILURE);
+    }
+
+    struct deadline_timer timer = {-1, {0, 0}, {0, 0}};
+    if (deadline_timer_open(&timer, init_delay_msec, interval_msec) < 0)
+    {
+        exit(EXIT_FAILURE);
+    }
+
+    uint64_t fields[NUM_MEMINFO_FIELDS];
+
+    do
+    {
+        if (sampling_daemon_reset_timer)
+        {
+            if (deadline_timer_start(&timer) < 0)
+            {
+                exit(EXIT_FAILURE);
+            }
+            sampling_daemon_reset_timer = 0;
+        }
+
+        if (scan_meminfo(&meminfo_reader, fields) < 0)
+        {
+            errx(EXIT_FAILURE, "error scanning /proc/meminfo");
+        }
+
+        // Memory is a level, not a counter, so every iteration is a measurement.
+        const uint64_t available_bytes = fields[MEM_AVAILABLE] * 1024;
+        const double values[num_values] = {
+            used_fraction(fields[MEM_AVAILABLE], fields[MEM_TOTAL]),
+            used_fraction(fields[SWAP_FREE], fields[SWAP_TOTAL]),
+            (double)available_bytes,
+        };
+
+        if (shm_path != nullptr)
+        {
+            sample_shm_write(&shm, get_monotonic_ns(), values);
+        }
+
+        char dest_buf[64] = {'\0'};
+        int dest_len = snprintf(dest_buf, sizeof(dest_buf), "%.6f %.6f %ju",
+                                values[0], values[1], (uintmax_t)available_bytes);
+
+        if (dest_path == nullptr)
+        {
+            dest_buf[dest_len++] = '\n';
+        }
+        if (sampling_daemon_write(dest_fd, dest_buf, (size_t)dest_len) < 0)
+        {
+            exit(EXIT_FAILURE);
+        }
+
+        if (!sampling_daemon_done)
+        {
+            // Wait for the next deadline (or a signal) with the signals unblocked.
+            // Missed deadlines are not made up.
+            if (deadline_timer_wait(&timer, &empty_mask) < 0)
+            {
+                exit(EXIT_FAILURE);
+            }
+        }
+    }
+    while (!sampling_daemon_done);
+
+    deadline_timer_close(&timer);
+    preader_close(&meminfo_reader);
+    sample_shm_close(&shm);
+
+    if (sigprocmask(SIG_SETMASK, &orig_mask, nullptr) < 0)
+    {
+        err(EXIT_FAILURE, "sigprocmask");
+    }
+
+    return EXIT_SUCCESS;
+}
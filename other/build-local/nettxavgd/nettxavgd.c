@@ -2,15 +2,18 @@
 // SPDX-License-Identifier: MPL-2.0
 
 #include "acfile.h"
-#include "pscanf.h"
+#include "counter_rate.h"
+#include "deadline_timer.h"
+#include "name_patterns.h"
+#include "preader.h"
+#include "rtnl_link_stats.h"
+#include "sample_shm.h"
+#include "sampling_daemon.h"
 #include "strtou.h"
-#include "timespec.h"
-#include "timeval.h"
+#include "ts_to_ns.h"
 
-#include <assert.h>
 #include <dirent.h>
 #include <err.h>
-#include <errno.h>
 #include <fcntl.h>
 #include <limits.h>
 #include <signal.h>
@@ -20,7 +23,6 @@
 #include <stdlib.h>
 #include <string.h>
 #include <sys/stat.h>
-#include <sys/time.h>
 #include <time.h>
 #include <unistd.h>
 
@@ -34,49 +36,20 @@ scandir_filter(const struct dirent* dirent)
 }
 
 const char* const program_author = "Steven Ward";
-const char* const program_version = "1.2.2";
+const char* const program_version = "1.5.1";
 const char* const program_license = "MPL-2.0";
 
 constexpr unsigned int default_init_delay_msec = 2000;
 constexpr unsigned int default_interval_msec = 2000;
+constexpr unsigned int default_shm_capacity = 256;
 char default_net_iface[NAME_MAX + 1] = {'\0'};
 
 const char* dest_path = nullptr;
+const char* shm_path = nullptr;
 
-volatile sig_atomic_t done = 0;
-volatile sig_atomic_t reset_alarm = 1;
-
-void
-signal_handler(int signum)
-{
-    switch (signum)
-    {
-    case SIGALRM:
-        // no op
-        break;
-
-    case SIGUSR1:
-    case SIGUSR2:
-        reset_alarm = 1;
-        break;
-
-    default:
-        done = 1;
-        break;
-    }
-}
-
-void
-atexit_cleanup()
-{
-    if (dest_path != nullptr && done)
-    {
-        if (remove(dest_path) < 0)
-        {
-            perror("remove");
-        }
-    }
-}
+// all-interfaces mode
+bool all_ifaces = false;
+struct name_patterns iface_patterns;
 
 void
 set_default_net_iface()
@@ -85,13 +58,10 @@ set_default_net_iface()
     int n = 0;
 
     n = scandir("/sys/class/net/", &namelist, scandir_filter, alphasort);
-    if (n == -1)
-    {
-        err(EXIT_FAILURE, "scandir");
-    }
-    if (n == 0)
+    if (n <= 0)
     {
-        errx(EXIT_FAILURE, "no network interface found in /sys/class/net/");
+        // Only the single-interface mode needs it.
+        return;
     }
 
     (void)strncpy(default_net_iface, namelist[0]->d_name, sizeof(default_net_iface));
@@ -104,6 +74,13 @@ set_default_net_iface()
     free((void*)namelist);
 }
 
+/// Is the interface \a name selected by the include and exclude patterns?
+bool
+iface_is_selected(const char* name)
+{
+    return name_patterns_match(&iface_patterns, name);
+}
+
 void
 print_version()
 {
@@ -121,12 +98,27 @@ print_usage()
     printf("\n");
     printf("The unit of measurement of network speed is bytes/second.\n");
     printf("\n");
+    printf("In all-interfaces mode, the statistics of every network interface are read with one rtnetlink dump, and every measurement is a line for every selected interface:\n");
+    printf("  NAME BYTES PACKETS ERRORS DROPPED\n");
+    printf("Each is a rate (per second).\n");
+    printf("On stdout, measurements are separated by an empty line.\n");
+    printf("The shared-memory file holds the sums of the 4 rates over the selected interfaces.\n");
+    printf("\n");
 
     printf("OPTIONS\n");
     printf("  -V       Print the version information, then exit.\n");
     printf("\n");
     printf("  -h       Print this message, then exit.\n");
     printf("\n");
+    printf("  -a       Measure every network interface (all-interfaces mode).\n");
+    printf("\n");
+    printf("  -I GLOB  In all-interfaces mode, measure only the interfaces whose names match GLOB.\n");
+    printf("           This option may be given up to %d times.\n", NAME_PATTERNS_MAX);
+    printf("\n");
+    printf("  -X GLOB  In all-interfaces mode, do not measure the interfaces whose names match GLOB.\n");
+    printf("           This option may be given up to %d times.\n", NAME_PATTERNS_MAX);
+    printf("           Exclusion takes precedence over inclusion.\n");
+    printf("\n");
     printf("  -f FILE  Specify the temporary output file.\n");
     printf("           FILE must not exist when this daemon starts.\n");
     printf("           FILE is truncated before every measurement is written.\n");
@@ -136,6 +128,14 @@ print_usage()
     printf("           MSEC must be a positive integer.\n");
     printf("           The default value is %u.\n", default_interval_msec);
     printf("\n");
+    printf("  -m FILE  Also write every measurement to the shared-memory file FILE (see sample_shm.h).\n");
+    printf("           FILE must not exist when this daemon starts.\n");
+    printf("           FILE is removed when this daemon exits successfully.\n");
+    printf("\n");
+    printf("  -N NUM   Specify the number of measurements kept in the shared-memory file.\n");
+    printf("           NUM must be a positive integer.\n");
+    printf("           The default value is %u.\n", default_shm_capacity);
+    printf("\n");
     printf("  -n NET   Specify the network interface.\n");
     printf("           NET is a name found in /sys/class/net/.\n");
     printf("           The default value is \"%s\".\n", default_net_iface);
@@ -149,9 +149,11 @@ main([[maybe_unused]] int argc, [[maybe_unused]] char* argv[])
     unsigned int init_delay_msec = default_init_delay_msec;
     unsigned int interval_msec = default_interval_msec;
     char* net_iface = default_net_iface;
+    char net_iface_path[PATH_MAX] = {'\0'};
+    unsigned int shm_capacity = default_shm_capacity;
 
     int oc = 0;
-    const char* short_options = "+:Vhf:i:n:";
+    const char* short_options = "+:VhaI:X:f:i:m:N:n:";
     while ((oc = getopt(argc, argv, short_options)) != -1)
     {
         switch (oc)
@@ -164,6 +166,24 @@ main([[maybe_unused]] int argc, [[maybe_unused]] char* argv[])
             print_usage();
             return EXIT_SUCCESS;
 
+        case 'a':
+            all_ifaces = true;
+            break;
+
+        case 'I':
+            if (name_patterns_add(&iface_patterns, optarg, false) < 0)
+            {
+                exit(EXIT_FAILURE);
+            }
+            break;
+
+        case 'X':
+            if (name_patterns_add(&iface_patterns, optarg, true) < 0)
+            {
+                exit(EXIT_FAILURE);
+            }
+            break;
+
         case 'f':
             dest_path = optarg;
             break;
@@ -179,6 +199,18 @@ main([[maybe_unused]] int argc, [[maybe_unused]] char* argv[])
             init_delay_msec = interval_msec;
             break;
 
+        case 'm':
+            shm_path = optarg;
+            break;
+
+        case 'N':
+            shm_capacity = strtou(optarg);
+            if (shm_capacity == 0)
+            {
+                errx(EXIT_FAILURE, "invalid number of measurements: %u", shm_capacity);
+            }
+            break;
+
         case 'n':
             net_iface = optarg;
             break;
@@ -188,33 +220,51 @@ main([[maybe_unused]] int argc, [[maybe_unused]] char* argv[])
         }
     }
 
-    if (strchr(net_iface, '/') != nullptr)
+    // Opened once and re-read every tick
+    struct preader bytes_reader = {nullptr, -1, nullptr, 0, 0};
+    struct rtnl_link_rates link_rates = {.dumper = {.fd = -1}};
+
+    if (all_ifaces)
     {
-        errx(EXIT_FAILURE, "invalid network interface: '%s'", net_iface);
+        if (rtnl_link_rates_open(&link_rates, RTNL_LINK_TX) < 0)
+        {
+            exit(EXIT_FAILURE);
+        }
     }
+    else
+    {
+        // The default network interface is empty if only lo was found.
+        if (net_iface == default_net_iface && *net_iface == '\0')
+        {
+            errx(EXIT_FAILURE, "no network interface found in /sys/class/net/");
+        }
 
-    // {{{ Adapted from my slstatus
-    // https://github.com/planet36/slstatus/blob/main/components/netspeeds.c
-    char net_iface_path[PATH_MAX] = {'\0'};
-    int n = snprintf(net_iface_path, sizeof(net_iface_path),
-                     "/sys/class/net/%s/statistics/tx_bytes", net_iface);
+        if (strchr(net_iface, '/') != nullptr || *net_iface == '\0')
+        {
+            errx(EXIT_FAILURE, "invalid network interface: '%s'", net_iface);
+        }
 
-    if (n < 0 || (size_t)n >= sizeof(net_iface_path))
-    {
-        errx(EXIT_FAILURE, "snprintf");
-    }
-    // }}}
+        // {{{ Adapted from my slstatus
+        // https://github.com/planet36/slstatus/blob/main/components/netspeeds.c
+        const int n = snprintf(net_iface_path, sizeof(net_iface_path),
+                               "/sys/class/net/%s/statistics/tx_bytes", net_iface);
 
-    // Test if file is readable
-    {
-        ACFILEPTR(fp) = fopen(net_iface_path, "r");
-        if (fp == nullptr)
+        if (n < 0 || (size_t)n >= sizeof(net_iface_path))
         {
-            err(EXIT_FAILURE, "%s", net_iface_path);
+            errx(EXIT_FAILURE, "snprintf");
+        }
+        // }}}
+
+        if (preader_open(&bytes_reader, net_iface_path) < 0)
+        {
+            exit(EXIT_FAILURE);
         }
     }
 
-    assert(atexit(atexit_cleanup) == 0);
+    if (sampling_daemon_remove_at_exit(dest_path, shm_path) < 0)
+    {
+        exit(EXIT_FAILURE);
+    }
 
     ACFD(dest_fd) = -1;
 
@@ -234,77 +284,41 @@ main([[maybe_unused]] int argc, [[maybe_unused]] char* argv[])
         }
     }
 
-    struct sigaction signal_action;
-    (void)memset(&signal_action, 0, sizeof(signal_action));
-    signal_action.sa_flags = SA_RESTART;
-    signal_action.sa_handler = signal_handler;
-
-    if (sigfillset(&signal_action.sa_mask) < 0)
-    {
-        err(EXIT_FAILURE, "sigfillset");
-    }
+    struct sample_shm shm = {-1, 0, nullptr, nullptr, 0, 0, 0};
 
-    constexpr int signals_to_handle[] = {
-        SIGALRM,
-        SIGHUP,
-        SIGINT,
-        SIGPIPE,
-        SIGQUIT,
-        SIGTERM,
-        SIGUSR1,
-        SIGUSR2,
-    };
-
-    constexpr size_t num_signals_to_handle =
-        sizeof(signals_to_handle) / sizeof(signals_to_handle[0]);
-    for (size_t i = 0; i < num_signals_to_handle; ++i)
+    // bytes, packets, errors, and dropped in all-interfaces mode
+    if (shm_path != nullptr &&
+        sample_shm_create(&shm, shm_path, all_ifaces ? RTNL_LINK_NUM_RATES : 1, shm_capacity) < 0)
     {
-        if (sigaction(signals_to_handle[i], &signal_action, nullptr) < 0)
-        {
-            err(EXIT_FAILURE, "sigaction");
-        }
+        exit(EXIT_FAILURE);
     }
 
     sigset_t empty_mask;
-    if (sigemptyset(&empty_mask) < 0)
-    {
-        err(EXIT_FAILURE, "sigemptyset");
-    }
-
-    sigset_t full_mask;
-    if (sigfillset(&full_mask) < 0)
+    sigset_t orig_mask;
+    if (sampling_daemon_handle_signals(&empty_mask, &orig_mask) < 0)
     {
-        err(EXIT_FAILURE, "sigfillset");
+        exit(EXIT_FAILURE);
     }
 
-    sigset_t orig_mask;
-    // block everything and save current signal mask
-    if (sigprocmask(SIG_BLOCK, &full_mask, &orig_mask) < 0)
+    struct deadline_timer timer = {-1, {0, 0}, {0, 0}};
+    if (deadline_timer_open(&timer, init_delay_msec, interval_msec) < 0)
     {
-        err(EXIT_FAILURE, "sigprocmask");
+        exit(EXIT_FAILURE);
     }
 
-    const struct timeval init_delay = msec_to_timeval(init_delay_msec);
-    const struct timeval interval = msec_to_timeval(interval_msec);
-
-    const struct itimerval itv = {
-        .it_interval = interval,
-        .it_value = init_delay, // If zero, the alarm is disabled.
-    };
-
     bool first_iteration = true;
-    double prev_now_s = 0;
+    uint64_t prev_now_ns = 0;
     uintmax_t prev_tx_bytes = 0;
 
     do
     {
-        if (reset_alarm)
+        if (sampling_daemon_reset_timer)
         {
-            if (setitimer(ITIMER_REAL, &itv, nullptr) < 0)
+            if (deadline_timer_start(&timer) < 0)
             {
-                err(EXIT_FAILURE, "setitimer");
+                exit(EXIT_FAILURE);
             }
-            reset_alarm = 0;
+            sampling_daemon_reset_timer = 0;
         }
 
         struct timespec now_ts;
@@ -314,72 +328,93 @@ main([[maybe_unused]] int argc, [[maybe_unused]] char* argv[])
             err(EXIT_FAILURE, "clock_gettime");
         }
 
-        const double now_s = timespec_to_sec(&now_ts);
-
-        uintmax_t tx_bytes = 0;
+        const uint64_t now_ns = ts_to_ns(&now_ts);
 
-        if (pscanf(net_iface_path, "%ju", &tx_bytes) != 1)
+        if (all_ifaces)
         {
-            errx(EXIT_FAILURE, "error scanning '%s'", net_iface_path);
-        }
+            const int measured = rtnl_link_rates_measure(&link_rates, now_ns, iface_is_selected);
+            if (measured < 0)
+            {
+                errx(EXIT_FAILURE, "error dumping the network interfaces");
+            }
 
-        if (first_iteration)
-        {
-            first_iteration = false;
+            if (measured > 0)
+            {
+                if (shm_path != nullptr)
+                {
+                    sample_shm_write(&shm, now_ns, link_rates.sums);
+                }
+
+                size_t len = link_rates.text_len;
+                if (dest_path == nullptr)
+                {
+                    link_rates.text[len++] = '\n';
+                }
+                if (sampling_daemon_write(dest_fd, link_rates.text, len) < 0)
+                {
+                    exit(EXIT_FAILURE);
+                }
+            }
         }
         else
         {
-            const double delta_time_s = now_s - prev_now_s;
+            uint64_t tx_bytes = 0;
 
-            uintmax_t tx_bytes_per_s = 0;
+            if (preader_read_u64(&bytes_reader, &tx_bytes) < 0)
+            {
+                errx(EXIT_FAILURE, "error scanning '%s'", net_iface_path);
+            }
 
-            // tx_bytes can be less than prev_tx_bytes if the interface's
-            // counter was reset (e.g. link down/up); treat that tick as 0
-            // instead of letting the unsigned subtraction wrap around to a
-            // huge value that could overflow the cast back to uintmax_t.
-            if (delta_time_s != 0 && tx_bytes >= prev_tx_bytes)
+            if (first_iteration)
             {
-                // round to nearest int
-                tx_bytes_per_s =
-                    (uintmax_t)((double)(tx_bytes - prev_tx_bytes) / delta_time_s + 0.5);
+                first_iteration = false;
             }
+            else
+            {
+                const uint64_t delta_time_ns = now_ns - prev_now_ns;
 
-            char dest_buf[32] = {'\0'};
-            const int dest_len = snprintf(dest_buf, sizeof(dest_buf), "%ju", tx_bytes_per_s);
+                const uintmax_t tx_bytes_per_s = counter_rate(tx_bytes, prev_tx_bytes, delta_time_ns);
 
-            if (dest_path != nullptr)
-            {
-                if (lseek(dest_fd, 0, SEEK_SET) < 0)
+                if (shm_path != nullptr)
                 {
-                    err(EXIT_FAILURE, "lseek");
+                    const double value = (double)tx_bytes_per_s;
+                    sample_shm_write(&shm, now_ns, &value);
                 }
 
-                if (write(dest_fd, dest_buf, (size_t)dest_len) < 0)
+                char dest_buf[32] = {'\0'};
+                int dest_len = snprintf(dest_buf, sizeof(dest_buf), "%ju", tx_bytes_per_s);
+
+                if (dest_path == nullptr)
                 {
-                    err(EXIT_FAILURE, "write");
+                    dest_buf[dest_len++] = '\n';
                 }
-
-                // Discard any leftover tail from a longer previous write.
-                if (ftruncate(dest_fd, (off_t)dest_len) < 0)
+                if (sampling_daemon_write(dest_fd, dest_buf, (size_t)dest_len) < 0)
                 {
-                    err(EXIT_FAILURE, "ftruncate");
+                    exit(EXIT_FAILURE);
                 }
             }
-            else if (puts(dest_buf) < 0)
-            {
-                err(EXIT_FAILURE, "puts");
-            }
+
+            prev_tx_bytes = tx_bytes;
         }
 
-        prev_now_s = now_s;
-        prev_tx_bytes = tx_bytes;
+        prev_now_ns = now_ns;
 
-        if (!done)
+        if (!sampling_daemon_done)
         {
-            (void)sigsuspend(&empty_mask);
+            // Wait for the next deadline (or a signal) with the signals unblocked.
+            // Missed deadlines are not made up: the rates use the actual elapsed time.
+            if (deadline_timer_wait(&timer, &empty_mask) < 0)
+            {
+                exit(EXIT_FAILURE);
+            }
         }
     }
-    while (!done);
+    while (!sampling_daemon_done);
+
+    preader_close(&bytes_reader);
+    rtnl_link_rates_close(&link_rates);
+    deadline_timer_close(&timer);
+    sample_shm_close(&shm);
 
     if (sigprocmask(SIG_SETMASK, &orig_mask, nullptr) < 0)
     {
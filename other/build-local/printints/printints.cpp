@@ -22,108 +22,242 @@
 * The default TYPE is int32.
 */
 
+#include "i_to_chars.hpp"
+#include "line_reader.hpp"
+#include "parse_int.h"
+#include "perfect_hash_map.hpp"
+
+#include <array>
+#include <cerrno>
 #include <concepts>
 #include <cstddef>
 #include <cstdint>
 #include <cstdlib>
 #include <err.h>
-#include <iostream>
 #include <limits>
-#include <print>
 #include <stdexcept>
-#include <string>
+#include <string_view>
 #include <type_traits>
+#include <unistd.h>
+
+/// Output to stdout that is written once per block
+class output_buffer final
+{
+public:
+
+    output_buffer() = default;
+
+    // Disallow copying
+    output_buffer(const output_buffer&) = delete;
+    output_buffer& operator=(const output_buffer&) = delete;
+
+    // Disallow moving
+    output_buffer(output_buffer&&) = delete;
+    output_buffer& operator=(output_buffer&&) = delete;
+
+    ~output_buffer() { flush(); }
+
+    /// Get room for at least \a n characters
+    /**
+    * \pre \a n is at most the size of the buffer
+    */
+    [[nodiscard]] char* reserve(const std::size_t n)
+    {
+        if (size_ + n > std::size(buf_))
+        {
+            flush();
+        }
+        return std::data(buf_) + size_;
+    }
+
+    /// Mark the characters before \a end as written
+    void commit(const char* end)
+    {
+        size_ = static_cast<std::size_t>(end - std::data(buf_));
+    }
+
+    void flush()
+    {
+        std::size_t pos = 0;
+        while (pos < size_)
+        {
+            const ssize_t n = write(STDOUT_FILENO, std::data(buf_) + pos, size_ - pos);
+            if (n < 0)
+            {
+                if (errno == EINTR)
+                {
+                    continue;
+                }
+                err(EXIT_FAILURE, "write");
+            }
+            pos += static_cast<std::size_t>(n);
+        }
+        size_ = 0;
+    }
+
+private:
+
+    std::array<char, 64 * 1024> buf_{};
+    std::size_t size_ = 0;
+};
 
 template <std::unsigned_integral T>
 void
-print_uint(const T x)
+print_uint(const T x, output_buffer& out)
 {
-    constexpr std::size_t digits2 = std::numeric_limits<T>::digits;
-    // Get the ceiling of the integer division.
-    // For all standard T, digits2 is never evenly divisible by 3.
-    constexpr std::size_t digits8 = digits2 / 3 + 1; // == div_ceil(digits2, 3)
-    // For all standard T, digits2 is always evenly divisible by 4
-    constexpr std::size_t digits16 = digits2 / 4;
-
-    std::print("0b{:0{}b}", x, digits2);
-    std::print("\t0{:0{}o}", x, digits8);
-    std::print("\t0x{:0{}x}", x, digits16);
-    std::print("\t{:d}", x);
-
-    if (const auto i = static_cast<std::make_signed_t<T>>(x); i < 0)
+    using S = std::make_signed_t<T>;
+
+    // "0b" bin "\t0" oct "\t0x" hex "\t" dec "\t(" signed dec ")\n"
+    constexpr std::size_t max_line_size =
+        2 + bin_chars<T> + 2 + oct_chars<T> + 3 + hex_chars<T> + 1 + max_dec_chars<T> +
+        2 + max_dec_chars<S> + 2;
+
+    char* p = out.reserve(max_line_size);
+
+    *p++ = '0';
+    *p++ = 'b';
+    p = bin_to_chars_fixed(p, x);
+
+    *p++ = '\t';
+    *p++ = '0';
+    p = oct_to_chars_fixed(p, x);
+
+    *p++ = '\t';
+    *p++ = '0';
+    *p++ = 'x';
+    p = hex_to_chars_fixed(p, x);
+
+    *p++ = '\t';
+    p = dec_to_chars(p, x);
+
+    if (const auto i = static_cast<S>(x); i < 0)
     {
-        std::print("\t({:d})", i);
+        *p++ = '\t';
+        *p++ = '(';
+        p = dec_to_chars(p, i);
+        *p++ = ')';
     }
 
-    std::println("");
+    *p++ = '\n';
+
+    out.commit(p);
+}
+
+/// Throw the exception that \c std::stoull or \c std::stoll would throw for \a result
+void
+throw_if_parse_error(const int result, const char* what)
+{
+    if (result == EINVAL)
+    {
+        throw std::invalid_argument(what);
+    }
+
+    if (result == ERANGE)
+    {
+        throw std::out_of_range(what);
+    }
 }
 
 template <std::integral T>
 void
 read_write_int()
 {
-    for (std::string line; std::getline(std::cin, line); line.clear())
+    line_reader reader{STDIN_FILENO};
+    output_buffer out;
+
+    std::string_view line;
+
+    while (true)
     {
-        if (line.find_first_not_of(" \f\n\r\t\v") == std::string::npos)
+        // Write the output before (possibly) waiting for more input.
+        if (reader.available() == 0)
+        {
+            out.flush();
+        }
+
+        if (!reader.next(line))
+        {
+            break;
+        }
+
+        if (line.find_first_not_of(" \f\n\r\t\v") == std::string_view::npos)
         {
             continue;
         }
 
+        const char* const first = std::data(line);
+        const char* const last = first + std::size(line);
+
         try
         {
             if constexpr (std::is_unsigned_v<T>)
             {
-                const unsigned long long big_i = std::stoull(line, nullptr, 0);
+                uintmax_t big_i = 0;
+                throw_if_parse_error(parse_umax(first, last, 0, &big_i, nullptr), "parse_umax");
                 if (big_i > std::numeric_limits<T>::max())
                 {
                     throw std::out_of_range("value out of range for TYPE");
                 }
-                print_uint(static_cast<T>(big_i));
+                print_uint(static_cast<T>(big_i), out);
             }
             else
             {
-                const long long big_i = std::stoll(line, nullptr, 0);
+                intmax_t big_i = 0;
+                throw_if_parse_error(parse_imax(first, last, 0, &big_i, nullptr), "parse_imax");
                 if (big_i < std::numeric_limits<T>::min() ||
                     big_i > std::numeric_limits<T>::max())
                 {
                     throw std::out_of_range("value out of range for TYPE");
                 }
                 using U = std::make_unsigned_t<T>;
-                print_uint(static_cast<U>(static_cast<T>(big_i)));
+                print_uint(static_cast<U>(static_cast<T>(big_i)), out);
             }
         }
         catch (const std::invalid_argument& e)
         {
-            errx(EXIT_FAILURE, "%s: %s: %s", e.what(), "std::invalid_argument", line.c_str());
+            out.flush();
+            errx(EXIT_FAILURE, "%s: %s: %.*s", e.what(), "std::invalid_argument",
+                 static_cast<int>(std::size(line)), std::data(line));
         }
         catch (const std::out_of_range& e)
         {
-            errx(EXIT_FAILURE, "%s: %s: %s", e.what(), "std::out_of_range", line.c_str());
+            out.flush();
+            errx(EXIT_FAILURE, "%s: %s: %.*s", e.what(), "std::out_of_range",
+                 static_cast<int>(std::size(line)), std::data(line));
         }
     }
 }
 
+/// the function to call for each TYPE
+constexpr auto read_write_funcs = make_perfect_hash_map<void (*)()>({
+    {"int8"  , read_write_int<int8_t  >},
+    {"int16" , read_write_int<int16_t >},
+    {"int32" , read_write_int<int32_t >},
+    {"int64" , read_write_int<int64_t >},
+    {"uint8" , read_write_int<uint8_t >},
+    {"uint16", read_write_int<uint16_t>},
+    {"uint32", read_write_int<uint32_t>},
+    {"uint64", read_write_int<uint64_t>},
+});
+
 // NOLINTNEXTLINE(bugprone-exception-escape)
 int main([[maybe_unused]] int argc, [[maybe_unused]] char* argv[])
 {
-    std::string type_name = "int32";
+    std::string_view type_name = "int32";
 
     if (argc > 1)
     {
         type_name = argv[1];
     }
 
-    if      (type_name == "int8"  ) { read_write_int<int8_t  >(); }
-    else if (type_name == "int16" ) { read_write_int<int16_t >(); }
-    else if (type_name == "int32" ) { read_write_int<int32_t >(); }
-    else if (type_name == "int64" ) { read_write_int<int64_t >(); }
-    else if (type_name == "uint8" ) { read_write_int<uint8_t >(); }
-    else if (type_name == "uint16") { read_write_int<uint16_t>(); }
-    else if (type_name == "uint32") { read_write_int<uint32_t>(); }
-    else if (type_name == "uint64") { read_write_int<uint64_t>(); }
+    if (const auto* const read_write = read_write_funcs.find(type_name); read_write != nullptr)
+    {
+        (*read_write)();
+    }
     else
     {
-        errx(EXIT_FAILURE, "invalid input integer type: %s", type_name.c_str());
+        errx(EXIT_FAILURE, "invalid input integer type: %.*s",
+             static_cast<int>(std::size(type_name)), std::data(type_name));
     }
 
     return EXIT_SUCCESS;
@@ -0,0 +1,893 @@
+// SPDX-FileCopyrightText: Steven Ward
+// SPDX-License-Identifier: MPL-2.0
+
+#include "preader.h"
+#include "strtou.h"
+#include "timespec.h"
+#include "ts_to_ns.h"
+
+#include <dirent.h>
+#include <err.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <pwd.h>
+#include <regex.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <time.h>
+#include <unistd.h>
+
+const char* const program_author = "Steven Ward";
+const char* const program_version = "1.0.0";
+const char* const program_license = "MPL-2.0";
+
+constexpr unsigned int max_threads = 64;
+constexpr size_t cmdline_size = 4096;
+
+bool clear_screen = false;
+bool match_full = false;
+bool has_pattern = false;
+regex_t pattern;
+
+// {{{ scanning /proc
+
+/// A process, from /proc/PID/stat and the owner of /proc/PID
+struct proc
+{
+    pid_t pid;
+    pid_t ppid;
+    uid_t uid;
+    char state;
+    char comm[16]; // TASK_COMM_LEN
+    bool valid;    // false if the process is gone
+    bool matched;
+    uint64_t cpu_ticks; // utime + stime
+    uint64_t start_ticks;
+    uint64_t num_threads;
+    uint64_t rss_pages;
+    double cpu;    // percent of one CPU
+    char* cmdline; // in the cmdlines of the list (empty for a kernel thread or a zombie)
+};
+
+/// A growable array, reused by every scan
+struct proc_list
+{
+    struct proc* procs;
+    size_t num_procs;
+    size_t cap_procs;
+    char* cmdlines; // a slot of cmdline_size bytes per proc (in the order of the PIDs scanned)
+};
+
+struct pid_list
+{
+    pid_t* pids;
+    size_t num_pids;
+    size_t cap_pids;
+};
+
+/// List the PIDs in /proc with \c getdents64
+/**
+* \retval 0 success
+* \retval -1 failure (a warning is printed)
+*/
+int
+list_pids(int proc_fd, struct pid_list* list)
+{
+    if (lseek(proc_fd, 0, SEEK_SET) < 0)
+    {
+        warn("lseek");
+        return -1;
+    }
+
+    list->num_pids = 0;
+
+    // uint64_t, so the records are aligned
+    uint64_t buf[4096];
+
+    while (true)
+    {
+        const ssize_t n = getdents64(proc_fd, buf, sizeof(buf));
+        if (n < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            warn("getdents64");
+            return -1;
+        }
+        if (n == 0)
+        {
+            break;
+        }
+
+        for (ssize_t offset = 0; offset < n;)
+        {
+            const struct dirent64* d = (const struct dirent64*)((const char*)buf + offset);
+            offset += d->d_reclen;
+
+            if (d->d_type != DT_DIR)
+            {
+                continue;
+            }
+
+            const char* p = d->d_name;
+            const char* const last = p + strlen(d->d_name);
+            uint64_t pid = 0;
+
+            // Skip the names that are not PIDs (e.g. "self" and "sys").
+            if (!scan_u64(&p, last, &pid) || p != last || pid > INT32_MAX)
+            {
+                continue;
+            }
+
+            if (list->num_pids == list->cap_pids)
+            {
+                const size_t cap = (list->cap_pids == 0) ? 1024 : list->cap_pids * 2;
+                pid_t* pids = (pid_t*)realloc(list->pids, cap * sizeof(*pids));
+                if (pids == nullptr)
+                {
+                    warn("realloc");
+                    return -1;
+                }
+                list->pids = pids;
+                list->cap_pids = cap;
+            }
+
+            list->pids[list->num_pids++] = (pid_t)pid;
+        }
+    }
+
+    return 0;
+}
+
+/// Read the file \a name in the directory \a dir_fd into \a buf (null-terminated, and truncated to fit)
+/**
+* \return the length, or \c -1 on failure
+*/
+ssize_t
+read_file_at(int dir_fd, const char* name, char* buf, size_t buf_size)
+{
+    const int fd = openat(dir_fd, name, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        return -1;
+    }
+
+    size_t len = 0;
+
+    while (len < buf_size - 1)
+    {
+        const ssize_t n = read(fd, buf + len, buf_size - 1 - len);
+        if (n < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            (void)close(fd);
+            return -1;
+        }
+        if (n == 0)
+        {
+            break;
+        }
+        len += (size_t)n;
+    }
+
+    (void)close(fd);
+    buf[len] = '\0';
+    return (ssize_t)len;
+}
+
+/// Replace the null characters (between the arguments) of a command line with spaces
+/**
+* \return the length without trailing spaces
+*/
+size_t
+join_cmdline(char* buf, size_t len)
+{
+    for (size_t i = 0; i < len; ++i)
+    {
+        if (buf[i] == '\0')
+        {
+            buf[i] = ' ';
+        }
+    }
+
+    while (len > 0 && buf[len - 1] == ' ')
+    {
+        --len;
+    }
+    buf[len] = '\0';
+    return len;
+}
+
+/// Replace the control characters (e.g. newlines in arguments) of \a s with '?' (like ps)
+void
+replace_control_chars(char* s)
+{
+    for (; *s != '\0'; ++s)
+    {
+        if ((unsigned char)*s < 0x20 || *s == 0x7f)
+        {
+            *s = '?';
+        }
+    }
+}
+
+// The fields of /proc/PID/stat after the state (starting with ppid)
+enum stat_field
+{
+    STAT_PPID = 0,
+    STAT_UTIME = 10,
+    STAT_STIME = 11,
+    STAT_NUM_THREADS = 16,
+    STAT_STARTTIME = 18,
+    STAT_RSS = 20,
+    NUM_STAT_FIELDS = 21,
+};
+
+/// Scan /proc/PID/stat into \a proc
+/**
+* \retval false the file could not be parsed
+*/
+bool
+scan_stat(const char* buf, size_t len, struct proc* proc)
+{
+    // pid (comm) state ppid ...
+    // The comm can contain spaces and parentheses, so it ends at the last ')'.
+    const char* const open_paren = (const char*)memchr(buf, '(', len);
+    const char* const close_paren = (const char*)memrchr(buf, ')', len);
+    if (open_paren == nullptr || close_paren == nullptr || close_paren < open_paren)
+    {
+        return false;
+    }
+
+    size_t comm_len = (size_t)(close_paren - open_paren - 1);
+    if (comm_len >= sizeof(proc->comm))
+    {
+        comm_len = sizeof(proc->comm) - 1;
+    }
+    (void)memcpy(proc->comm, open_paren + 1, comm_len);
+    proc->comm[comm_len] = '\0';
+
+    const char* p = close_paren + 1;
+    const char* const last = buf + len;
+
+    scan_skip_blanks(&p, last);
+    if (p == last)
+    {
+        return false;
+    }
+    proc->state = *p++;
+
+    uint64_t values[NUM_STAT_FIELDS] = {0};
+
+    for (size_t i = 0; i < NUM_STAT_FIELDS; ++i)
+    {
+        switch (i)
+        {
+        case STAT_PPID:
+        case STAT_UTIME:
+        case STAT_STIME:
+        case STAT_NUM_THREADS:
+        case STAT_STARTTIME:
+        case STAT_RSS:
+            if (!scan_u64(&p, last, &values[i]))
+            {
+                return false;
+            }
+            break;
+
+        default:
+            // Some (e.g. priority and nice) can be negative.
+            if (!scan_skip_field(&p, last))
+            {
+                return false;
+            }
+            break;
+        }
+    }
+
+    proc->ppid = (pid_t)values[STAT_PPID];
+    proc->cpu_ticks = values[STAT_UTIME] + values[STAT_STIME];
+    proc->num_threads = values[STAT_NUM_THREADS];
+    proc->start_ticks = values[STAT_STARTTIME];
+    proc->rss_pages = values[STAT_RSS];
+
+    return true;
+}
+
+/// Scan the process \a pid into \a proc, and its command line into \a cmdline (of \c cmdline_size bytes)
+/**
+* The files are opened relative to the directory of the process, so they are all of the same process, even if the PID is reused.
+* Nothing is allocated.
+*/
+void
+scan_proc(int proc_fd, pid_t pid, struct proc* proc, char* cmdline)
+{
+    proc->pid = pid;
+    proc->valid = false;
+    proc->matched = !has_pattern;
+    proc->cmdline = cmdline;
+    cmdline[0] = '\0';
+
+    char name[16] = {'\0'};
+    (void)snprintf(name, sizeof(name), "%d", pid);
+
+    const int pid_fd = openat(proc_fd, name, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (pid_fd < 0)
+    {
+        // The process is gone.
+        return;
+    }
+
+    // The owner of /proc/PID is the effective UID of the process.
+    struct stat statbuf;
+    char buf[4096];
+    ssize_t len = 0;
+
+    if (fstat(pid_fd, &statbuf) < 0 ||
+        (len = read_file_at(pid_fd, "stat", buf, sizeof(buf))) <= 0 ||
+        !scan_stat(buf, (size_t)len, proc))
+    {
+        (void)close(pid_fd);
+        return;
+    }
+
+    proc->uid = statbuf.st_uid;
+    proc->valid = true;
+
+    // The command line is read here (not when it is printed), so it is of the same process.
+    len = read_file_at(pid_fd, "cmdline", cmdline, cmdline_size);
+    if (len > 0)
+    {
+        (void)join_cmdline(cmdline, (size_t)len);
+    }
+    else
+    {
+        cmdline[0] = '\0';
+    }
+
+    if (has_pattern)
+    {
+        if (match_full)
+        {
+            proc->matched = len > 0 && regexec(&pattern, cmdline, 0, nullptr, 0) == 0;
+        }
+        else
+        {
+            proc->matched = regexec(&pattern, proc->comm, 0, nullptr, 0) == 0;
+        }
+    }
+
+    (void)close(pid_fd);
+}
+
+/// The PIDs scanned by a thread
+struct shard
+{
+    int proc_fd;
+    const pid_t* pids;
+    struct proc* procs;
+    char* cmdlines;
+    size_t begin;
+    size_t end;
+};
+
+void*
+scan_shard(void* arg)
+{
+    const struct shard* shard = (const struct shard*)arg;
+
+    for (size_t i = shard->begin; i < shard->end; ++i)
+    {
+        scan_proc(shard->proc_fd, shard->pids[i], &shard->procs[i], shard->cmdlines + i * cmdline_size);
+    }
+
+    return nullptr;
+}
+
+/// Scan every process in \a pids into \a list, with \a num_threads threads
+/**
+* The PIDs are split into contiguous shards, and every thread writes only its shard, so there are no locks.
+* The processes that are gone are removed, so \a list is in the order of \a pids.
+*/
+void
+scan_procs(int proc_fd, const struct pid_list* pids, struct proc_list* list, unsigned int num_threads)
+{
+    if (list->cap_procs < pids->num_pids)
+    {
+        struct proc* procs = (struct proc*)realloc(list->procs, pids->num_pids * sizeof(*procs));
+        if (procs == nullptr)
+        {
+            err(EXIT_FAILURE, "realloc");
+        }
+        list->procs = procs;
+
+        char* cmdlines = (char*)realloc(list->cmdlines, pids->num_pids * cmdline_size);
+        if (cmdlines == nullptr)
+        {
+            err(EXIT_FAILURE, "realloc");
+        }
+        list->cmdlines = cmdlines;
+
+        list->cap_procs = pids->num_pids;
+    }
+
+    if (num_threads > pids->num_pids)
+    {
+        num_threads = (pids->num_pids == 0) ? 1 : (unsigned int)pids->num_pids;
+    }
+
+    struct shard shards[max_threads];
+    pthread_t threads[max_threads];
+
+    for (unsigned int t = 0; t < num_threads; ++t)
+    {
+        shards[t] = (struct shard){
+            .proc_fd = proc_fd,
+            .pids = pids->pids,
+            .procs = list->procs,
+            .cmdlines = list->cmdlines,
+            .begin = pids->num_pids * t / num_threads,
+            .end = pids->num_pids * (t + 1) / num_threads,
+        };
+    }
+
+    // This thread scans the first shard.
+    for (unsigned int t = 1; t < num_threads; ++t)
+    {
+        const int e = pthread_create(&threads[t], nullptr, scan_shard, &shards[t]);
+        if (e != 0)
+        {
+            errno = e;
+            err(EXIT_FAILURE, "pthread_create");
+        }
+    }
+
+    (void)scan_shard(&shards[0]);
+
+    for (unsigned int t = 1; t < num_threads; ++t)
+    {
+        const int e = pthread_join(threads[t], nullptr);
+        if (e != 0)
+        {
+            errno = e;
+            err(EXIT_FAILURE, "pthread_join");
+        }
+    }
+
+    size_t n = 0;
+    for (size_t i = 0; i < pids->num_pids; ++i)
+    {
+        if (list->procs[i].valid)
+        {
+            list->procs[n++] = list->procs[i];
+        }
+    }
+    list->num_procs = n;
+}
+
+int
+compare_pid(const void* a, const void* b)
+{
+    const pid_t x = ((const struct proc*)a)->pid;
+    const pid_t y = ((const struct proc*)b)->pid;
+    return (x > y) - (x < y);
+}
+
+/// Compute the CPU usage of every process in \a cur since \a prev (both sorted by PID)
+/**
+* A process that is not in \a prev (or whose PID was reused) started after the previous scan,
+* so all of its CPU time is since then.
+*/
+void
+compute_cpu_deltas(struct proc_list* cur, const struct proc_list* prev, double elapsed_ticks)
+{
+    size_t j = 0;
+
+    for (size_t i = 0; i < cur->num_procs; ++i)
+    {
+        struct proc* c = &cur->procs[i];
+
+        while (j < prev->num_procs && prev->procs[j].pid < c->pid)
+        {
+            ++j;
+        }
+
+        uint64_t ticks = c->cpu_ticks;
+
+        if (j < prev->num_procs && prev->procs[j].pid == c->pid &&
+            prev->procs[j].start_ticks == c->start_ticks && prev->procs[j].cpu_ticks <= ticks)
+        {
+            ticks -= prev->procs[j].cpu_ticks;
+        }
+
+        c->cpu = (elapsed_ticks > 0) ? (double)ticks * 100 / elapsed_ticks : 0;
+    }
+}
+
+/// Compute the average CPU usage of every process over its lifetime (like ps)
+void
+compute_cpu_averages(struct proc_list* cur, uint64_t uptime_ticks)
+{
+    for (size_t i = 0; i < cur->num_procs; ++i)
+    {
+        struct proc* c = &cur->procs[i];
+        const uint64_t lifetime_ticks = (uptime_ticks > c->start_ticks) ? uptime_ticks - c->start_ticks : 0;
+        c->cpu = (lifetime_ticks != 0) ? (double)c->cpu_ticks * 100 / (double)lifetime_ticks : 0;
+    }
+}
+
+// }}}
+
+// {{{ printing
+
+/// Sort by CPU usage (descending), then by PID
+int
+compare_cpu(const void* a, const void* b)
+{
+    const struct proc* x = *(const struct proc* const*)a;
+    const struct proc* y = *(const struct proc* const*)b;
+
+    if (x->cpu != y->cpu)
+    {
+        return (x->cpu < y->cpu) ? 1 : -1;
+    }
+
+    return (x->pid > y->pid) - (x->pid < y->pid);
+}
+
+/// Get the name of the user \a uid (or its number)
+const char*
+user_name(uid_t uid)
+{
+    // Most processes are owned by a few users.
+    static uid_t cached_uid = (uid_t)-1;
+    static char cached_name[32] = {'\0'};
+
+    if (uid != cached_uid)
+    {
+        const struct passwd* pw = getpwuid(uid);
+        if (pw != nullptr)
+        {
+            (void)snprintf(cached_name, sizeof(cached_name), "%s", pw->pw_name);
+        }
+        else
+        {
+            (void)snprintf(cached_name, sizeof(cached_name), "%u", uid);
+        }
+        cached_uid = uid;
+    }
+
+    return cached_name;
+}
+
+void
+print_procs(const struct proc* const* procs, size_t num_procs,
+            long clk_tck, long page_size)
+{
+    if (clear_screen)
+    {
+        (void)fputs("\033[H\033[2J", stdout);
+    }
+
+    printf("%7s %7s %-8s %c %4s %9s %6s %10s %s\n",
+           "PID", "PPID", "USER", 'S', "THR", "RSS", "%CPU", "TIME", "COMMAND");
+
+    for (size_t i = 0; i < num_procs; ++i)
+    {
+        const struct proc* proc = procs[i];
+
+        const uint64_t cpu_s = proc->cpu_ticks / (uint64_t)clk_tck;
+        const uint64_t rss_kib = proc->rss_pages * (uint64_t)page_size / 1024;
+
+        char cmdline[cmdline_size];
+        if (proc->cmdline[0] != '\0')
+        {
+            (void)snprintf(cmdline, sizeof(cmdline), "%s", proc->cmdline);
+        }
+        else
+        {
+            // a kernel thread (or a zombie)
+            (void)snprintf(cmdline, sizeof(cmdline), "[%s]", proc->comm);
+        }
+        replace_control_chars(cmdline);
+
+        printf("%7d %7d %-8.8s %c %4ju %9ju %6.1f %3ju:%02ju:%02ju %s\n",
+               proc->pid, proc->ppid, user_name(proc->uid), proc->state,
+               (uintmax_t)proc->num_threads, (uintmax_t)rss_kib, proc->cpu,
+               (uintmax_t)(cpu_s / 3600), (uintmax_t)(cpu_s / 60 % 60), (uintmax_t)(cpu_s % 60),
+               cmdline);
+    }
+
+    if (fflush(stdout) == EOF)
+    {
+        err(EXIT_FAILURE, "fflush");
+    }
+}
+
+// }}}
+
+void
+print_version()
+{
+    printf("%s %s\n", program_invocation_short_name, program_version);
+    printf("License: %s\n", program_license);
+    printf("Written by %s\n", program_author);
+}
+
+void
+print_usage()
+{
+    printf("Usage: %s [OPTION]... [PATTERN]\n", program_invocation_short_name);
+    printf("\n");
+    printf("List the processes (whose names match PATTERN, if given), like ps or top.\n");
+    printf("\n");
+    printf("/proc is read with getdents64, and the files of every process are opened relative to its directory.\n");
+    printf("Nothing is allocated per process, and no other program is run.\n");
+    printf("\n");
+    printf("PATTERN is an extended regular expression (like pgrep).\n");
+    printf("This program is never listed.\n");
+    printf("\n");
+    printf("%%CPU is the percent of one CPU used by the process.\n");
+    printf("In a single scan, it is the average over the lifetime of the process (like ps).\n");
+    printf("In repeat mode, it is the average since the previous scan (like top), and the processes are sorted by it.\n");
+    printf("RSS is in kibibytes.\n");
+    printf("\n");
+
+    printf("OPTIONS\n");
+    printf("  -V       Print the version information, then exit.\n");
+    printf("\n");
+    printf("  -h       Print this message, then exit.\n");
+    printf("\n");
+    printf("  -c       In repeat mode, clear the screen before every scan.\n");
+    printf("\n");
+    printf("  -f       Match PATTERN against the full command line, not only the process name.\n");
+    printf("\n");
+    printf("  -i MSEC  Scan repeatedly, with MSEC milliseconds between scans (repeat mode).\n");
+    printf("           MSEC must be a positive integer.\n");
+    printf("           On stdout, scans are separated by an empty line.\n");
+    printf("\n");
+    printf("  -j NUM   Scan with NUM threads.\n");
+    printf("           NUM must be within the interval [1, %u].\n", max_threads);
+    printf("           The default value is 1.\n");
+    printf("\n");
+    printf("  -n NUM   List at most NUM processes.\n");
+    printf("           The default value is 0 (no limit).\n");
+    printf("\n");
+    printf("EXIT STATUS\n");
+    printf("  In a single scan, 1 if PATTERN is given and no process matched it; otherwise 0.\n");
+    printf("\n");
+}
+
+uint64_t
+get_boottime_ns()
+{
+    struct timespec now_ts;
+
+    // /proc/PID/stat starttime is measured from boot (including suspend).
+    if (clock_gettime(CLOCK_BOOTTIME, &now_ts) < 0)
+    {
+        err(EXIT_FAILURE, "clock_gettime");
+    }
+
+    return ts_to_ns(&now_ts);
+}
+
+int
+main([[maybe_unused]] int argc, [[maybe_unused]] char* argv[])
+{
+    unsigned int interval_msec = 0;
+    unsigned int num_threads = 1;
+    unsigned int max_procs = 0;
+
+    int oc = 0;
+    const char* short_options = "+:Vhcfi:j:n:";
+    while ((oc = getopt(argc, argv, short_options)) != -1)
+    {
+        switch (oc)
+        {
+        case 'V':
+            print_version();
+            return EXIT_SUCCESS;
+
+        case 'h':
+            print_usage();
+            return EXIT_SUCCESS;
+
+        case 'c':
+            clear_screen = true;
+            break;
+
+        case 'f':
+            match_full = true;
+            break;
+
+        case 'i':
+            interval_msec = strtou(optarg);
+            if (interval_msec == 0)
+            {
+                errx(EXIT_FAILURE, "invalid interval: %u", interval_msec);
+            }
+            break;
+
+        case 'j':
+            num_threads = strtou(optarg);
+            if (num_threads == 0 || num_threads > max_threads)
+            {
+                errx(EXIT_FAILURE, "invalid number of threads: %u", num_threads);
+            }
+            break;
+
+        case 'n':
+            max_procs = strtou(optarg);
+            break;
+
+        default:
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    if (argc - optind > 1)
+    {
+        errx(EXIT_FAILURE, "too many arguments");
+    }
+
+    if (argc - optind == 1)
+    {
+        const int e = regcomp(&pattern, argv[optind], REG_EXTENDED | REG_NOSUB);
+        if (e != 0)
+        {
+            char msg[256] = {'\0'};
+            (void)regerror(e, &pattern, msg, sizeof(msg));
+            errx(EXIT_FAILURE, "invalid pattern: '%s': %s", argv[optind], msg);
+        }
+        has_pattern = true;
+    }
+
+    const long clk_tck = sysconf(_SC_CLK_TCK);
+    const long page_size = sysconf(_SC_PAGESIZE);
+    if (clk_tck <= 0 || page_size <= 0)
+    {
+        err(EXIT_FAILURE, "sysconf");
+    }
+
+    // Opened once, and rewound for every scan
+    const int proc_fd = open("/proc", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (proc_fd < 0)
+    {
+        err(EXIT_FAILURE, "/proc");
+    }
+
+    const pid_t self = getpid();
+
+    struct pid_list pids = {nullptr, 0, 0};
+    struct proc_list cur = {nullptr, 0, 0, nullptr};
+    struct proc_list prev = {nullptr, 0, 0, nullptr};
+    const struct proc** shown = nullptr;
+    size_t cap_shown = 0;
+    size_t num_matched = 0;
+
+    const struct timespec interval = msec_to_timespec(interval_msec);
+    struct timespec deadline;
+    if (clock_gettime(CLOCK_MONOTONIC, &deadline) < 0)
+    {
+        err(EXIT_FAILURE, "clock_gettime");
+    }
+
+    uint64_t prev_boottime_ns = 0;
+
+    for (bool first_scan = true;; first_scan = false)
+    {
+        if (list_pids(proc_fd, &pids) < 0)
+        {
+            exit(EXIT_FAILURE);
+        }
+
+        const uint64_t boottime_ns = get_boottime_ns();
+
+        scan_procs(proc_fd, &pids, &cur, num_threads);
+
+        // /proc lists the processes in the order of their PIDs, but do not depend on it.
+        qsort(cur.procs, cur.num_procs, sizeof(*cur.procs), compare_pid);
+
+        if (first_scan)
+        {
+            compute_cpu_averages(&cur, boottime_ns / UINT64_C(1'000'000) * (uint64_t)clk_tck / 1000);
+        }
+        else
+        {
+            compute_cpu_deltas(&cur, &prev,
+                               (double)(boottime_ns - prev_boottime_ns) * (double)clk_tck / 1E9);
+        }
+        prev_boottime_ns = boottime_ns;
+
+        if (cap_shown < cur.num_procs)
+        {
+            const struct proc** p = (const struct proc**)realloc((void*)shown, cur.num_procs * sizeof(*p));
+            if (p == nullptr)
+            {
+                err(EXIT_FAILURE, "realloc");
+            }
+            shown = p;
+            cap_shown = cur.num_procs;
+        }
+
+        num_matched = 0;
+        for (size_t i = 0; i < cur.num_procs; ++i)
+        {
+            if (cur.procs[i].matched && cur.procs[i].pid != self)
+            {
+                shown[num_matched++] = &cur.procs[i];
+            }
+        }
+
+        if (interval_msec != 0)
+        {
+            qsort((void*)shown, num_matched, sizeof(*shown), compare_cpu);
+        }
+
+        print_procs(shown,
+                    (max_procs != 0 && max_procs < num_matched) ? max_procs : num_matched,
+                    clk_tck, page_size);
+
+        if (interval_msec == 0)
+        {
+            break;
+        }
+
+        if (!clear_screen)
+        {
+            (void)putchar('\n');
+        }
+
+        const struct proc_list tmp = prev;
+        prev = cur;
+        cur = tmp;
+
+        // Sleep until the next deadline; the ones that were missed are skipped.
+        struct timespec now;
+        if (clock_gettime(CLOCK_MONOTONIC, &now) < 0)
+        {
+            err(EXIT_FAILURE, "clock_gettime");
+        }
+        do
+        {
+            timespecadd(&deadline, &interval, &deadline);
+        }
+        while (ts_to_ns(&deadline) <= ts_to_ns(&now));
+
+        int e = 0;
+        while ((e = clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, nullptr)) == EINTR)
+        {
+        }
+        if (e != 0)
+        {
+            errno = e;
+            err(EXIT_FAILURE, "clock_nanosleep");
+        }
+    }
+
+    (void)close(proc_fd);
+    free(pids.pids);
+    free(cur.procs);
+    free(cur.cmdlines);
+    free(prev.procs);
+    free(prev.cmdlines);
+    free((void*)shown);
+    if (has_pattern)
+    {
+        regfree(&pattern);
+    }
+
+    return (has_pattern && num_matched == 0) ? EXIT_FAILURE : EXIT_SUCCESS;
+}
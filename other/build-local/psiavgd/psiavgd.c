@@ -0,0 +1,415 @@
+// SPDX-FileCopyrightText: Steven Ward
+// SPDX-License-Identifier: MPL-2.0
+
+#include "acfile.h"
+#include "deadline_timer.h"
+#include "preader.h"
+#include "sample_shm.h"
+#include "sampling_daemon.h"
+#include "strtou.h"
+#include "ts_to_ns.h"
+
+#include <err.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+// {{{ pressure stall information
+// https://docs.kernel.org/accounting/psi.html
+
+enum psi_resource
+{
+    PSI_CPU,
+    PSI_MEMORY,
+    PSI_IO,
+    NUM_PSI_RESOURCES,
+};
+
+const char* const psi_names[NUM_PSI_RESOURCES] = {"cpu", "memory", "io"};
+
+const char* const psi_paths[NUM_PSI_RESOURCES] = {
+    "/proc/pressure/cpu",
+    "/proc/pressure/memory",
+    "/proc/pressure/io",
+};
+
+// The lines of a file in /proc/pressure/
+enum psi_line
+{
+    PSI_SOME,
+    PSI_FULL,
+    NUM_PSI_LINES,
+};
+
+/// Scan the total stall times (in microseconds) of the "some" and "full" lines
+/**
+* A missing line (e.g. "full" in /proc/pressure/cpu before Linux 5.13) is 0.
+* \retval 0 success
+* \retval -1 failure
+*/
+int
+scan_pressure(struct preader* reader, uint64_t totals[NUM_PSI_LINES])
+{
+    if (preader_read(reader) < 0)
+    {
+        return -1;
+    }
+
+    const char* p = reader->buf;
+    const char* const last = p + reader->len;
+
+    totals[PSI_SOME] = 0;
+    totals[PSI_FULL] = 0;
+
+    while (p < last)
+    {
+        // some avg10=0.00 avg60=0.00 avg300=0.00 total=0
+        size_t line = NUM_PSI_LINES;
+
+        if (last - p >= 4 && memcmp(p, "some", 4) == 0)
+        {
+            line = PSI_SOME;
+        }
+        else if (last - p >= 4 && memcmp(p, "full", 4) == 0)
+        {
+            line = PSI_FULL;
+        }
+
+        if (line != NUM_PSI_LINES)
+        {
+            // the name and the 3 averages
+            for (size_t i = 0; i < 4; ++i)
+            {
+                if (!scan_skip_field(&p, last))
+                {
+                    return -1;
+                }
+            }
+
+            scan_skip_blanks(&p, last);
+
+            if (last - p < 6 || memcmp(p, "total=", 6) != 0)
+            {
+                return -1;
+            }
+            p += 6;
+
+            if (!scan_u64(&p, last, &totals[line]))
+            {
+                return -1;
+            }
+        }
+
+        if (!scan_next_line(&p, last))
+        {
+            break;
+        }
+    }
+
+    return 0;
+}
+
+/// Get the fraction of \a delta_time_ns that was stalled
+double
+stall_fraction(uint64_t total_us, uint64_t prev_total_us, uint64_t delta_time_ns)
+{
+    if (delta_time_ns == 0 || total_us < prev_total_us)
+    {
+        return 0;
+    }
+
+    const double x = (double)(total_us - prev_total_us) * 1E3 / (double)delta_time_ns;
+
+    // The totals and the time are not read at the same instant.
+    return (x > 1) ? 1 : x;
+}
+
+// }}}
+
+const char* const program_author = "Steven Ward";
+const char* const program_version = "1.0.0";
+const char* const program_license = "MPL-2.0";
+
+constexpr unsigned int default_init_delay_msec = 1000;
+constexpr unsigned int default_interval_msec = 1000;
+constexpr unsigned int default_shm_capacity = 256;
+
+const char* dest_path = nullptr;
+const char* shm_path = nullptr;
+
+void
+print_version()
+{
+    printf("%s %s\n", program_invocation_short_name, program_version);
+    printf("License: %s\n", program_license);
+    printf("Written by %s\n", program_author);
+}
+
+void
+print_usage()
+{
+    printf("Usage: %s [OPTION]...\n", program_invocation_short_name);
+    printf("\n");
+    printf("Continuously measure the CPU, memory, and I/O pressure at a regular interval, and write the measurement to stdout or a temporary file.\n");
+    printf("\n");
+    printf("Pressure is the fraction of the interval during which tasks were stalled waiting for a resource (see /proc/pressure/).\n");
+    printf("It is computed from the total stall times, not the kernel's 10-second averages, so it reacts within one interval.\n");
+    printf("\n");
+    printf("Every measurement is a line for every resource:\n");
+    printf("  NAME SOME FULL\n");
+    printf("SOME is the fraction of time at least one task was stalled.\n");
+    printf("FULL is the fraction of time all non-idle tasks were stalled.\n");
+    printf("Each is a real number within the interval [0, 1].\n");
+    printf("On stdout, measurements are separated by an empty line.\n");
+    printf("\n");
+    printf("The shared-memory file (see sample_shm.h) holds SOME and FULL of every resource, in the order of the lines.\n");
+    printf("\n");
+
+    printf("OPTIONS\n");
+    printf("  -V       Print the version information, then exit.\n");
+    printf("\n");
+    printf("  -h       Print this message, then exit.\n");
+    printf("\n");
+    printf("  -f FILE  Specify the temporary output file.\n");
+    printf("           FILE must not exist when this daemon starts.\n");
+    printf("           FILE is truncated before every measurement is written.\n");
+    printf("           FILE is removed when this daemon exits successfully.\n");
+    printf("\n");
+    printf("  -i MSEC  Specify the interval (in milliseconds) between measurements.\n");
+    printf("           MSEC must be a positive integer.\n");
+    printf("           The default value is %u.\n", default_interval_msec);
+    printf("\n");
+    printf("  -m FILE  Also write every measurement to the shared-memory file FILE.\n");
+    printf("           FILE must not exist when this daemon starts.\n");
+    printf("           FILE is removed when this daemon exits successfully.\n");
+    printf("\n");
+    printf("  -N NUM   Specify the number of measurements kept in the shared-memory file.\n");
+    printf("           NUM must be a positive integer.\n");
+    printf("           The default value is %u.\n", default_shm_capacity);
+    printf("\n");
+}
+
+int
+main([[maybe_unused]] int argc, [[maybe_unused]] char* argv[])
+{
+    unsigned int init_delay_msec = default_init_delay_msec;
+    unsigned int interval_msec = default_interval_msec;
+    unsigned int shm_capacity = default_shm_capacity;
+
+    int oc = 0;
+    const char* short_options = "+:Vhf:i:m:N:";
+    while ((oc = getopt(argc, argv, short_options)) != -1)
+    {
+        switch (oc)
+        {
+        case 'V':
+            print_version();
+            return EXIT_SUCCESS;
+
+        case 'h':
+            print_usage();
+            return EXIT_SUCCESS;
+
+        case 'f':
+            dest_path = optarg;
+            break;
+
+        case 'i':
+            interval_msec = strtou(optarg);
+            if (interval_msec == 0)
+            {
+                errx(EXIT_FAILURE, "invalid interval: %u", interval_msec);
+            }
+
+            // There is no option for specifying the initial delay.
+            init_delay_msec = interval_msec;
+            break;
+
+        case 'm':
+            shm_path = optarg;
+            break;
+
+        case 'N':
+            shm_capacity = strtou(optarg);
+            if (shm_capacity == 0)
+            {
+                errx(EXIT_FAILURE, "invalid number of measurements: %u", shm_capacity);
+            }
+            break;
+
+        default:
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    // Opened once and re-read every tick
+    struct preader readers[NUM_PSI_RESOURCES];
+
+    for (size_t i = 0; i < NUM_PSI_RESOURCES; ++i)
+    {
+        if (preader_open(&readers[i], psi_paths[i]) < 0)
+        {
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    if (sampling_daemon_remove_at_exit(dest_path, shm_path) < 0)
+    {
+        exit(EXIT_FAILURE);
+    }
+
+    ACFD(dest_fd) = -1;
+
+    if (dest_path != nullptr)
+    {
+        constexpr mode_t new_mask = 0o133; // rw-r--r--
+        (void)umask(new_mask);
+
+        // Opened once and kept open for the life of the daemon: writing
+        // through this fd every tick (below) is immune to dest_path being
+        // later replaced with a symlink, since a fd is bound to the
+        // underlying inode, not the path.
+        dest_fd = open(dest_path, O_WRONLY | O_CREAT | O_EXCL, 0o666);
+        if (dest_fd < 0)
+        {
+            err(EXIT_FAILURE, "%s", dest_path);
+        }
+    }
+
+    struct sample_shm shm = {-1, 0, nullptr, nullptr, 0, 0, 0};
+
+    if (shm_path != nullptr &&
+        sample_shm_create(&shm, shm_path, NUM_PSI_RESOURCES * NUM_PSI_LINES, shm_capacity) < 0)
+    {
+        exit(EXIT_FAILURE);
+    }
+
+    sigset_t empty_mask;
+    sigset_t orig_mask;
+    if (sampling_daemon_handle_signals(&empty_mask, &orig_mask) < 0)
+    {
+        exit(EXIT_FAILURE);
+    }
+
+    struct deadline_timer timer = {-1, {0, 0}, {0, 0}};
+    if (deadline_timer_open(&timer, init_delay_msec, interval_msec) < 0)
+    {
+        exit(EXIT_FAILURE);
+    }
+
+    bool first_iteration = true;
+    uint64_t prev_now_ns = 0;
+    uint64_t totals[NUM_PSI_RESOURCES][NUM_PSI_LINES];
+    uint64_t prev_totals[NUM_PSI_RESOURCES][NUM_PSI_LINES];
+
+    do
+    {
+        if (sampling_daemon_reset_timer)
+        {
+            if (deadline_timer_start(&timer) < 0)
+            {
+                exit(EXIT_FAILURE);
+            }
+            sampling_daemon_reset_timer = 0;
+        }
+
+        struct timespec now_ts;
+
+        if (clock_gettime(CLOCK_MONOTONIC, &now_ts) < 0)
+        {
+            err(EXIT_FAILURE, "clock_gettime");
+        }
+
+        const uint64_t now_ns = ts_to_ns(&now_ts);
+
+        for (size_t i = 0; i < NUM_PSI_RESOURCES; ++i)
+        {
+            if (scan_pressure(&readers[i], totals[i]) < 0)
+            {
+                errx(EXIT_FAILURE, "error scanning '%s'", psi_paths[i]);
+            }
+        }
+
+        if (first_iteration)
+        {
+            first_iteration = false;
+        }
+        else
+        {
+            const uint64_t delta_time_ns = now_ns - prev_now_ns;
+            double fractions[NUM_PSI_RESOURCES * NUM_PSI_LINES];
+
+            // name, 2 fields, and a newline per resource, and the empty line
+            char dest_buf[NUM_PSI_RESOURCES * 32 + 2] = {'\0'};
+            size_t dest_len = 0;
+
+            for (size_t i = 0; i < NUM_PSI_RESOURCES; ++i)
+            {
+                double* f = &fractions[i * NUM_PSI_LINES];
+
+                for (size_t j = 0; j < NUM_PSI_LINES; ++j)
+                {
+                    f[j] = stall_fraction(totals[i][j], prev_totals[i][j], delta_time_ns);
+                }
+
+                const int line_len = snprintf(dest_buf + dest_len, sizeof(dest_buf) - dest_len,
+                                              "%s %.6f %.6f\n", psi_names[i],
+                                              f[PSI_SOME], f[PSI_FULL]);
+                if (line_len < 0 || (size_t)line_len >= sizeof(dest_buf) - dest_len)
+                {
+                    break;
+                }
+                dest_len += (size_t)line_len;
+            }
+
+            if (shm_path != nullptr)
+            {
+                sample_shm_write(&shm, now_ns, fractions);
+            }
+
+            if (dest_path == nullptr)
+            {
+                dest_buf[dest_len++] = '\n';
+            }
+            if (sampling_daemon_write(dest_fd, dest_buf, dest_len) < 0)
+            {
+                exit(EXIT_FAILURE);
+            }
+        }
+
+        (void)memcpy(prev_totals, totals, sizeof(totals));
+        prev_now_ns = now_ns;
+
+        if (!sampling_daemon_done)
+        {
+            // Wait for the next deadline (or a signal) with the signals unblocked.
+            // Missed deadlines are not made up: the fractions use the actual elapsed time.
+            if (deadline_timer_wait(&timer, &empty_mask) < 0)
+            {
+                exit(EXIT_FAILURE);
+            }
+        }
+    }
+    while (!sampling_daemon_done);
+
+    deadline_timer_close(&timer);
+    for (size_t i = 0; i < NUM_PSI_RESOURCES; ++i)
+    {
+        preader_close(&readers[i]);
+    }
+    sample_shm_close(&shm);
+
+    if (sigprocmask(SIG_SETMASK, &orig_mask, nullptr) < 0)
+    {
+        err(EXIT_FAILURE, "sigprocmask");
+    }
+
+    return EXIT_SUCCESS;
+}